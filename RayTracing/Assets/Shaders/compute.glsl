@@ -43,6 +43,36 @@ struct Sphere
 	float radius;
 };
 
+// INDEXED_GEOMETRY is defined by the host when the scene is uploaded in the shared vertex layout
+#ifdef INDEXED_GEOMETRY
+struct Triangle
+{
+	int a; // Indices into positions and texCoords
+	int b;
+	int c;
+	int mtlIndex;
+};
+// SPLIT_GEOMETRY keeps only what the intersection test reads in triangles[], see splitGeometry.h
+#elif defined(SPLIT_GEOMETRY)
+struct Triangle
+{
+	vec3 a;
+	float pad0;
+	vec3 edgeAB; // b - a
+	float pad1;
+	vec3 edgeAC; // c - a
+	float pad2;
+};
+
+struct TriangleAttributes
+{
+	vec2 aTex;
+	vec2 bTex;
+	vec2 cTex;
+	int mtlIndex;
+	int pad;
+};
+#else
 struct Triangle
 {
 	vec3 a;
@@ -54,6 +84,7 @@ struct Triangle
 	int mtlIndex;
 	int pad;
 };
+#endif
 
 struct BoundingBox
 {
@@ -77,16 +108,158 @@ layout(binding = 1, std430) buffer TrianglesBlock
 	Triangle triangles[];
 };
 
+#ifdef WIDE_BVH
+// WIDE_BVH is defined by the host when NodesBlock holds the tree collapsed to 4 wide nodes, see wideBVH.h
+struct WideNode
+{
+	vec4 minX;
+	vec4 minY;
+	vec4 minZ;
+	vec4 maxX;
+	vec4 maxY;
+	vec4 maxZ;
+	ivec4 child; // Wide node of an internal child, first triangle of a leaf
+	ivec4 count; // Triangles of a leaf, 0 for an internal child, -1 for an unused slot
+};
+
+// Every level of the binary tree the wide one was collapsed from can leave three children on the stack
+const int WIDE_STACK_SIZE = 97;
+
+#ifdef QUANTIZED_BVH
+// QUANTIZED_BVH is defined by the host when the wide nodes are uploaded quantized to 64 bytes, see quantizeWideBVH.
+// Child i's box is origin + q * 2^exponent per axis, q the i-th byte of the axis' bound
+struct QuantizedWideNode
+{
+	vec3 origin;
+	uint exponents; // One signed byte per axis
+	uvec4 child;
+	uint qMinX;
+	uint qMinY;
+	uint qMinZ;
+	uint qMaxX;
+	uint qMaxY;
+	uint qMaxZ;
+	uvec2 counts; // 16 bits per child, 0xFFFF for an unused slot
+};
+
+layout(binding = 2, std430) buffer NodesBlock
+{
+	QuantizedWideNode quantizedNodes[];
+};
+
+// precise keeps the rounding of quantizeWideBVH, which checked that these exact floats contain the child boxes.
+// The product is exact anyway, scale is a power of two, but the compiler may not reassociate the sum either
+vec4 decodeQuantizedAxis(uint quantized, float origin, float scale)
+{
+	precise vec4 decoded = origin + vec4(uvec4(quantized, quantized >> 8, quantized >> 16, quantized >> 24) & 0xFFu) * scale;
+	return decoded;
+}
+
+WideNode loadWideNode(int index)
+{
+	QuantizedWideNode q = quantizedNodes[index];
+	WideNode node;
+	vec3 scale = vec3(ldexp(1.0f, bitfieldExtract(int(q.exponents), 0, 8)), ldexp(1.0f, bitfieldExtract(int(q.exponents), 8, 8)),
+		ldexp(1.0f, bitfieldExtract(int(q.exponents), 16, 8)));
+	node.minX = decodeQuantizedAxis(q.qMinX, q.origin.x, scale.x);
+	node.minY = decodeQuantizedAxis(q.qMinY, q.origin.y, scale.y);
+	node.minZ = decodeQuantizedAxis(q.qMinZ, q.origin.z, scale.z);
+	node.maxX = decodeQuantizedAxis(q.qMaxX, q.origin.x, scale.x);
+	node.maxY = decodeQuantizedAxis(q.qMaxY, q.origin.y, scale.y);
+	node.maxZ = decodeQuantizedAxis(q.qMaxZ, q.origin.z, scale.z);
+	node.child = ivec4(q.child);
+	uvec4 counts = uvec4(q.counts.x & 0xFFFFu, q.counts.x >> 16, q.counts.y & 0xFFFFu, q.counts.y >> 16);
+	node.count = ivec4(counts) - 0x10000 * ivec4(equal(counts, uvec4(0xFFFFu))); // 0xFFFF to -1
+	return node;
+}
+#else
+layout(binding = 2, std430) buffer NodesBlock
+{
+	WideNode wideNodes[];
+};
+
+WideNode loadWideNode(int index)
+{
+	return wideNodes[index];
+}
+#endif
+#elif defined(CHILD_BOUNDS_BVH)
+// CHILD_BOUNDS_BVH is defined by the host when NodesBlock holds ChildBoundsNodes, internal nodes with the
+// boxes of both children, see makeChildBoundsBVH
+struct BVHChild
+{
+	vec3 boundsMin;
+	int index; // ChildBoundsNode of an internal child, first triangle of a leaf
+	vec3 boundsMax;
+	int count; // Triangles of a leaf, 0 for an internal child, -1 for an unused slot
+};
+
+struct ChildBoundsNode
+{
+	BVHChild children[2];
+};
+
+layout(binding = 2, std430) buffer NodesBlock
+{
+	ChildBoundsNode childBoundsNodes[];
+};
+#else
 layout(binding = 2, std430) buffer NodesBlock
 {
 	Node allNodes[];
 };
+#endif
 
 layout(binding = 3, std430) buffer MaterialsBlock
 {
 	Material materials[];
 };
 
+#ifdef INSTANCING
+// INSTANCING is defined by the host for two level scenes: NodesBlock then holds the BLAS of every mesh
+struct Instance
+{
+	mat4 worldToObject;
+	int blasRoot; // Root of the instance's mesh in allNodes, or wideNodes / childBoundsNodes
+	float handedness; // -1 if worldToObject mirrors, the front faces then wind the other way in object space
+	int pad1;
+	int pad2;
+};
+
+layout(binding = 6, std430) buffer TLASNodesBlock
+{
+	Node tlasNodes[];
+};
+
+layout(binding = 7, std430) buffer InstancesBlock
+{
+	Instance instances[];
+};
+
+// Handedness of the instance `traverseInstances` is tracing, so `rayTriangleIntersect` culls the faces that
+// point away from the ray in world space
+float currentHandedness = 1.0f;
+#endif
+
+#ifdef INDEXED_GEOMETRY
+layout(binding = 4, std430) buffer PositionsBlock
+{
+	vec4 positions[];
+};
+
+layout(binding = 5, std430) buffer TexCoordsBlock
+{
+	vec2 texCoords[];
+};
+#endif
+
+#ifdef SPLIT_GEOMETRY
+layout(binding = 8, std430) buffer TriangleAttributesBlock
+{
+	TriangleAttributes triangleAttributes[];
+};
+#endif
+
 struct Ray
 {
 	vec3 origin;
@@ -105,14 +278,14 @@ struct HitInfo
 	vec3 baryCoord;
 };
 
-const int MAX_TEXTURES = 5;
-uniform sampler2D textures[MAX_TEXTURES];
+// Material textures, one texture array per size class (NUM_TEXTURE_ARRAYS in mesh.h)
+uniform sampler2DArray textures[5];
 
-uniform sampler2D texture0;
-uniform sampler2D texture1;
-uniform sampler2D texture2;
-uniform sampler2D texture3;
-uniform sampler2D texture4;
+// Texture array and layer of every Material.textureIndex
+layout(binding = 0, std430) buffer TextureLayersBlock
+{
+	ivec2 textureLayers[];
+};
 
 uniform bool qualityShading;
 
@@ -299,21 +472,61 @@ HitInfo raySphereIntersect(Ray ray, Sphere sphere)
 	return hitInfo;
 }
 
+void getTriangleEdges(Triangle tri, out vec3 a, out vec3 e0, out vec3 e1)
+{
+#ifdef INDEXED_GEOMETRY
+	a = positions[tri.a].xyz;
+	e0 = positions[tri.b].xyz - a;
+	e1 = positions[tri.c].xyz - a;
+#elif defined(SPLIT_GEOMETRY)
+	a = tri.a;
+	e0 = tri.edgeAB;
+	e1 = tri.edgeAC;
+#else
+	a = tri.a;
+	e0 = tri.b - a;
+	e1 = tri.c - a;
+#endif
+}
+
+vec2 getTriangleUV(int triIndex, vec3 baryCoord)
+{
+	float w = baryCoord.x;
+	float u = baryCoord.y;
+	float v = baryCoord.z;
+#ifdef INDEXED_GEOMETRY
+	Triangle tri = triangles[triIndex];
+	return texCoords[tri.a] * w + texCoords[tri.b] * u + texCoords[tri.c] * v;
+#elif defined(SPLIT_GEOMETRY)
+	TriangleAttributes tri = triangleAttributes[triIndex];
+	return tri.aTex * u + tri.bTex * v + tri.cTex * w;
+#else
+	Triangle tri = triangles[triIndex];
+	return tri.aTex * u + tri.bTex * v + tri.cTex * w;
+#endif
+}
+
 HitInfo rayTriangleIntersect(Ray ray, Triangle tri, int triIndex)
 {
 	HitInfo hitInfo;
 	hitInfo.didHit = false;
 
-	vec3 e0 = tri.b.xyz - tri.a.xyz;
-	vec3 e1 = tri.c.xyz - tri.a.xyz;
+	vec3 a, e0, e1;
+	getTriangleEdges(tri, a, e0, e1);
+
 	vec3 cross01 = cross(e0, e1);
 	float det = -dot(ray.direction, cross01);
+#ifdef INSTANCING
+	float frontDet = det * currentHandedness;
+#else
+	float frontDet = det;
+#endif
 
-	if (det < 1e-10f && det > -1e-10f || det < 0)
+	if (det < 1e-10f && det > -1e-10f || frontDet < 0)
 		return hitInfo;
 	
 	float invDet = 1.0f / det;
-	vec3 ao = ray.origin - tri.a.xyz;
+	vec3 ao = ray.origin - a;
 	float dst = dot(ao, cross01) * invDet;
 
 	if (dst <= 1e-6)
@@ -330,7 +543,9 @@ HitInfo rayTriangleIntersect(Ray ray, Triangle tri, int triIndex)
 	hitInfo.hitPoint = ray.origin + ray.direction * dst;
 	hitInfo.normal = normalize(cross01);
 	hitInfo.dst = dst;
-	hitInfo.mtlIndex = tri.mtlIndex;
+#ifndef SPLIT_GEOMETRY
+	hitInfo.mtlIndex = tri.mtlIndex; // Split geometry looks it up once for the closest hit
+#endif
 	hitInfo.triangleIndex = triIndex;
 
 	float w = 1.0f - u - v;
@@ -339,32 +554,22 @@ HitInfo rayTriangleIntersect(Ray ray, Triangle tri, int triIndex)
 	return hitInfo;
 }
 
-vec3 getTriangleTextureColor(int textureIndex, vec3 baryCoord, vec2 aTex, vec2 bTex, vec2 cTex)
+vec3 getTriangleTextureColor(int textureIndex, vec2 uv)
 {
-	float w = baryCoord.x;
-	float u = baryCoord.y;
-	float v = baryCoord.z;
-	vec2 uv = aTex * u + bTex * v + cTex * w;
-
 	if (textureIndex < 0 || textureIndex >= numTextures)
 		return vec3(0.0f, 0.0f, 0.0f);
 
-	// return texture(textures[textureIndex], uv).rgb;
-	// return texture(texture1, uv).rgb;
-
-	// Use if-else to select the correct texture
-    if (textureIndex == 0)
-        return texture(texture0, uv).rgb;
-    else if (textureIndex == 1)
-        return texture(texture1, uv).rgb;
-    else if (textureIndex == 2)
-        return texture(texture2, uv).rgb;
-    else if (textureIndex == 3)
-        return texture(texture3, uv).rgb;
-    else if (textureIndex == 4)
-        return texture(texture4, uv).rgb;
-    else
-        return vec3(1.0f, 0.0f, 1.0f); // Return magenta if something goes wrong
+	// Sampler arrays may only be indexed with dynamically uniform values, neighbouring rays hit other textures
+	ivec2 layer = textureLayers[textureIndex];
+	vec3 coord = vec3(uv, float(layer.y));
+	switch (layer.x)
+	{
+	case 0: return texture(textures[0], coord).rgb;
+	case 1: return texture(textures[1], coord).rgb;
+	case 2: return texture(textures[2], coord).rgb;
+	case 3: return texture(textures[3], coord).rgb;
+	default: return texture(textures[4], coord).rgb;
+	}
 }
 
 bool isCloseToZero(float val)
@@ -407,15 +612,141 @@ float rayBoundsIntersect(Ray ray, BoundingBox bounds)
 	return tMin;
 }
 
-HitInfo calculateRayCollisionBVH(Ray ray)
+#ifdef WIDE_BVH
+// rayBoundsIntersect against the four child boxes of a wide node at once
+vec4 rayWideBoundsIntersect(Ray ray, WideNode node)
+{
+	vec4 tMin = vec4(-1e32f);
+	vec4 tMax = vec4(1e32f);
+
+	if (!isCloseToZero(ray.direction.x))
+	{
+		vec4 t0 = (node.minX - ray.origin.x) / ray.direction.x;
+		vec4 t1 = (node.maxX - ray.origin.x) / ray.direction.x;
+		tMin = max(tMin, min(t0, t1));
+		tMax = min(tMax, max(t0, t1));
+	}
+	if (!isCloseToZero(ray.direction.y))
+	{
+		vec4 t0 = (node.minY - ray.origin.y) / ray.direction.y;
+		vec4 t1 = (node.maxY - ray.origin.y) / ray.direction.y;
+		tMin = max(tMin, min(t0, t1));
+		tMax = min(tMax, max(t0, t1));
+	}
+	if (!isCloseToZero(ray.direction.z))
+	{
+		vec4 t0 = (node.minZ - ray.origin.z) / ray.direction.z;
+		vec4 t1 = (node.maxZ - ray.origin.z) / ray.direction.z;
+		tMin = max(tMin, min(t0, t1));
+		tMax = min(tMax, max(t0, t1));
+	}
+
+	vec4 dst;
+	for (int i = 0; i < 4; i++)
+		dst[i] = (tMin[i] < tMax[i] && tMax[i] >= 0) ? tMin[i] : 1e38f;
+	return dst;
+}
+
+// Closest hit below wideNodes[rootIndex], only hits nearer than result.dst replace it. Children are visited
+// nearest first: leaves are intersected on the spot, internal children are pushed farthest first.
+void traverseBVH(Ray ray, int rootIndex, inout HitInfo result)
+{
+	int stack[WIDE_STACK_SIZE];
+	int stackIndex = 0;
+	stack[stackIndex++] = rootIndex;
+
+	while(stackIndex > 0)
+	{
+		stackIndex -= 1;
+		WideNode node = loadWideNode(stack[stackIndex]);
+		vec4 dst = rayWideBoundsIntersect(ray, node);
+
+		int order[4];
+		for (int i = 0; i < 4; i++)
+		{
+			int j = i;
+			for (; j > 0 && dst[order[j - 1]] > dst[i]; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+
+		int internalChildren[4];
+		int numInternalChildren = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int slot = order[i];
+			if (dst[slot] >= result.dst)
+				break;
+
+			if (node.count[slot] > 0)
+			{
+				for (int t = node.child[slot]; t < node.child[slot] + node.count[slot]; t++)
+				{
+					HitInfo hitInfo = rayTriangleIntersect(ray, triangles[t], t);
+					if (hitInfo.didHit)
+						if (hitInfo.dst < result.dst)
+							result = hitInfo;
+				}
+			}
+			else if (node.count[slot] == 0)
+				internalChildren[numInternalChildren++] = slot;
+		}
+
+		for (int i = numInternalChildren - 1; i >= 0; i--)
+			if (dst[internalChildren[i]] < result.dst)
+				stack[stackIndex++] = node.child[internalChildren[i]];
+	}
+}
+#elif defined(CHILD_BOUNDS_BVH)
+void intersectLeaf(Ray ray, BVHChild leaf, inout HitInfo result)
+{
+	for (int i = leaf.index; i < leaf.index + leaf.count; i++)
+	{
+		HitInfo hitInfo = rayTriangleIntersect(ray, triangles[i], i);
+		if (hitInfo.didHit)
+			if (hitInfo.dst < result.dst)
+				result = hitInfo;
+	}
+}
+
+// Closest hit below childBoundsNodes[rootIndex], only hits nearer than result.dst replace it. One fetch
+// gives both child boxes: leaf children are intersected on the spot, nearer first, internal ones pushed
+void traverseBVH(Ray ray, int rootIndex, inout HitInfo result)
 {
 	int stack[MAX_DEPTH];
 	int stackIndex = 0;
-	stack[stackIndex++] = 0;
+	stack[stackIndex++] = rootIndex;
 
-	HitInfo result;
-	result.dst = 1e38f;
-	result.didHit = false;
+	while(stackIndex > 0)
+	{
+		stackIndex -= 1;
+		ChildBoundsNode node = childBoundsNodes[stack[stackIndex]];
+
+		BoundingBox boundsA = BoundingBox(node.children[0].boundsMin, 0.0f, node.children[0].boundsMax, 0.0f);
+		BoundingBox boundsB = BoundingBox(node.children[1].boundsMin, 0.0f, node.children[1].boundsMax, 0.0f);
+		float dstA = rayBoundsIntersect(ray, boundsA);
+		float dstB = rayBoundsIntersect(ray, boundsB);
+
+		bool isNearestA = dstA < dstB;
+		float dstNear = isNearestA ? dstA : dstB;
+		float dstFar  = isNearestA ? dstB : dstA;
+		BVHChild childNear = isNearestA ? node.children[0] : node.children[1];
+		BVHChild childFar  = isNearestA ? node.children[1] : node.children[0];
+
+		if (childNear.count > 0 && dstNear < result.dst) intersectLeaf(ray, childNear, result);
+		if (childFar.count  > 0 && dstFar  < result.dst) intersectLeaf(ray, childFar, result);
+
+		if (childFar.count  == 0 && dstFar  < result.dst) stack[stackIndex++] = childFar.index;
+		if (childNear.count == 0 && dstNear < result.dst) stack[stackIndex++] = childNear.index;
+	}
+}
+#else
+// Closest hit below allNodes[rootIndex], only hits nearer than result.dst replace it
+void traverseBVH(Ray ray, int rootIndex, inout HitInfo result)
+{
+	int stack[MAX_DEPTH];
+	int stackIndex = 0;
+	stack[stackIndex++] = rootIndex;
 
 	while(stackIndex > 0)
 	{
@@ -456,6 +787,78 @@ HitInfo calculateRayCollisionBVH(Ray ray)
 			if (dstNear < result.dst) stack[stackIndex++] = childIndexNear;
 		}
 	}
+}
+#endif
+
+#ifdef INSTANCING
+// Walks the TLAS and traces every instance it reaches through its BLAS in object space. The object space
+// direction is not normalized, so hit distances are the same in both spaces.
+void traverseInstances(Ray ray, inout HitInfo result)
+{
+	int stack[MAX_DEPTH];
+	int stackIndex = 0;
+	stack[stackIndex++] = 0;
+
+	while(stackIndex > 0)
+	{
+		stackIndex -= 1;
+		Node node = tlasNodes[stack[stackIndex]];
+
+		if (node.childIndex == -1)
+		{
+			for (int i = node.triangleIndex; i < node.triangleIndex + node.triangleCount; i++)
+			{
+				Instance instance = instances[i];
+				Ray objectRay;
+				objectRay.origin = (instance.worldToObject * vec4(ray.origin, 1.0f)).xyz;
+				objectRay.direction = mat3(instance.worldToObject) * ray.direction;
+				objectRay.insideGlass = ray.insideGlass;
+
+				float dstBefore = result.dst;
+				currentHandedness = instance.handedness;
+				traverseBVH(objectRay, instance.blasRoot, result);
+				if (result.dst < dstBefore)
+				{
+					result.hitPoint = ray.origin + ray.direction * result.dst;
+					result.normal = normalize(transpose(mat3(instance.worldToObject)) * result.normal) * instance.handedness;
+				}
+			}
+		}
+		else
+		{
+			int childIndexA = node.childIndex;
+			int childIndexB = node.childIndex + 1;
+			float dstA = rayBoundsIntersect(ray, tlasNodes[childIndexA].bounds);
+			float dstB = rayBoundsIntersect(ray, tlasNodes[childIndexB].bounds);
+
+			bool isNearestA = dstA < dstB;
+			float dstNear = isNearestA ? dstA : dstB;
+			float dstFar  = isNearestA ? dstB : dstA;
+			int childIndexNear = isNearestA ? childIndexA : childIndexB;
+			int childIndexFar  = isNearestA ? childIndexB : childIndexA;
+
+			if (dstFar  < result.dst) stack[stackIndex++] = childIndexFar;
+			if (dstNear < result.dst) stack[stackIndex++] = childIndexNear;
+		}
+	}
+}
+#endif
+
+HitInfo calculateRayCollisionBVH(Ray ray)
+{
+	HitInfo result;
+	result.dst = 1e38f;
+	result.didHit = false;
+
+#ifdef INSTANCING
+	traverseInstances(ray, result);
+#else
+	traverseBVH(ray, 0, result);
+#endif
+#ifdef SPLIT_GEOMETRY
+	if (result.didHit)
+		result.mtlIndex = triangleAttributes[result.triangleIndex].mtlIndex;
+#endif
 	return result;
 }
 
@@ -501,8 +904,7 @@ vec3 trace(Ray ray, inout uint rngState)
 				case DIFFUSE:
 				case TEXTURE:
 					ray.direction = normalize(hitInfo.normal + randomDirection(rngState));
-					Triangle tri = triangles[hitInfo.triangleIndex];
-					attenuation = material.materialType == DIFFUSE ? material.color.xyz : getTriangleTextureColor(material.textureIndex, hitInfo.baryCoord, tri.aTex, tri.bTex, tri.cTex);
+					attenuation = material.materialType == DIFFUSE ? material.color.xyz : getTriangleTextureColor(material.textureIndex, getTriangleUV(hitInfo.triangleIndex, hitInfo.baryCoord));
 					break;
 				case SPECULAR:
 					vec3 diffuseDirection = normalize(hitInfo.normal + randomDirection(rngState));
@@ -590,8 +992,7 @@ vec3 traceBasic(Ray ray)
 				switch (material.materialType)
 				{
 				case TEXTURE:
-					Triangle tri = triangles[hitInfo.triangleIndex];
-					color = getTriangleTextureColor(material.textureIndex, hitInfo.baryCoord, tri.aTex, tri.bTex, tri.cTex);
+					color = getTriangleTextureColor(material.textureIndex, getTriangleUV(hitInfo.triangleIndex, hitInfo.baryCoord));
 					break;
 				case DIFFUSE:
 					color = material.color.xyz;
@@ -1,13 +1,86 @@
 #pragma once
 
 #include <iostream>
+#include <chrono>
+#include <iomanip>
+#include <functional>
+#include <numeric>
+#include <type_traits>
+#include <stdexcept>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 #include <glm/glm.hpp>
 
 #include <Assets/headers/mesh.h>
+#include <Assets/headers/threadPool.h>
 
 const int MAX_DEPTH = 32;
 
+// Centroid bins per axis of the binned SAH builder
+const int SAH_BIN_COUNT = 16;
+
+// Nodes with at least this many triangles are binned and partitioned by the whole thread pool
+const int BVH_PARALLEL_SPLIT_SIZE = 64 * 1024;
+
+// SBVH: spatial splits are only searched where the two children of the best object split overlap by more
+// than this fraction of the root's area
+const float SBVH_OVERLAP_THRESHOLD = 1e-5f;
+
+// SBVH: most references spatial splits may add, as a fraction of the triangle count. Triangles are duplicated
+// once per extra reference, once the budget is used up the build goes on with object splits only
+const float SBVH_DUPLICATION_BUDGET = 0.3f;
+
+// LBVH: scenes up to this many triangles get 30 bit Morton codes (10 bits per axis, 4 sort passes), larger
+// ones 63 bit codes (21 bits per axis, 8 passes) so that close triangles still get distinct codes
+const int LBVH_SHORT_CODE_LIMIT = 256 * 1024;
+
+// Treelet restructuring: leaves of a treelet, all 2^7 subsets of them are searched for the cheapest topology
+const int BVH_TREELET_SIZE = 7;
+
+// LBVH treelets: passes over the tree, each only restructures nodes of at least twice the triangles of the last
+const int LBVH_TREELET_ROUNDS = 3;
+
+// `BVH::optimize`: nodes with the largest area taken out and reinserted per iteration, as a fraction of all nodes
+const float BVH_REINSERTION_FRACTION = 0.02f;
+
+// `BVH::optimize` stops once an iteration lowers the SAH cost by less than this fraction
+const float BVH_OPTIMIZE_MIN_GAIN = 0.005f;
+
+// `BVH::needsRebuild` once refits have raised the SAH cost to this many times that of the build
+const float BVH_REFIT_REBUILD_RATIO = 1.5f;
+
+// Triangles per task of a parallel split. Fixed, so the chunks do not depend on the number of threads
+const int BVH_PARALLEL_CHUNK_SIZE = 16 * 1024;
+
+// Nodes with fewer triangles are built, with all their descendants, by one sequential task
+const int BVH_SUBTREE_TASK_SIZE = 4 * 1024;
+
+// Levels BVH_LAYOUT_BREADTH_FIRST_TOP stores breadth first, 255 sibling pairs, 24 KB of nodes every ray starts in
+const int BVH_LAYOUT_TOP_LEVELS = 8;
+
+enum BVHBuilder
+{
+	BVH_BUILDER_SWEEP,			// 10 candidate planes per axis, each evaluated with a pass over the node's triangles
+	BVH_BUILDER_BINNED_SAH,		// One pass bins the centroids on all three axes, every bin boundary is a candidate
+	BVH_BUILDER_SBVH,			// Binned SAH plus spatial splits, which clip triangles to the split plane and duplicate them
+	BVH_BUILDER_LBVH,			// Tree implied by the Morton order of the centroids, a fraction of the binned build time
+	BVH_BUILDER_LBVH_TREELETS,	// LBVH with treelet restructuring, recovers most of the binned SAH quality
+};
+
+// Order of the nodes in `BVH::allNodes`, see `BVH::relayout`. Siblings are always next to each other
+enum BVHLayout
+{
+	BVH_LAYOUT_BUILD_ORDER,			// As the builder wrote them, subtrees wherever its tasks put them
+	BVH_LAYOUT_DEPTH_FIRST,			// A node's left subtree right after it, then its right subtree
+	BVH_LAYOUT_BREADTH_FIRST_TOP,	// The top BVH_LAYOUT_TOP_LEVELS levels breadth first, the subtrees below them depth first
+	BVH_LAYOUT_VAN_EMDE_BOAS,		// Cache oblivious: the top half of the levels, then every subtree below them, each laid out alike
+};
+
 struct BoundingBox
 {
 	glm::vec3 min = glm::vec3(1e30f);
@@ -29,7 +102,14 @@ struct BoundingBox
 
 	glm::vec3 size() const
 	{
-		return glm::vec3(max[0] - min[0], max[0] - min[0], max[0] - min[0]);
+		return max - min;
+	}
+
+	// Half the surface area, SAH costs only ever compare areas so the factor 2 is dropped
+	float halfArea() const
+	{
+		glm::vec3 extent = size();
+		return extent.x * (extent.y + extent.z) + extent.y * extent.z;
 	}
 
 	void growToInclude(const glm::vec3& point)
@@ -44,26 +124,67 @@ struct BoundingBox
 		max = glm::max(max, tri.max);
 	}
 
+	void growToInclude(const BoundingBox& box)
+	{
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
 	void expand()
 	{
 		min -= glm::vec3(1e-4f);
 		max += glm::vec3(1e-4f);
 	}
+
+	bool isEmpty() const
+	{
+		return min.x > max.x || min.y > max.y || min.z > max.z;
+	}
 };
 
+BoundingBox intersection(const BoundingBox& a, const BoundingBox& b)
+{
+	BoundingBox box;
+	box.min = glm::max(a.min, b.min);
+	box.max = glm::min(a.max, b.max);
+	return box;
+}
+
 struct Node
 {
 	BoundingBox bounds = BoundingBox();
 	int triangleIndex = -1;
 	int triangleCount = -1;
 	int childIndex = -1;
-	int pad0 = 0.0f;
+	int pad0 = 0;
 
 	Node() = default;
 
 	Node(const BoundingBox& box, int triIdx, int count, int childIdx) : bounds(box), triangleIndex(triIdx), triangleCount(count), childIndex(childIdx) {}
 };
 
+// One child of a ChildBoundsNode, the layout of BVHChild in compute.glsl
+struct BVHChild
+{
+	glm::vec3 boundsMin = glm::vec3(1e30f);
+	int index = -1;		// ChildBoundsNode of an internal child, first triangle of a leaf
+	glm::vec3 boundsMax = glm::vec3(1e30f);
+	int count = -1;		// Triangles of a leaf, 0 for an internal child, -1 for an unused slot
+};
+
+// Internal node holding the boxes of both its children, so a traversal step fetches one node instead of three. 64 bytes
+struct ChildBoundsNode
+{
+	BVHChild children[2];
+};
+
+// What the builder partitions instead of the triangles themselves, 16 bytes against 40 + 80
+struct BVHPrimitive
+{
+	glm::vec3 center;
+	int index;	// Into the BVHTriangle and render triangle vectors the BVH was built from
+};
+
 
 std::string str(const glm::vec3& vec)
 {
@@ -89,7 +210,7 @@ float nodeCost(const glm::vec3& size, int triangleCount)
 	return halfArea * triangleCount;
 }
 
-float evaluateSplit(const Node& node, int splitAxis, float splitPos, const std::vector<BVHTriangle>& triangles)
+float evaluateSplit(const Node& node, int splitAxis, float splitPos, const std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& triangles)
 {
 	BoundingBox boundsA = {};
 	BoundingBox boundsB = {};
@@ -98,8 +219,8 @@ float evaluateSplit(const Node& node, int splitAxis, float splitPos, const std::
 
 	for (int i = node.triangleIndex; i < node.triangleIndex + node.triangleCount; i++)
 	{
-		const BVHTriangle& tri = triangles[i];
-		if (tri.center[splitAxis] < splitPos)
+		const BVHTriangle& tri = triangles[primitives[i].index];
+		if (primitives[i].center[splitAxis] < splitPos)
 		{
 			boundsA.growToInclude(tri);
 			numInA++;
@@ -114,7 +235,7 @@ float evaluateSplit(const Node& node, int splitAxis, float splitPos, const std::
 	return nodeCost(boundsA.size(), numInA) + nodeCost(boundsB.size(), numInB);
 }
 
-void chooseSplit(int& splitAxis, float& splitPos, float& cost, const Node& node, const std::vector<BVHTriangle>& triangles)
+void chooseSplit(int& splitAxis, float& splitPos, float& cost, const Node& node, const std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& triangles)
 {
 	const int numTestPerAxis = 10;
 	cost = 1e32f;
@@ -130,7 +251,7 @@ void chooseSplit(int& splitAxis, float& splitPos, float& cost, const Node& node,
 		{
 			float t = float(i + 1) / (numTestPerAxis + 1);
 			float pos = boundsStart + (boundsEnd - boundsStart) * t;
-			float costTmp = evaluateSplit(node, axis, pos, triangles);
+			float costTmp = evaluateSplit(node, axis, pos, primitives, triangles);
 
 			if (costTmp < cost)
 			{
@@ -142,80 +263,2270 @@ void chooseSplit(int& splitAxis, float& splitPos, float& cost, const Node& node,
 	}
 }
 
+struct SAHBin
+{
+	BoundingBox bounds;
+	int count = 0;
+};
+
+// One set of bins per axis
+struct SAHBins
+{
+	SAHBin bins[3][SAH_BIN_COUNT];
+};
+
+// Bins per world unit on each axis, 0 on axes where all centroids share the same coordinate
+glm::vec3 binScale(const BoundingBox& centroidBounds, int numBins)
+{
+	glm::vec3 extent = centroidBounds.size();
+	glm::vec3 scale;
+	for (int axis = 0; axis < 3; axis++)
+		scale[axis] = extent[axis] > 0.0f ? numBins / extent[axis] : 0.0f;
+	return scale;
+}
+
+// Adds the primitives [first, last) to `bins`, which must have been cleared by the caller
+void binTriangles(SAHBins& bins, int numBins, const BoundingBox& centroidBounds, const glm::vec3& scale,
+	const std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& triangles, int first, int last)
+{
+	for (int i = first; i < last; i++)
+	{
+		const BVHTriangle& tri = triangles[primitives[i].index];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			int bin = std::min(numBins - 1, static_cast<int>((primitives[i].center[axis] - centroidBounds.min[axis]) * scale[axis]));
+			bins.bins[axis][bin].bounds.growToInclude(tri);
+			bins.bins[axis][bin].count++;
+		}
+	}
+}
+
+// Sweeps the filled bins and keeps the cheapest bin boundary, see `chooseBinnedSplit`
+void chooseBinBoundary(int& splitAxis, float& splitPos, float& cost, const SAHBins& bins, int numBins,
+	const BoundingBox& centroidBounds, const glm::vec3& scale, int triangleCount)
+{
+	cost = 1e32f;
+	splitPos = 0;
+	splitAxis = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (scale[axis] == 0.0f)
+			continue;
+
+		// rightCost[i] is the cost of bins i + 1 .. numBins - 1
+		float rightCost[SAH_BIN_COUNT - 1];
+		BoundingBox rightBounds;
+		int rightCount = 0;
+		for (int i = numBins - 1; i > 0; i--)
+		{
+			rightBounds.growToInclude(bins.bins[axis][i].bounds);
+			rightCount += bins.bins[axis][i].count;
+			rightCost[i - 1] = rightCount > 0 ? rightBounds.halfArea() * rightCount : 0.0f;
+		}
+
+		BoundingBox leftBounds;
+		int leftCount = 0;
+		for (int i = 0; i < numBins - 1; i++)
+		{
+			leftBounds.growToInclude(bins.bins[axis][i].bounds);
+			leftCount += bins.bins[axis][i].count;
+			if (leftCount == 0 || leftCount == triangleCount)
+				continue;
+
+			float costTmp = leftBounds.halfArea() * leftCount + rightCost[i];
+			if (costTmp < cost)
+			{
+				cost = costTmp;
+				splitAxis = axis;
+				splitPos = centroidBounds.min[axis] + (i + 1) / scale[axis];
+			}
+		}
+	}
+}
+
+/**
+ * @brief Binned SAH split search, the replacement for `chooseSplit`.
+ *
+ * One pass over the node's triangles drops every centroid into one of `SAH_BIN_COUNT` bins per axis, spread
+ * over the centroid bounds. Two sweeps over the bins then give the cost of every bin boundary, so the whole
+ * search is O(n + bins) instead of the 30 full passes of `chooseSplit`. Boundaries leaving one side empty
+ * are not candidates, `cost` stays at 1e32 if there is no valid split (all centroids in one point).
+ */
+void chooseBinnedSplit(int& splitAxis, float& splitPos, float& cost, const Node& node, const std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& triangles)
+{
+	int first = node.triangleIndex;
+	int last = node.triangleIndex + node.triangleCount;
+
+	BoundingBox centroidBounds;
+	for (int i = first; i < last; i++)
+		centroidBounds.growToInclude(primitives[i].center);
+
+	// Small nodes, the bulk of the tree, get one bin per triangle so the bin sweeps stay proportional to the node
+	int numBins = std::min(SAH_BIN_COUNT, node.triangleCount);
+	glm::vec3 scale = binScale(centroidBounds, numBins);
+
+	// Reused between calls, most nodes are small and clearing every bin would cost more than binning them
+	thread_local SAHBins bins;
+	for (int axis = 0; axis < 3; axis++)
+		std::fill(bins.bins[axis], bins.bins[axis] + numBins, SAHBin());
+	binTriangles(bins, numBins, centroidBounds, scale, primitives, triangles, first, last);
+
+	chooseBinBoundary(splitAxis, splitPos, cost, bins, numBins, centroidBounds, scale, node.triangleCount);
+}
+
+// Number of fixed size chunks a parallel split cuts a node into
+int parallelChunkCount(const Node& node)
+{
+	return (node.triangleCount + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+}
+
+/**
+ * @brief `chooseBinnedSplit` over the whole thread pool, for nodes of at least `BVH_PARALLEL_SPLIT_SIZE` triangles.
+ *
+ * Every chunk gets centroid bounds and bins of its own, merged afterwards. Bounds merge with min / max and
+ * counts are integers, so the split is bit for bit the one `chooseBinnedSplit` picks.
+ */
+void chooseBinnedSplitParallel(int& splitAxis, float& splitPos, float& cost, const Node& node, const std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& triangles)
+{
+	ThreadPool& pool = getThreadPool();
+	int numChunks = parallelChunkCount(node);
+	int last = node.triangleIndex + node.triangleCount;
+
+	std::vector<BoundingBox> chunkCentroidBounds(numChunks);
+	pool.parallelFor(numChunks, [&](int chunk)
+	{
+		int chunkFirst = node.triangleIndex + chunk * BVH_PARALLEL_CHUNK_SIZE;
+		int chunkLast = std::min(last, chunkFirst + BVH_PARALLEL_CHUNK_SIZE);
+		for (int i = chunkFirst; i < chunkLast; i++)
+			chunkCentroidBounds[chunk].growToInclude(primitives[i].center);
+	});
+
+	BoundingBox centroidBounds;
+	for (const BoundingBox& bounds : chunkCentroidBounds)
+		centroidBounds.growToInclude(bounds);
+
+	int numBins = std::min(SAH_BIN_COUNT, node.triangleCount);
+	glm::vec3 scale = binScale(centroidBounds, numBins);
+
+	std::vector<SAHBins> chunkBins(numChunks);
+	pool.parallelFor(numChunks, [&](int chunk)
+	{
+		int chunkFirst = node.triangleIndex + chunk * BVH_PARALLEL_CHUNK_SIZE;
+		int chunkLast = std::min(last, chunkFirst + BVH_PARALLEL_CHUNK_SIZE);
+		binTriangles(chunkBins[chunk], numBins, centroidBounds, scale, primitives, triangles, chunkFirst, chunkLast);
+	});
+
+	SAHBins bins;
+	for (const SAHBins& chunk : chunkBins)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int i = 0; i < numBins; i++)
+			{
+				bins.bins[axis][i].bounds.growToInclude(chunk.bins[axis][i].bounds);
+				bins.bins[axis][i].count += chunk.bins[axis][i].count;
+			}
+		}
+	}
+
+	chooseBinBoundary(splitAxis, splitPos, cost, bins, numBins, centroidBounds, scale, node.triangleCount);
+}
+
+// Reference to a triangle in an SBVH node. A triangle split by spatial splits has one per node it ended up in
+struct SBVHReference
+{
+	BoundingBox bounds;	// Part of the triangle inside the node, smaller than the triangle's own box once it was split
+	int index;			// Into the triangle vectors the BVH was built from
+};
+
+// Bounds of the part of the triangle with `corners` between `lo` and `hi` on `axis`, clipped to `bounds`
+BoundingBox clipTriangleBounds(const glm::vec3 corners[3], int axis, float lo, float hi, const BoundingBox& bounds)
+{
+	BoundingBox clipped;
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec3& from = corners[i];
+		const glm::vec3& to = corners[(i + 1) % 3];
+		if (from[axis] >= lo && from[axis] <= hi)
+			clipped.growToInclude(from);
+
+		for (float plane : { lo, hi })
+		{
+			if ((from[axis] < plane && to[axis] > plane) || (from[axis] > plane && to[axis] < plane))
+			{
+				glm::vec3 crossing = glm::mix(from, to, (plane - from[axis]) / (to[axis] - from[axis]));
+				crossing[axis] = plane;
+				clipped.growToInclude(crossing);
+			}
+		}
+	}
+	return intersection(clipped, bounds);
+}
+
+// `chooseBinnedSplit` over SBVH references, binned by the centers of their bounds
+void chooseReferenceObjectSplit(int& splitAxis, float& splitPos, float& cost, const std::vector<SBVHReference>& references)
+{
+	BoundingBox centroidBounds;
+	for (const SBVHReference& reference : references)
+		centroidBounds.growToInclude(reference.bounds.center());
+
+	int numReferences = static_cast<int>(references.size());
+	int numBins = std::min(SAH_BIN_COUNT, numReferences);
+	glm::vec3 scale = binScale(centroidBounds, numBins);
+
+	SAHBins bins;
+	for (const SBVHReference& reference : references)
+	{
+		glm::vec3 center = reference.bounds.center();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			int bin = std::min(numBins - 1, static_cast<int>((center[axis] - centroidBounds.min[axis]) * scale[axis]));
+			bins.bins[axis][bin].bounds.growToInclude(reference.bounds);
+			bins.bins[axis][bin].count++;
+		}
+	}
+
+	chooseBinBoundary(splitAxis, splitPos, cost, bins, numBins, centroidBounds, scale, numReferences);
+}
+
+struct SpatialBin
+{
+	BoundingBox bounds;
+	int entries = 0;	// References starting in this bin
+	int exits = 0;		// References ending in this bin
+};
+
+/**
+ * @brief Spatial split search of the SBVH builder.
+ *
+ * `SAH_BIN_COUNT` bins of equal width span the node on each axis. Every reference is clipped to each bin it
+ * overlaps, so a bin only grows by the part of the triangle inside it, and is counted as entering its first
+ * bin and exiting its last. Sweeping the bins then gives the cost of splitting at every bin boundary with the
+ * straddling references on both sides. `cost` stays at 1e32 if no boundary leaves both sides non empty.
+ */
+void chooseSpatialSplit(int& splitAxis, float& splitPos, float& cost, const BoundingBox& nodeBounds,
+	const std::vector<SBVHReference>& references, const std::vector<RTXTriangle>& triangles)
+{
+	cost = 1e32f;
+	splitPos = 0;
+	splitAxis = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float start = nodeBounds.min[axis];
+		float binWidth = nodeBounds.length(axis) / SAH_BIN_COUNT;
+		if (binWidth <= 0.0f)
+			continue;
+
+		SpatialBin bins[SAH_BIN_COUNT];
+		for (const SBVHReference& reference : references)
+		{
+			int first = glm::clamp(static_cast<int>((reference.bounds.min[axis] - start) / binWidth), 0, SAH_BIN_COUNT - 1);
+			int last = glm::clamp(static_cast<int>((reference.bounds.max[axis] - start) / binWidth), first, SAH_BIN_COUNT - 1);
+			bins[first].entries++;
+			bins[last].exits++;
+
+			if (first == last)
+			{
+				bins[first].bounds.growToInclude(reference.bounds);
+				continue;
+			}
+
+			const RTXTriangle& tri = triangles[reference.index];
+			glm::vec3 corners[3] = { glm::vec3(tri.a), glm::vec3(tri.b), glm::vec3(tri.c) };
+			for (int bin = first; bin <= last; bin++)
+			{
+				float binStart = start + bin * binWidth;
+				BoundingBox part = clipTriangleBounds(corners, axis, binStart, binStart + binWidth, reference.bounds);
+				if (!part.isEmpty())
+					bins[bin].bounds.growToInclude(part);
+			}
+		}
+
+		// rightCost[i] is the cost of bins i + 1 .. SAH_BIN_COUNT - 1
+		float rightCost[SAH_BIN_COUNT - 1];
+		int rightCounts[SAH_BIN_COUNT - 1];
+		BoundingBox rightBounds;
+		int rightCount = 0;
+		for (int i = SAH_BIN_COUNT - 1; i > 0; i--)
+		{
+			rightBounds.growToInclude(bins[i].bounds);
+			rightCount += bins[i].exits;
+			rightCost[i - 1] = rightCount > 0 ? rightBounds.halfArea() * rightCount : 0.0f;
+			rightCounts[i - 1] = rightCount;
+		}
+
+		BoundingBox leftBounds;
+		int leftCount = 0;
+		for (int i = 0; i < SAH_BIN_COUNT - 1; i++)
+		{
+			leftBounds.growToInclude(bins[i].bounds);
+			leftCount += bins[i].entries;
+			if (leftCount == 0 || rightCounts[i] == 0)
+				continue;
+
+			float costTmp = leftBounds.halfArea() * leftCount + rightCost[i];
+			if (costTmp < cost)
+			{
+				cost = costTmp;
+				splitAxis = axis;
+				splitPos = start + (i + 1) * binWidth;
+			}
+		}
+	}
+}
+
+// Centroid of a triangle with its position along the Morton curve
+struct MortonPrimitive
+{
+	uint64_t code;
+	int index;	// Into the triangle vectors the BVH was built from
+};
+
+// Number of zero bits above the highest set bit, `x` must not be 0
+int countLeadingZeros(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long highestBit;
+	_BitScanReverse64(&highestBit, x);
+	return 63 - static_cast<int>(highestBit);
+#else
+	return __builtin_clzll(x);
+#endif
+}
+
+// Spreads the low 21 bits of `x` out to every third bit
+uint64_t expandMortonBits(uint64_t x)
+{
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+
+// Morton code of a point given in [0, 1] of the centroid bounds, `bitsPerAxis` at most 21
+uint64_t mortonCode(const glm::vec3& unitPosition, int bitsPerAxis)
+{
+	float numCells = static_cast<float>(1 << bitsPerAxis);
+	glm::vec3 cell = glm::clamp(unitPosition * numCells, glm::vec3(0.0f), glm::vec3(numCells - 1.0f));
+	return expandMortonBits(static_cast<uint64_t>(cell.x)) << 2 | expandMortonBits(static_cast<uint64_t>(cell.y)) << 1
+		| expandMortonBits(static_cast<uint64_t>(cell.z));
+}
+
+/**
+ * @brief Stable LSD radix sort of `items` by the low `codeBits` bits of their codes, 8 bits per pass.
+ *
+ * Every pass counts the digits of each `BVH_PARALLEL_CHUNK_SIZE` chunk on the thread pool, turns the counts
+ * into an output offset per chunk and digit and scatters the chunks side by side. A pass where all codes
+ * share the digit is skipped.
+ */
+void radixSortMorton(std::vector<MortonPrimitive>& items, int codeBits)
+{
+	ThreadPool& pool = getThreadPool();
+	int count = static_cast<int>(items.size());
+	int numChunks = (count + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+	std::vector<MortonPrimitive> scratch(count);
+	std::vector<std::array<int, 256>> chunkOffsets(numChunks);
+
+	for (int shift = 0; shift < codeBits; shift += 8)
+	{
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			std::array<int, 256>& digitCounts = chunkOffsets[chunk];
+			digitCounts.fill(0);
+			int last = std::min(count, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+			for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+				digitCounts[(items[i].code >> shift) & 255]++;
+		});
+
+		bool sharedDigit = false;
+		int offset = 0;
+		for (int digit = 0; digit < 256; digit++)
+		{
+			int digitCount = 0;
+			for (std::array<int, 256>& offsets : chunkOffsets)
+			{
+				int chunkCount = offsets[digit];
+				offsets[digit] = offset;
+				offset += chunkCount;
+				digitCount += chunkCount;
+			}
+			sharedDigit = sharedDigit || digitCount == count;
+		}
+		if (sharedDigit)
+			continue;
+
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			std::array<int, 256>& offsets = chunkOffsets[chunk];
+			int last = std::min(count, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+			for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+				scratch[offsets[(items[i].code >> shift) & 255]++] = items[i];
+		});
+		items.swap(scratch);
+	}
+}
+
+// Internal node of the radix tree over sorted Morton codes, covering sorted positions first .. last
+struct RadixTreeNode
+{
+	int children[2];	// Internal node index, or ~position for a single primitive leaf
+	int first;
+	int last;
+};
+
+// Bits shared by the codes at sorted positions `i` and `j`, -1 if `j` is out of range. Equal codes are told
+// apart by their positions, as if the position was appended to the code
+int commonPrefixLength(const std::vector<MortonPrimitive>& sorted, int i, int j)
+{
+	if (j < 0 || j >= static_cast<int>(sorted.size()))
+		return -1;
+	if (sorted[i].code == sorted[j].code)
+		return 64 + countLeadingZeros(static_cast<uint64_t>(i ^ j));
+	return countLeadingZeros(sorted[i].code ^ sorted[j].code);
+}
+
+/**
+ * @brief Karras' radix tree over `sorted`, internal node `i` is found without looking at any other node.
+ *
+ * Node `i` starts or ends at position `i`, the direction is towards the neighbour sharing the longer prefix.
+ * An exponential then a binary search find the other end, the range of positions sharing a longer prefix
+ * than the neighbour on the other side, and a last binary search splits the range where its common prefix
+ * ends. So every node is built in parallel. Node 0 covers everything and is the root.
+ */
+void buildRadixTree(const std::vector<MortonPrimitive>& sorted, std::vector<RadixTreeNode>& radixNodes)
+{
+	int count = static_cast<int>(sorted.size());
+	radixNodes.resize(std::max(0, count - 1));
+	int numChunks = (count - 1 + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+
+	getThreadPool().parallelFor(numChunks, [&](int chunk)
+	{
+		int last = std::min(count - 1, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+		for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+		{
+			int direction = commonPrefixLength(sorted, i, i + 1) > commonPrefixLength(sorted, i, i - 1) ? 1 : -1;
+			int minPrefix = commonPrefixLength(sorted, i, i - direction);
+
+			int maxLength = 2;
+			while (commonPrefixLength(sorted, i, i + maxLength * direction) > minPrefix)
+				maxLength *= 2;
+			int length = 0;
+			for (int step = maxLength / 2; step >= 1; step /= 2)
+				if (commonPrefixLength(sorted, i, i + (length + step) * direction) > minPrefix)
+					length += step;
+			int j = i + length * direction;
+
+			int nodePrefix = commonPrefixLength(sorted, i, j);
+			int split = 0;
+			int step = length;
+			do
+			{
+				step = (step + 1) / 2;
+				if (commonPrefixLength(sorted, i, i + (split + step) * direction) > nodePrefix)
+					split += step;
+			} while (step > 1);
+			int splitPosition = i + split * direction + std::min(direction, 0);
+
+			RadixTreeNode& node = radixNodes[i];
+			node.first = std::min(i, j);
+			node.last = std::max(i, j);
+			node.children[0] = node.first == splitPosition ? ~splitPosition : splitPosition;
+			node.children[1] = node.last == splitPosition + 1 ? ~(splitPosition + 1) : splitPosition + 1;
+		}
+	});
+}
+
+/**
+ * @brief Surface area heuristic cost of a built tree, relative to a ray that hits the root box.
+ *
+ * Every internal node costs one traversal step and every leaf one intersection per triangle, weighted by
+ * the probability of a ray reaching the node (its area over the root's area). Lower is better.
+ */
+float bvhSAHCost(const std::vector<Node>& nodes)
+{
+	if (nodes.empty())
+		return 0.0f;
+
+	double cost = 0.0;
+	for (const Node& node : nodes)
+	{
+		if (node.childIndex != -1)
+			cost += node.bounds.halfArea();
+		else if (node.triangleCount > 0)
+			cost += double(node.bounds.halfArea()) * node.triangleCount;
+	}
+	return static_cast<float>(cost / nodes[0].bounds.halfArea());
+}
+
+/**
+ * @brief Summary of a finished build, what the per leaf log lines used to be read for.
+ */
+struct BVHBuildStats
+{
+	int numTriangles = 0;
+	int numNodes = 0;
+	int numLeaves = 0;
+	int minLeafTriangles = 0;
+	int maxLeafTriangles = 0;
+	int maxLeafDepth = 0;
+	int depthLimitedLeaves = 0;	// Leaves that could not split further because they reached maxDepth
+	float sahCost = 0.0f;
+	double buildMilliseconds = 0.0;
+	size_t peakBuildBytes = 0;
+	int optimizeIterations = 0;			// Iterations of `BVH::optimize`, 0 if the tree was not optimized
+	float unoptimizedSAHCost = 0.0f;	// SAH cost before `BVH::optimize`
+	double optimizeMilliseconds = 0.0;
+};
+
+using BVHStatsCallback = std::function<void(const BVHBuildStats&)>;
+
+void printBVHBuildStats(const BVHBuildStats& stats)
+{
+	std::cout << "BVH: " << stats.numNodes << " nodes, " << stats.numLeaves << " leaves of " << stats.minLeafTriangles
+		<< " to " << stats.maxLeafTriangles << " triangles (" << float(stats.numTriangles) / std::max(stats.numLeaves, 1)
+		<< " on average), depth " << stats.maxLeafDepth << ", " << stats.depthLimitedLeaves << " leaves at the depth limit, SAH cost "
+		<< stats.sahCost;
+	if (stats.optimizeIterations > 0)
+		std::cout << ", down from " << stats.unoptimizedSAHCost << " after " << stats.optimizeIterations << " optimization iterations in "
+			<< stats.optimizeMilliseconds << " ms";
+	std::cout << std::endl;
+}
+
 class BVH
 {
 public:
 	std::vector<Node> allNodes;
+	int maxDepth;
+	BVHBuilder builder;
+	BVHLayout layout = BVH_LAYOUT_BUILD_ORDER;
+	double buildMilliseconds = 0.0;
+	// Most memory held at once by the build's own buffers, the triangle vectors passed in are not counted
+	size_t peakBuildBytes = 0;
+	float builtSAHCost = 0.0f;	// `bvhSAHCost` right after the build, and `optimize`
+	float sahCost = 0.0f;		// `bvhSAHCost` after the last `refit`
+	int optimizeIterations = 0;
+	float unoptimizedSAHCost = 0.0f;
+	double optimizeMilliseconds = 0.0;
+	// Settings of the build that `update` rebuilds with
+	int maxOptimizeIterations = 0;
+	bool logProgress = true;
 
-	BVH(std::vector<BVHTriangle>& bvhTriangles, std::vector<RTXTriangle>& rtxTriangles)
+	// `triangles` is the render side triangle data (RTXTriangle or IndexedTriangle), it is reordered
+	// together with `bvhTriangles` so that every leaf covers a contiguous range of it. The SBVH builder also
+	// duplicates triangles and only takes RTXTriangles.
+	// A smaller `maxDepth` gives a quicker, coarser tree. `onStats` gets a summary once the build is done.
+	// `optimizeIterations` above 0 runs `optimize` on the finished tree, for long renders of a static scene.
+	// `layout` other than BVH_LAYOUT_BUILD_ORDER puts the nodes in that order with `relayout`.
+	// `logProgress` false skips the "Building BVH..." and build time lines, for the compare tools' tables.
+	template<typename Triangle>
+	BVH(std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles, int maxDepth = MAX_DEPTH,
+		BVHBuilder builder = BVH_BUILDER_BINNED_SAH, const BVHStatsCallback& onStats = nullptr, int optimizeIterations = 0,
+		BVHLayout layout = BVH_LAYOUT_BUILD_ORDER, bool logProgress = true)
+		: maxDepth(maxDepth), builder(builder), layout(layout), maxOptimizeIterations(optimizeIterations), logProgress(logProgress)
 	{
-		std::cout << "Building BVH..." << std::endl;
+		if (logProgress)
+			std::cout << "Building BVH..." << std::endl;
+		auto start = std::chrono::high_resolution_clock::now();
 
 		BoundingBox bounds;
 		for (const BVHTriangle& tri : bvhTriangles)
 			bounds.growToInclude(tri);
 		bounds.expand();
 
-		allNodes.push_back(Node(bounds, 0, static_cast<int>(bvhTriangles.size()), -1));
-		split(0, 1, bvhTriangles, rtxTriangles);
+		int numNodes;
+		if (builder == BVH_BUILDER_SBVH)
+		{
+			if constexpr (std::is_same_v<Triangle, RTXTriangle>)
+				numNodes = buildSpatialSplits(bounds, bvhTriangles, triangles);
+			else
+				throw std::runtime_error("The SBVH builder clips RTXTriangles, build it before indexing the geometry");
+		}
+		else if (builder == BVH_BUILDER_LBVH || builder == BVH_BUILDER_LBVH_TREELETS)
+		{
+			numNodes = buildLinear(bounds, bvhTriangles, triangles);
+		}
+		else
+		{
+			numNodes = buildObjectSplits(bounds, bvhTriangles, triangles);
+		}
+
+		allNodes.resize(numNodes);
+		// Leaves of several triangles can leave a good part of the arena unused, not worth a copy otherwise
+		if (allNodes.capacity() - allNodes.size() > allNodes.size() / 4)
+		{
+			trackBuildMemory(vectorBytes(allNodes) + allNodes.size() * sizeof(Node));
+			allNodes.shrink_to_fit();
+		}
 
-		std::cout << "Built BVH." << std::endl;
-	}
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - start;
+		buildMilliseconds = buildTime.count();
+		if (logProgress)
+			std::cout << "Built BVH in " << buildMilliseconds << " ms, " << peakBuildBytes / (1024.0 * 1024.0)
+				<< " MB of build memory at peak." << std::endl;
 
-	std::string string(BoundingBox bbox)
-	{
-		return "Min: " + str(bbox.min) + "\nMax: " + str(bbox.max) + "\n";
+		builtSAHCost = bvhSAHCost(allNodes);
+		sahCost = builtSAHCost;
+		if (optimizeIterations > 0)
+			optimize(bvhTriangles, triangles, optimizeIterations);
+		else if (layout != BVH_LAYOUT_BUILD_ORDER)
+			relayout(bvhTriangles, triangles, layout);
+		if (onStats)
+			onStats(collectStats(static_cast<int>(triangles.size())));
 	}
 
-	void split(int rootIndex, int depth, std::vector<BVHTriangle>& bvhTriangles, std::vector<RTXTriangle>& rtxTriangles)
+	/**
+	 * @brief Lowers the SAH cost of the built tree, keeping the node format.
+	 *
+	 * Every iteration is a round of `optimizeTreelets` over the whole tree followed by `reinsertNodes`, until
+	 * `maxIterations` or an iteration gains less than `BVH_OPTIMIZE_MIN_GAIN`. The tree is then written out
+	 * again with `relayout`, depth first unless `layout` asks for another order. Both passes can deepen the
+	 * tree past `maxDepth`, where `relayout` collapses it into leaves, and they add up areas in float, so
+	 * an iteration can still raise the SAH cost. Iterations are compared by `relayoutSAHCost`, the cost after
+	 * that collapse, and the tree from before an iteration that raised it is kept, so the final cost never
+	 * exceeds `unoptimizedSAHCost`.
+	 * Top down builders decide the splits near the root with the least information about the rest of the
+	 * tree, that is where most of the gain comes from. Costs several times the build, see `compareBVHOptimizer`.
+	 * @return the number of iterations run
+	 */
+	template<typename Triangle>
+	int optimize(std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles, int maxIterations)
 	{
-		if (depth == MAX_DEPTH || allNodes[rootIndex].triangleCount < 1)
-			return;
-
-		int splitAxis;
-		float splitPos;
-		float cost;
-		chooseSplit(splitAxis, splitPos, cost, allNodes[rootIndex], bvhTriangles);
-		if (cost >= nodeCost(allNodes[rootIndex])) return;
-
-		Node childA = Node(BoundingBox(), allNodes[rootIndex].triangleIndex, 0, -1);
-		Node childB = Node(BoundingBox(), allNodes[rootIndex].triangleIndex, 0, -1);
+		auto start = std::chrono::high_resolution_clock::now();
+		int numNodes = static_cast<int>(allNodes.size());
+		unoptimizedSAHCost = bvhSAHCost(allNodes);
 
-		for (int i = allNodes[rootIndex].triangleIndex; i < allNodes[rootIndex].triangleIndex + allNodes[rootIndex].triangleCount; i++)
+		float cost = unoptimizedSAHCost;
+		std::vector<Node> previousNodes;
+		optimizeIterations = 0;
+		while (optimizeIterations < maxIterations && numNodes > 2)
 		{
-			bool inA = bvhTriangles[i].center[splitAxis] < splitPos;
-			Node* child = inA ? &childA : &childB;
-			child->bounds.growToInclude(bvhTriangles[i]);
-			child->triangleCount += 1;
+			previousNodes = allNodes;
+			trackBuildMemory(vectorBytes(allNodes) + vectorBytes(previousNodes));
+			optimizeTreelets(numNodes, 1);
+			reinsertNodes(numNodes);
+			optimizeIterations++;
 
-			if (inA)
+			float previousCost = cost;
+			cost = relayoutSAHCost();
+			if (cost > previousCost)
 			{
-				int swap = childA.triangleIndex + childA.triangleCount - 1;
-				std::swap(bvhTriangles[i], bvhTriangles[swap]);
-				std::swap(rtxTriangles[i], rtxTriangles[swap]);
-				childB.triangleIndex += 1;
+				allNodes.swap(previousNodes);
+				cost = previousCost;
+				break;
 			}
+			if (cost > previousCost * (1.0f - BVH_OPTIMIZE_MIN_GAIN))
+				break;
 		}
+		std::vector<Node>().swap(previousNodes);
 
-		childA.bounds.expand();
-		childB.bounds.expand();
+		relayout(bvhTriangles, triangles, layout == BVH_LAYOUT_BUILD_ORDER ? BVH_LAYOUT_DEPTH_FIRST : layout);
+		builtSAHCost = bvhSAHCost(allNodes);
+		sahCost = builtSAHCost;
+
+		std::chrono::duration<double, std::milli> optimizeTime = std::chrono::high_resolution_clock::now() - start;
+		optimizeMilliseconds = optimizeTime.count();
+		return optimizeIterations;
+	}
+
+	/**
+	 * @brief Puts the nodes of the built tree in the order of `newLayout`, for fewer cache misses in traversal.
+	 *
+	 * The tree itself is unchanged. Sibling pairs are moved as a unit, and the leaf triangle ranges are put
+	 * in depth first order, reordering `triangles` and `bvhTriangles` like a build does. That is the order
+	 * leaves have in the depth first and van Emde Boas layouts, and it keeps the triangles of every subtree
+	 * next to each other in all of them. See `compareBVHLayouts` for what each order gains.
+	 */
+	template<typename Triangle>
+	void relayout(std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles, BVHLayout newLayout)
+	{
+		std::vector<int> positions;
+		allNodes.resize(relayoutDepthFirst(static_cast<int>(allNodes.size()), positions));
+		std::vector<BVHPrimitive> primitives(positions.size());
+		for (size_t i = 0; i < positions.size(); i++)
+			primitives[i].index = positions[i];
+		gather(triangles, bvhTriangles, primitives);
 
-		if (childA.triangleCount > 0 || childB.triangleCount > 0)
+		if (newLayout == BVH_LAYOUT_BREADTH_FIRST_TOP || newLayout == BVH_LAYOUT_VAN_EMDE_BOAS)
 		{
-			int childAIndex = allNodes.size();
-			allNodes[rootIndex].childIndex = childAIndex;
-			allNodes.push_back(childA);
-			allNodes.push_back(childB);
-			split(childAIndex, depth + 1, bvhTriangles, rtxTriangles);
-			split(childAIndex + 1, depth + 1, bvhTriangles, rtxTriangles);
+			// Sibling pairs by the index of their parent, in their new order
+			std::vector<int> pairs;
+			pairs.reserve(allNodes.size() / 2);
+			if (newLayout == BVH_LAYOUT_BREADTH_FIRST_TOP)
+				appendBreadthFirstTopPairs(pairs);
+			else
+				appendVanEmdeBoasPairs(0, treeHeight(), pairs);
+			reorderPairs(pairs);
 		}
+		layout = newLayout;
+
+		// The levels of the old layout are no longer valid
+		refitLevels.clear();
+		refitLevelStarts.clear();
+	}
+
+	/**
+	 * @brief Refits the tree to moved triangles, the topology stays as it was built.
+	 *
+	 * `bvhTriangles` are the triangles in the order the build left them in, at their new positions. Levels
+	 * are refitted deepest first, the nodes of a level in parallel: a leaf gets the bounds of its triangles
+	 * and an internal node the union of its children, which the deeper level has just updated. Far cheaper
+	 * than a build, but the tree gets worse the further triangles move from where it was built, see `needsRebuild`.
+	 * SBVH leaves get the bounds of their whole triangles back, the clipping is lost with the first refit.
+	 * @return SAH cost of the refitted tree
+	 */
+	float refit(const std::vector<BVHTriangle>& bvhTriangles)
+	{
+		if (refitLevelStarts.empty())
+			findRefitLevels();
 
-		if (allNodes[rootIndex].childIndex == -1)
+		ThreadPool& pool = getThreadPool();
+		double cost = 0.0;
+		for (int level = static_cast<int>(refitLevelStarts.size()) - 2; level >= 0; level--)
 		{
-			std::cout << "Depth: " << depth << std::endl;
-			std::cout << "RTXTriangle index: " << allNodes[rootIndex].triangleIndex << std::endl;
-			std::cout << "RTXTriangle counts: " << allNodes[rootIndex].triangleCount << std::endl;
-			std::cout << ' ' << std::endl;
+			int first = refitLevelStarts[level];
+			int count = refitLevelStarts[level + 1] - first;
+			int numChunks = (count + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+			std::vector<double> chunkCosts(numChunks);
+			pool.parallelFor(numChunks, [&](int chunk)
+			{
+				int last = first + std::min(count, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+				for (int i = first + chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+				{
+					Node& node = allNodes[refitLevels[i]];
+					if (node.childIndex != -1)
+					{
+						node.bounds = allNodes[node.childIndex].bounds;
+						node.bounds.growToInclude(allNodes[node.childIndex + 1].bounds);
+						chunkCosts[chunk] += node.bounds.halfArea();
+						continue;
+					}
+
+					node.bounds = BoundingBox();
+					for (int tri = node.triangleIndex; tri < node.triangleIndex + node.triangleCount; tri++)
+						node.bounds.growToInclude(bvhTriangles[tri]);
+					node.bounds.expand();
+					chunkCosts[chunk] += double(node.bounds.halfArea()) * node.triangleCount;
+				}
+			});
+			cost = std::accumulate(chunkCosts.begin(), chunkCosts.end(), cost);
 		}
+
+		sahCost = static_cast<float>(cost / allNodes[0].bounds.halfArea());
+		return sahCost;
 	}
-};
\ No newline at end of file
+
+	// True once refits have raised the SAH cost past `BVH_REFIT_REBUILD_RATIO` times that of the build
+	bool needsRebuild() const
+	{
+		return sahCost > builtSAHCost * BVH_REFIT_REBUILD_RATIO;
+	}
+
+	/**
+	 * @brief Per frame update for animated geometry: `refit`, or a full rebuild with the same settings once
+	 * `needsRebuild`.
+	 *
+	 * An SBVH is rebuilt with `BVH_BUILDER_BINNED_SAH`, its triangle vectors already hold the duplicates.
+	 * A tree built with `optimizeIterations` is optimized again, which makes that frame several builds long.
+	 * See `compareBVHRefit`.
+	 * @return true if the tree was rebuilt, `triangles` and `bvhTriangles` are in a new order then and need
+	 * to be uploaded again
+	 */
+	template<typename Triangle>
+	bool update(std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles)
+	{
+		refit(bvhTriangles);
+		if (!needsRebuild())
+			return false;
+
+		*this = BVH(bvhTriangles, triangles, maxDepth, builder == BVH_BUILDER_SBVH ? BVH_BUILDER_BINNED_SAH : builder, nullptr,
+			maxOptimizeIterations, layout, logProgress);
+		return true;
+	}
+
+	std::string string(BoundingBox bbox)
+	{
+		return "Min: " + str(bbox.min) + "\nMax: " + str(bbox.max) + "\n";
+	}
+
+	// Picks the split plane of `node`, false if no split is cheaper than keeping it a leaf
+	bool chooseNodeSplit(int& splitAxis, float& splitPos, const Node& node, const std::vector<BVHPrimitive>& primitives,
+		const std::vector<BVHTriangle>& bvhTriangles)
+	{
+		float cost;
+		if (builder == BVH_BUILDER_BINNED_SAH)
+			chooseBinnedSplit(splitAxis, splitPos, cost, node, primitives, bvhTriangles);
+		else
+			chooseSplit(splitAxis, splitPos, cost, node, primitives, bvhTriangles);
+		return cost < nodeCost(node);
+	}
+
+	// Moves the primitives of `node` with a centroid below `splitPos` to the front of its range, in place
+	void partition(const Node& node, int splitAxis, float splitPos, Node& childA, Node& childB,
+		std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& bvhTriangles)
+	{
+		childA = Node(BoundingBox(), node.triangleIndex, 0, -1);
+		childB = Node(BoundingBox(), node.triangleIndex, 0, -1);
+
+		for (int i = node.triangleIndex; i < node.triangleIndex + node.triangleCount; i++)
+		{
+			bool inA = primitives[i].center[splitAxis] < splitPos;
+			Node* child = inA ? &childA : &childB;
+			child->bounds.growToInclude(bvhTriangles[primitives[i].index]);
+			child->triangleCount += 1;
+
+			if (inA)
+			{
+				int swap = childA.triangleIndex + childA.triangleCount - 1;
+				std::swap(primitives[i], primitives[swap]);
+				childB.triangleIndex += 1;
+			}
+		}
+
+		childA.bounds.expand();
+		childB.bounds.expand();
+	}
+
+	/**
+	 * @brief `partition` over the whole thread pool.
+	 *
+	 * Chunks count their primitives on either side first, which gives every chunk its own output ranges.
+	 * The node's primitives are then copied to `scratch` and scattered back, keeping their order within
+	 * each side. `scratch` is as large as `primitives`.
+	 */
+	void partitionParallel(const Node& node, int splitAxis, float splitPos, Node& childA, Node& childB,
+		std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& bvhTriangles, std::vector<BVHPrimitive>& scratch)
+	{
+		struct ChunkSides
+		{
+			BoundingBox boundsA;
+			BoundingBox boundsB;
+			int countA = 0;
+			int countB = 0;
+		};
+
+		ThreadPool& pool = getThreadPool();
+		int numChunks = parallelChunkCount(node);
+		int last = node.triangleIndex + node.triangleCount;
+
+		std::vector<ChunkSides> chunks(numChunks);
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			int chunkFirst = node.triangleIndex + chunk * BVH_PARALLEL_CHUNK_SIZE;
+			int chunkLast = std::min(last, chunkFirst + BVH_PARALLEL_CHUNK_SIZE);
+			ChunkSides& sides = chunks[chunk];
+			for (int i = chunkFirst; i < chunkLast; i++)
+			{
+				if (primitives[i].center[splitAxis] < splitPos)
+				{
+					sides.boundsA.growToInclude(bvhTriangles[primitives[i].index]);
+					sides.countA++;
+				}
+				else
+				{
+					sides.boundsB.growToInclude(bvhTriangles[primitives[i].index]);
+					sides.countB++;
+				}
+			}
+		});
+
+		childA = Node(BoundingBox(), node.triangleIndex, 0, -1);
+		childB = Node(BoundingBox(), node.triangleIndex, 0, -1);
+		std::vector<int> chunkOffsetA(numChunks);
+		std::vector<int> chunkOffsetB(numChunks);
+		for (int chunk = 0; chunk < numChunks; chunk++)
+		{
+			chunkOffsetA[chunk] = childA.triangleCount;
+			chunkOffsetB[chunk] = childB.triangleCount;
+			childA.bounds.growToInclude(chunks[chunk].boundsA);
+			childB.bounds.growToInclude(chunks[chunk].boundsB);
+			childA.triangleCount += chunks[chunk].countA;
+			childB.triangleCount += chunks[chunk].countB;
+		}
+		childB.triangleIndex += childA.triangleCount;
+		childA.bounds.expand();
+		childB.bounds.expand();
+
+		// All on one side, the node stays a leaf and its primitives where they are
+		if (childA.triangleCount == 0 || childB.triangleCount == 0)
+			return;
+
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			int chunkFirst = node.triangleIndex + chunk * BVH_PARALLEL_CHUNK_SIZE;
+			int chunkLast = std::min(last, chunkFirst + BVH_PARALLEL_CHUNK_SIZE);
+			std::copy(primitives.begin() + chunkFirst, primitives.begin() + chunkLast, scratch.begin() + chunkFirst);
+		});
+
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			int chunkFirst = node.triangleIndex + chunk * BVH_PARALLEL_CHUNK_SIZE;
+			int chunkLast = std::min(last, chunkFirst + BVH_PARALLEL_CHUNK_SIZE);
+			int nextA = childA.triangleIndex + chunkOffsetA[chunk];
+			int nextB = childB.triangleIndex + chunkOffsetB[chunk];
+			for (int i = chunkFirst; i < chunkLast; i++)
+				primitives[scratch[i].center[splitAxis] < splitPos ? nextA++ : nextB++] = scratch[i];
+		});
+	}
+
+	/**
+	 * @brief Sequential build of the subtree below `allNodes[rootIndex]`, with an explicit stack instead of recursion.
+	 *
+	 * Children go to the arena from `firstFreeIndex` on, in depth first order: a node's two children, then
+	 * the subtree of the first child, then that of the second.
+	 * @return the index after the last node written
+	 */
+	int buildSubtree(int rootIndex, int rootDepth, int firstFreeIndex, std::vector<BVHPrimitive>& primitives,
+		const std::vector<BVHTriangle>& bvhTriangles)
+	{
+		struct PendingNode
+		{
+			int index;
+			int depth;
+		};
+
+		std::vector<PendingNode> stack = { { rootIndex, rootDepth } };
+		int nextIndex = firstFreeIndex;
+		while (!stack.empty())
+		{
+			PendingNode pending = stack.back();
+			stack.pop_back();
+
+			Node& node = allNodes[pending.index];
+			if (pending.depth == maxDepth || node.triangleCount < 1)
+				continue;
+
+			int splitAxis;
+			float splitPos;
+			if (!chooseNodeSplit(splitAxis, splitPos, node, primitives, bvhTriangles))
+				continue;
+
+			Node childA;
+			Node childB;
+			partition(node, splitAxis, splitPos, childA, childB, primitives, bvhTriangles);
+
+			// A centroid right on a bin boundary can round to the other side, never split off an empty child
+			if (childA.triangleCount == 0 || childB.triangleCount == 0)
+				continue;
+
+			node.childIndex = nextIndex;
+			allNodes[nextIndex] = childA;
+			allNodes[nextIndex + 1] = childB;
+			// The second child waits below the first, so the first child's whole subtree comes before it
+			stack.push_back({ nextIndex + 1, pending.depth + 1 });
+			stack.push_back({ nextIndex, pending.depth + 1 });
+			nextIndex += 2;
+		}
+		return nextIndex;
+	}
+
+	/**
+	 * @brief Binned SAH build spread over the thread pool, starting from the root in `allNodes`.
+	 *
+	 * The top of the tree is split one level at a time. Nodes of at least `BVH_PARALLEL_SPLIT_SIZE` triangles
+	 * are binned and partitioned by the whole pool, the smaller ones of a level are split side by side. Nodes
+	 * under `BVH_SUBTREE_TASK_SIZE` triangles become subtree tasks running `buildSubtree`, each in an arena
+	 * range sized for the 2n - 1 bound of its triangles, so tasks never write the same nodes and need no
+	 * lock. The ranges are then compacted into the depth first order of a sequential build.
+	 *
+	 * Which nodes are split in parallel only depends on their triangle counts and the parallel split picks
+	 * the same plane as `chooseBinnedSplit`, so the nodes match the sequential build and the whole output is
+	 * the same for any number of threads. Only the order of triangles within a leaf can differ.
+	 * @return the number of nodes
+	 */
+	int buildParallel(std::vector<BVHPrimitive>& primitives, const std::vector<BVHTriangle>& bvhTriangles)
+	{
+		ThreadPool& pool = getThreadPool();
+
+		// Top of the tree, childIndex points into topNodes until the final layout is known
+		std::vector<Node> topNodes = { allNodes[0] };
+		std::vector<int> topDepths = { 1 };
+		std::vector<int> subtreeRoots;
+		std::vector<int> frontier;
+
+		auto schedule = [&](int top, std::vector<int>& level)
+		{
+			if (topDepths[top] == maxDepth || topNodes[top].triangleCount < 1)
+				return;
+			if (topNodes[top].triangleCount >= BVH_SUBTREE_TASK_SIZE)
+				level.push_back(top);
+			else
+				subtreeRoots.push_back(top);
+		};
+		schedule(0, frontier);
+
+		// Allocated once the first node needs a parallel partition
+		std::vector<BVHPrimitive> scratch;
+
+		while (!frontier.empty())
+		{
+			int numFrontier = static_cast<int>(frontier.size());
+			std::vector<Node> childrenA(numFrontier);
+			std::vector<Node> childrenB(numFrontier);
+			std::vector<char> isSplit(numFrontier, 0);
+
+			for (int i = 0; i < numFrontier; i++)
+			{
+				const Node& node = topNodes[frontier[i]];
+				if (node.triangleCount < BVH_PARALLEL_SPLIT_SIZE)
+					continue;
+
+				int splitAxis;
+				float splitPos;
+				float cost;
+				chooseBinnedSplitParallel(splitAxis, splitPos, cost, node, primitives, bvhTriangles);
+				if (cost >= nodeCost(node))
+					continue;
+
+				scratch.resize(primitives.size());
+				partitionParallel(node, splitAxis, splitPos, childrenA[i], childrenB[i], primitives, bvhTriangles, scratch);
+				isSplit[i] = childrenA[i].triangleCount > 0 && childrenB[i].triangleCount > 0;
+			}
+
+			pool.parallelFor(numFrontier, [&](int i)
+			{
+				const Node& node = topNodes[frontier[i]];
+				if (node.triangleCount >= BVH_PARALLEL_SPLIT_SIZE)
+					return;
+
+				int splitAxis;
+				float splitPos;
+				if (!chooseNodeSplit(splitAxis, splitPos, node, primitives, bvhTriangles))
+					return;
+				partition(node, splitAxis, splitPos, childrenA[i], childrenB[i], primitives, bvhTriangles);
+				isSplit[i] = childrenA[i].triangleCount > 0 && childrenB[i].triangleCount > 0;
+			});
+
+			std::vector<int> nextFrontier;
+			for (int i = 0; i < numFrontier; i++)
+			{
+				if (!isSplit[i])
+					continue;
+
+				int childIndex = static_cast<int>(topNodes.size());
+				int childDepth = topDepths[frontier[i]] + 1;
+				topNodes[frontier[i]].childIndex = childIndex;
+				topNodes.push_back(childrenA[i]);
+				topNodes.push_back(childrenB[i]);
+				topDepths.push_back(childDepth);
+				topDepths.push_back(childDepth);
+				schedule(childIndex, nextFrontier);
+				schedule(childIndex + 1, nextFrontier);
+			}
+			frontier.swap(nextFrontier);
+		}
+		trackBuildMemory(vectorBytes(primitives) + vectorBytes(scratch) + vectorBytes(topNodes) + vectorBytes(allNodes));
+		std::vector<BVHPrimitive>().swap(scratch);
+
+		int numSubtrees = static_cast<int>(subtreeRoots.size());
+		std::vector<int> subtreeOf(topNodes.size(), -1);
+		for (int subtree = 0; subtree < numSubtrees; subtree++)
+			subtreeOf[subtreeRoots[subtree]] = subtree;
+
+		// Depth first placement: a node's two children are followed by the descendants of the first child,
+		// then those of the second. Run once with every subtree at its 2n - 2 descendant bound to give the
+		// tasks their arena ranges, and once more with the real sizes for the final layout.
+		std::vector<int> topIndex(topNodes.size());
+		std::vector<int> subtreeFirst(numSubtrees);
+		std::vector<int> subtreeSize(numSubtrees);
+		std::vector<int> placementOrder;
+		int numNodes = 1;
+		std::function<void(int)> place = [&](int top)
+		{
+			int child = topNodes[top].childIndex;
+			if (child != -1)
+			{
+				topIndex[child] = numNodes;
+				topIndex[child + 1] = numNodes + 1;
+				numNodes += 2;
+				place(child);
+				place(child + 1);
+			}
+			else if (subtreeOf[top] != -1)
+			{
+				subtreeFirst[subtreeOf[top]] = numNodes;
+				placementOrder.push_back(subtreeOf[top]);
+				numNodes += subtreeSize[subtreeOf[top]];
+			}
+		};
+
+		for (int subtree = 0; subtree < numSubtrees; subtree++)
+			subtreeSize[subtree] = 2 * topNodes[subtreeRoots[subtree]].triangleCount - 2;
+		topIndex[0] = 0;
+		place(0);
+		std::vector<int> reservedTopIndex = topIndex;
+		std::vector<int> reservedFirst = subtreeFirst;
+
+		// Largest subtrees first, so the tasks picked up last are short ones
+		std::vector<int> taskOrder(numSubtrees);
+		std::iota(taskOrder.begin(), taskOrder.end(), 0);
+		std::stable_sort(taskOrder.begin(), taskOrder.end(), [&](int a, int b)
+		{
+			return topNodes[subtreeRoots[a]].triangleCount > topNodes[subtreeRoots[b]].triangleCount;
+		});
+
+		pool.parallelFor(numSubtrees, [&](int task)
+		{
+			int subtree = taskOrder[task];
+			int root = reservedTopIndex[subtreeRoots[subtree]];
+			allNodes[root] = topNodes[subtreeRoots[subtree]];
+			int end = buildSubtree(root, topDepths[subtreeRoots[subtree]], reservedFirst[subtree], primitives, bvhTriangles);
+			subtreeSize[subtree] = end - reservedFirst[subtree];
+		});
+
+		// Subtree roots take the child index their task gave them, still pointing into the reserved range
+		std::vector<int> rootChild(numSubtrees);
+		for (int subtree = 0; subtree < numSubtrees; subtree++)
+			rootChild[subtree] = allNodes[reservedTopIndex[subtreeRoots[subtree]]].childIndex;
+
+		placementOrder.clear();
+		numNodes = 1;
+		place(0);
+
+		// Ranges only ever move towards the front and are moved front to back, so nothing is overwritten before
+		// it was read. Top node slots in between are rewritten afterwards.
+		for (int subtree : placementOrder)
+		{
+			int shift = reservedFirst[subtree] - subtreeFirst[subtree];
+			if (shift == 0)
+				continue;
+			for (int i = 0; i < subtreeSize[subtree]; i++)
+			{
+				Node node = allNodes[reservedFirst[subtree] + i];
+				if (node.childIndex != -1)
+					node.childIndex -= shift;
+				allNodes[subtreeFirst[subtree] + i] = node;
+			}
+		}
+
+		for (size_t top = 0; top < topNodes.size(); top++)
+		{
+			Node node = topNodes[top];
+			if (subtreeOf[top] != -1)
+			{
+				int subtree = subtreeOf[top];
+				int shift = reservedFirst[subtree] - subtreeFirst[subtree];
+				node.childIndex = rootChild[subtree] == -1 ? -1 : rootChild[subtree] - shift;
+			}
+			else if (node.childIndex != -1)
+			{
+				node.childIndex = topIndex[node.childIndex];
+			}
+			allNodes[topIndex[top]] = node;
+		}
+		return numNodes;
+	}
+
+	/**
+	 * @brief Sweep or binned SAH build, every triangle ends up in exactly one leaf.
+	 *
+	 * Splits `BVHPrimitive`s in the node arena and puts the triangles in leaf order at the end.
+	 * @return the number of nodes
+	 */
+	template<typename Triangle>
+	int buildObjectSplits(const BoundingBox& bounds, std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles)
+	{
+		// The build only ever moves these, the triangles are put in leaf order once at the end by `gather`
+		std::vector<BVHPrimitive> primitives;
+		primitives.reserve(bvhTriangles.size());
+		for (const BVHTriangle& tri : bvhTriangles)
+			primitives.push_back({ tri.center, static_cast<int>(primitives.size()) });
+		int numPrimitives = static_cast<int>(primitives.size());
+
+		// Node arena: leaves are never empty, so the tree has at most 2N - 1 nodes
+		allNodes.resize(std::max(1, 2 * numPrimitives - 1));
+		allNodes[0] = Node(bounds, 0, numPrimitives, -1);
+
+		int numNodes;
+		if (builder == BVH_BUILDER_BINNED_SAH && numPrimitives >= BVH_SUBTREE_TASK_SIZE)
+			numNodes = buildParallel(primitives, bvhTriangles);
+		else
+			numNodes = buildSubtree(0, 1, 1, primitives, bvhTriangles);
+		trackBuildMemory(vectorBytes(primitives) + vectorBytes(allNodes));
+
+		gather(triangles, bvhTriangles, primitives);
+		return numNodes;
+	}
+
+	/**
+	 * @brief Sequential SBVH build over `SBVHReference`s.
+	 *
+	 * Every node takes the binned object split over its references first. When the two children of that split
+	 * overlap by more than `SBVH_OVERLAP_THRESHOLD` of the root's surface, as around long thin triangles, a
+	 * spatial split is searched as well and the cheaper of the two is kept. A spatial split clips straddling
+	 * triangles to either side, unless moving one whole to a side is cheaper (reference unsplitting), and
+	 * stops duplicating once `SBVH_DUPLICATION_BUDGET` more references than triangles exist. Leaves then keep
+	 * a copy of each triangle they reference, so leaf ranges stay contiguous and the shader is unchanged.
+	 * @return the number of nodes
+	 */
+	int buildSpatialSplits(const BoundingBox& bounds, std::vector<BVHTriangle>& bvhTriangles, std::vector<RTXTriangle>& triangles)
+	{
+		struct PendingNode
+		{
+			int index;
+			int depth;
+			std::vector<SBVHReference> references;
+		};
+
+		int numTriangles = static_cast<int>(triangles.size());
+		int maxReferences = numTriangles + static_cast<int>(numTriangles * SBVH_DUPLICATION_BUDGET);
+		int numReferences = numTriangles;
+		float overlapThreshold = SBVH_OVERLAP_THRESHOLD * bounds.halfArea();
+
+		allNodes.resize(std::max(1, 2 * maxReferences - 1));
+		allNodes[0] = Node(bounds, 0, numTriangles, -1);
+
+		std::vector<SBVHReference> rootReferences;
+		rootReferences.reserve(numTriangles);
+		for (int i = 0; i < numTriangles; i++)
+		{
+			BoundingBox triangleBounds;
+			triangleBounds.growToInclude(bvhTriangles[i]);
+			rootReferences.push_back({ triangleBounds, i });
+		}
+
+		// Triangle of every leaf slot, a triangle split by spatial splits is in several
+		std::vector<int> leafOrder;
+		leafOrder.reserve(maxReferences);
+		size_t referenceBytes = vectorBytes(rootReferences);
+
+		std::vector<PendingNode> stack;
+		stack.push_back({ 0, 1, std::move(rootReferences) });
+		int nextIndex = 1;
+		while (!stack.empty())
+		{
+			PendingNode pending = std::move(stack.back());
+			stack.pop_back();
+			std::vector<SBVHReference>& references = pending.references;
+			int count = static_cast<int>(references.size());
+
+			Node& node = allNodes[pending.index];
+			node.triangleIndex = static_cast<int>(leafOrder.size());
+			node.triangleCount = count;
+
+			std::vector<SBVHReference> referencesA;
+			std::vector<SBVHReference> referencesB;
+			if (pending.depth < maxDepth && count > 1)
+				splitReferences(node.bounds, references, referencesA, referencesB, numReferences, maxReferences, overlapThreshold, triangles);
+
+			if (referencesA.empty() || referencesB.empty())
+			{
+				for (const SBVHReference& reference : references)
+					leafOrder.push_back(reference.index);
+				referenceBytes -= vectorBytes(references);
+				continue;
+			}
+
+			Node childA(BoundingBox(), 0, 0, -1);
+			Node childB(BoundingBox(), 0, 0, -1);
+			for (const SBVHReference& reference : referencesA)
+				childA.bounds.growToInclude(reference.bounds);
+			for (const SBVHReference& reference : referencesB)
+				childB.bounds.growToInclude(reference.bounds);
+			childA.bounds.expand();
+			childB.bounds.expand();
+
+			node.childIndex = nextIndex;
+			allNodes[nextIndex] = childA;
+			allNodes[nextIndex + 1] = childB;
+
+			referenceBytes += vectorBytes(referencesA) + vectorBytes(referencesB) - vectorBytes(references);
+			stack.push_back({ nextIndex + 1, pending.depth + 1, std::move(referencesB) });
+			stack.push_back({ nextIndex, pending.depth + 1, std::move(referencesA) });
+			nextIndex += 2;
+			trackBuildMemory(vectorBytes(allNodes) + vectorBytes(leafOrder) + referenceBytes);
+		}
+
+		// Children always come after their parent, so one backwards pass counts the references below every node
+		for (int i = nextIndex - 1; i >= 0; i--)
+			if (allNodes[i].childIndex != -1)
+				allNodes[i].triangleCount = allNodes[allNodes[i].childIndex].triangleCount + allNodes[allNodes[i].childIndex + 1].triangleCount;
+
+		std::vector<RTXTriangle> orderedTriangles;
+		std::vector<BVHTriangle> orderedBVHTriangles;
+		orderedTriangles.reserve(leafOrder.size());
+		orderedBVHTriangles.reserve(leafOrder.size());
+		for (int index : leafOrder)
+		{
+			orderedTriangles.push_back(triangles[index]);
+			orderedBVHTriangles.push_back(bvhTriangles[index]);
+		}
+		trackBuildMemory(vectorBytes(allNodes) + vectorBytes(leafOrder) + vectorBytes(orderedTriangles) + vectorBytes(orderedBVHTriangles));
+		triangles.swap(orderedTriangles);
+		bvhTriangles.swap(orderedBVHTriangles);
+		return nextIndex;
+	}
+
+	/**
+	 * @brief Splits the references of one SBVH node into `referencesA` and `referencesB`.
+	 *
+	 * Leaves both empty if keeping the node a leaf is cheapest. `numReferences` grows by every straddling
+	 * triangle that is duplicated.
+	 */
+	void splitReferences(const BoundingBox& nodeBounds, const std::vector<SBVHReference>& references,
+		std::vector<SBVHReference>& referencesA, std::vector<SBVHReference>& referencesB, int& numReferences, int maxReferences,
+		float overlapThreshold, const std::vector<RTXTriangle>& triangles)
+	{
+		int count = static_cast<int>(references.size());
+		float leafCost = nodeCost(nodeBounds.size(), count);
+
+		int objectAxis;
+		float objectPos;
+		float objectCost;
+		chooseReferenceObjectSplit(objectAxis, objectPos, objectCost, references);
+
+		float spatialCost = 1e32f;
+		int spatialAxis = 0;
+		float spatialPos = 0.0f;
+		if (numReferences < maxReferences && objectCost < 1e32f)
+		{
+			BoundingBox boundsA;
+			BoundingBox boundsB;
+			for (const SBVHReference& reference : references)
+				(reference.bounds.center()[objectAxis] < objectPos ? boundsA : boundsB).growToInclude(reference.bounds);
+
+			BoundingBox overlap = intersection(boundsA, boundsB);
+			if (!overlap.isEmpty() && overlap.halfArea() > overlapThreshold)
+				chooseSpatialSplit(spatialAxis, spatialPos, spatialCost, nodeBounds, references, triangles);
+		}
+
+		if (std::min(objectCost, spatialCost) >= leafCost)
+			return;
+
+		if (spatialCost < objectCost)
+		{
+			partitionSpatial(spatialAxis, spatialPos, nodeBounds, references, referencesA, referencesB, numReferences, maxReferences, triangles);
+			if (!referencesA.empty() && !referencesB.empty())
+				return;
+			// Unsplitting moved everything to one side, the object split still separates the node
+			referencesA.clear();
+			referencesB.clear();
+		}
+
+		for (const SBVHReference& reference : references)
+			(reference.bounds.center()[objectAxis] < objectPos ? referencesA : referencesB).push_back(reference);
+	}
+
+	// Sorts references to the sides of the plane at `splitPos`, clipping the ones straddling it
+	void partitionSpatial(int splitAxis, float splitPos, const BoundingBox& nodeBounds, const std::vector<SBVHReference>& references,
+		std::vector<SBVHReference>& referencesA, std::vector<SBVHReference>& referencesB, int& numReferences, int maxReferences,
+		const std::vector<RTXTriangle>& triangles)
+	{
+		BoundingBox boundsA;
+		BoundingBox boundsB;
+		int countA = 0;
+		int countB = 0;
+		std::vector<std::pair<SBVHReference, SBVHReference>> straddling;
+
+		for (const SBVHReference& reference : references)
+		{
+			if (reference.bounds.max[splitAxis] <= splitPos)
+			{
+				boundsA.growToInclude(reference.bounds);
+				countA++;
+			}
+			else if (reference.bounds.min[splitAxis] >= splitPos)
+			{
+				boundsB.growToInclude(reference.bounds);
+				countB++;
+			}
+			else
+			{
+				const RTXTriangle& tri = triangles[reference.index];
+				glm::vec3 corners[3] = { glm::vec3(tri.a), glm::vec3(tri.b), glm::vec3(tri.c) };
+				SBVHReference partA = { clipTriangleBounds(corners, splitAxis, nodeBounds.min[splitAxis], splitPos, reference.bounds), reference.index };
+				SBVHReference partB = { clipTriangleBounds(corners, splitAxis, splitPos, nodeBounds.max[splitAxis], reference.bounds), reference.index };
+				straddling.push_back({ partA, partB });
+			}
+		}
+
+		for (const auto& [partA, partB] : straddling)
+		{
+			if (!partA.bounds.isEmpty())
+				boundsA.growToInclude(partA.bounds);
+			if (!partB.bounds.isEmpty())
+				boundsB.growToInclude(partB.bounds);
+		}
+
+		// Reference unsplitting: a straddling triangle only lands on both sides if that is cheaper than moving it to one
+		int splitCountA = countA + static_cast<int>(straddling.size());
+		int splitCountB = countB + static_cast<int>(straddling.size());
+		for (const auto& [partA, partB] : straddling)
+		{
+			BoundingBox wholeA = boundsA;
+			BoundingBox wholeB = boundsB;
+			wholeA.growToInclude(partB.bounds);
+			wholeB.growToInclude(partA.bounds);
+			BoundingBox whole = partA.bounds;
+			whole.growToInclude(partB.bounds);
+
+			float splitCost = boundsA.halfArea() * splitCountA + boundsB.halfArea() * splitCountB;
+			float costA = wholeA.halfArea() * splitCountA + boundsB.halfArea() * (splitCountB - 1);
+			float costB = boundsA.halfArea() * (splitCountA - 1) + wholeB.halfArea() * splitCountB;
+
+			if (partA.bounds.isEmpty() || partB.bounds.isEmpty())
+			{
+				// Touches the plane without crossing it
+				(partA.bounds.isEmpty() ? referencesB : referencesA).push_back({ whole, partA.index });
+			}
+			else if (splitCost < std::min(costA, costB) && numReferences < maxReferences)
+			{
+				referencesA.push_back(partA);
+				referencesB.push_back(partB);
+				numReferences++;
+			}
+			else
+			{
+				(costA <= costB ? referencesA : referencesB).push_back({ whole, partA.index });
+			}
+		}
+
+		for (const SBVHReference& reference : references)
+		{
+			if (reference.bounds.max[splitAxis] <= splitPos)
+				referencesA.push_back(reference);
+			else if (reference.bounds.min[splitAxis] >= splitPos)
+				referencesB.push_back(reference);
+		}
+	}
+
+	/**
+	 * @brief LBVH build: sorts the centroids along a Morton curve and reads the tree off the sorted codes.
+	 *
+	 * Codes, sort and radix tree run on the thread pool. Writing the nodes out in depth first order and the
+	 * bottom up bounds pass are single walks over the nodes. A node at `maxDepth` becomes a leaf of its whole
+	 * range. `BVH_BUILDER_LBVH_TREELETS` then restructures the tree with `optimizeTreelets`.
+	 * @return the number of nodes
+	 */
+	template<typename Triangle>
+	int buildLinear(const BoundingBox& bounds, std::vector<BVHTriangle>& bvhTriangles, std::vector<Triangle>& triangles)
+	{
+		ThreadPool& pool = getThreadPool();
+		int numPrimitives = static_cast<int>(bvhTriangles.size());
+		allNodes.resize(std::max(1, 2 * numPrimitives - 1));
+		allNodes[0] = Node(bounds, 0, numPrimitives, -1);
+		if (numPrimitives < 2)
+			return 1;
+
+		BoundingBox centroidBounds;
+		for (const BVHTriangle& tri : bvhTriangles)
+			centroidBounds.growToInclude(tri.center);
+		glm::vec3 extent = glm::max(centroidBounds.size(), glm::vec3(1e-30f));
+		int bitsPerAxis = numPrimitives <= LBVH_SHORT_CODE_LIMIT ? 10 : 21;
+
+		std::vector<MortonPrimitive> sorted(numPrimitives);
+		int numChunks = (numPrimitives + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+		pool.parallelFor(numChunks, [&](int chunk)
+		{
+			int last = std::min(numPrimitives, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+			for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+				sorted[i] = { mortonCode((bvhTriangles[i].center - centroidBounds.min) / extent, bitsPerAxis), i };
+		});
+		radixSortMorton(sorted, 3 * bitsPerAxis);
+
+		std::vector<RadixTreeNode> radixNodes;
+		buildRadixTree(sorted, radixNodes);
+		trackBuildMemory(2 * vectorBytes(sorted) + vectorBytes(radixNodes) + vectorBytes(allNodes));
+
+		// `radix` is a RadixTreeNode index, or ~position for a leaf
+		struct PendingNode
+		{
+			int index;
+			int depth;
+			int radix;
+		};
+
+		std::vector<PendingNode> stack = { { 0, 1, 0 } };
+		int nextIndex = 1;
+		while (!stack.empty())
+		{
+			PendingNode pending = stack.back();
+			stack.pop_back();
+
+			Node& node = allNodes[pending.index];
+			if (pending.radix < 0)
+			{
+				node = Node(BoundingBox(), ~pending.radix, 1, -1);
+				continue;
+			}
+
+			const RadixTreeNode& radixNode = radixNodes[pending.radix];
+			node = Node(BoundingBox(), radixNode.first, radixNode.last - radixNode.first + 1, -1);
+			if (pending.depth == maxDepth)
+				continue;
+
+			node.childIndex = nextIndex;
+			stack.push_back({ nextIndex + 1, pending.depth + 1, radixNode.children[1] });
+			stack.push_back({ nextIndex, pending.depth + 1, radixNode.children[0] });
+			nextIndex += 2;
+		}
+		std::vector<RadixTreeNode>().swap(radixNodes);
+		int numNodes = nextIndex;
+
+		int numNodeChunks = (numNodes + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+		pool.parallelFor(numNodeChunks, [&](int chunk)
+		{
+			int last = std::min(numNodes, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+			for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+			{
+				Node& node = allNodes[i];
+				if (node.childIndex != -1)
+					continue;
+				for (int position = node.triangleIndex; position < node.triangleIndex + node.triangleCount; position++)
+					node.bounds.growToInclude(bvhTriangles[sorted[position].index]);
+				node.bounds.expand();
+			}
+		});
+		// Children always come after their parent
+		for (int i = numNodes - 1; i >= 0; i--)
+		{
+			Node& node = allNodes[i];
+			if (node.childIndex == -1)
+				continue;
+			node.bounds = allNodes[node.childIndex].bounds;
+			node.bounds.growToInclude(allNodes[node.childIndex + 1].bounds);
+		}
+
+		std::vector<BVHPrimitive> primitives(numPrimitives);
+		if (builder == BVH_BUILDER_LBVH_TREELETS)
+		{
+			optimizeTreelets(numNodes, LBVH_TREELET_ROUNDS);
+			std::vector<int> positions;
+			numNodes = relayoutDepthFirst(numNodes, positions);
+			for (int i = 0; i < numPrimitives; i++)
+				primitives[i].index = sorted[positions[i]].index;
+		}
+		else
+		{
+			for (int i = 0; i < numPrimitives; i++)
+				primitives[i].index = sorted[i].index;
+		}
+		std::vector<MortonPrimitive>().swap(sorted);
+
+		gather(triangles, bvhTriangles, primitives);
+		return numNodes;
+	}
+
+	/**
+	 * @brief `rounds` of treelet restructuring (Karras and Aila 2013) of the first `numNodes` nodes, bottom up on
+	 * the thread pool.
+	 *
+	 * Every node large enough for the round grows a treelet of up to `BVH_TREELET_SIZE` leaves and gets the
+	 * cheapest topology over them from `restructureTreelet`. A node only rewires its own subtree, so one walk
+	 * per leaf goes up the tree and the second walk to reach a node processes it, once both children are
+	 * final. The walks stop at the first node, which keeps the result independent of the order tasks run in.
+	 * The leaf ranges are out of order afterwards, see `relayoutDepthFirst`.
+	 */
+	void optimizeTreelets(int numNodes, int rounds)
+	{
+		std::vector<int> parents(numNodes, -1);
+		std::vector<float> costs(numNodes);	// SAH cost of the subtree, not relative to the root
+		std::vector<std::atomic<int>> visits(numNodes);
+		std::vector<int> leaves;
+		trackBuildMemory(vectorBytes(allNodes) + vectorBytes(parents) + vectorBytes(costs) + vectorBytes(visits)
+			+ numNodes / 2 * sizeof(int));
+
+		for (int round = 0; round < rounds; round++)
+		{
+			// Restructuring moves leaves and subtrees to other slots, so both are found again every round
+			leaves.clear();
+			for (int i = 0; i < numNodes; i++)
+			{
+				const Node& node = allNodes[i];
+				visits[i].store(0, std::memory_order_relaxed);
+				if (node.childIndex == -1)
+				{
+					leaves.push_back(i);
+					continue;
+				}
+				parents[node.childIndex] = i;
+				parents[node.childIndex + 1] = i;
+			}
+
+			int minTriangles = BVH_TREELET_SIZE << round;
+			int numLeaves = static_cast<int>(leaves.size());
+			int numChunks = (numLeaves + BVH_PARALLEL_CHUNK_SIZE - 1) / BVH_PARALLEL_CHUNK_SIZE;
+			getThreadPool().parallelFor(numChunks, [&](int chunk)
+			{
+				int last = std::min(numLeaves, (chunk + 1) * BVH_PARALLEL_CHUNK_SIZE);
+				for (int i = chunk * BVH_PARALLEL_CHUNK_SIZE; i < last; i++)
+				{
+					const Node& leaf = allNodes[leaves[i]];
+					costs[leaves[i]] = leaf.bounds.halfArea() * leaf.triangleCount;
+					for (int index = parents[leaves[i]]; index != -1; index = parents[index])
+					{
+						if (visits[index].fetch_add(1) == 0)
+							break;
+
+						const Node& node = allNodes[index];
+						costs[index] = node.bounds.halfArea() + costs[node.childIndex] + costs[node.childIndex + 1];
+						if (node.triangleCount >= minTriangles)
+							restructureTreelet(index, parents, costs);
+					}
+				}
+			});
+		}
+	}
+
+	/**
+	 * @brief Rewires the treelet below `root` into its cheapest topology.
+	 *
+	 * The treelet starts as the root's two children and repeatedly opens the leaf with the largest area, the
+	 * one a better topology helps most. The cost of every subset of its leaves is then the cheapest split into
+	 * two smaller subsets plus its own area, found in increasing subset order. If the best cost of the full
+	 * set beats the current one, the treelet's internal nodes are rebuilt in the child pairs they had.
+	 */
+	void restructureTreelet(int root, std::vector<int>& parents, std::vector<float>& costs)
+	{
+		int treeletLeaves[BVH_TREELET_SIZE];
+		int treeletNodes[BVH_TREELET_SIZE - 1];
+		int numLeaves = 2;
+		int numTreeletNodes = 1;
+		treeletNodes[0] = root;
+		treeletLeaves[0] = allNodes[root].childIndex;
+		treeletLeaves[1] = allNodes[root].childIndex + 1;
+		while (numLeaves < BVH_TREELET_SIZE)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (int i = 0; i < numLeaves; i++)
+			{
+				const Node& node = allNodes[treeletLeaves[i]];
+				if (node.childIndex != -1 && node.bounds.halfArea() > largestArea)
+				{
+					largest = i;
+					largestArea = node.bounds.halfArea();
+				}
+			}
+			if (largest == -1)
+				break;
+
+			int opened = treeletLeaves[largest];
+			treeletNodes[numTreeletNodes++] = opened;
+			treeletLeaves[largest] = allNodes[opened].childIndex;
+			treeletLeaves[numLeaves++] = allNodes[opened].childIndex + 1;
+		}
+		if (numLeaves < 3)
+			return;
+
+		const int maxSubsets = 1 << BVH_TREELET_SIZE;
+		BoundingBox subsetBounds[maxSubsets];
+		float subsetCosts[maxSubsets];
+		int subsetCounts[maxSubsets];
+		int bestPartitions[maxSubsets];
+
+		int fullSet = (1 << numLeaves) - 1;
+		for (int subset = 1; subset <= fullSet; subset++)
+		{
+			int lowest = subset & -subset;
+			int leaf = 0;
+			while ((1 << leaf) != lowest)
+				leaf++;
+			const Node& leafNode = allNodes[treeletLeaves[leaf]];
+
+			int rest = subset ^ lowest;
+			if (rest == 0)
+			{
+				subsetBounds[subset] = leafNode.bounds;
+				subsetCounts[subset] = leafNode.triangleCount;
+				subsetCosts[subset] = costs[treeletLeaves[leaf]];
+				continue;
+			}
+			subsetBounds[subset] = subsetBounds[rest];
+			subsetBounds[subset].growToInclude(leafNode.bounds);
+			subsetCounts[subset] = subsetCounts[rest] + leafNode.triangleCount;
+
+			// Only partitions holding the lowest leaf, so every split is tried once
+			float bestCost = 1e32f;
+			for (int others = (rest - 1) & rest; ; others = (others - 1) & rest)
+			{
+				int partition = others | lowest;
+				float cost = subsetCosts[partition] + subsetCosts[subset ^ partition];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestPartitions[subset] = partition;
+				}
+				if (others == 0)
+					break;
+			}
+			subsetCosts[subset] = subsetBounds[subset].halfArea() + bestCost;
+		}
+		if (subsetCosts[fullSet] >= costs[root])
+			return;
+
+		Node leafNodes[BVH_TREELET_SIZE];
+		float leafCosts[BVH_TREELET_SIZE];
+		for (int i = 0; i < numLeaves; i++)
+		{
+			leafNodes[i] = allNodes[treeletLeaves[i]];
+			leafCosts[i] = costs[treeletLeaves[i]];
+		}
+		int childPairs[BVH_TREELET_SIZE - 1];
+		for (int i = 0; i < numTreeletNodes; i++)
+			childPairs[i] = allNodes[treeletNodes[i]].childIndex;
+
+		std::pair<int, int> stack[BVH_TREELET_SIZE];
+		int stackSize = 0;
+		int numPairs = 0;
+		stack[stackSize++] = { root, fullSet };
+		while (stackSize > 0)
+		{
+			auto [index, subset] = stack[--stackSize];
+			Node& node = allNodes[index];
+			node.childIndex = childPairs[numPairs++];
+			node.bounds = subsetBounds[subset];
+			node.triangleCount = subsetCounts[subset];
+			costs[index] = subsetCosts[subset];
+
+			int sides[2] = { bestPartitions[subset], subset ^ bestPartitions[subset] };
+			for (int side = 0; side < 2; side++)
+			{
+				int child = node.childIndex + side;
+				parents[child] = index;
+				if (sides[side] & (sides[side] - 1))
+				{
+					stack[stackSize++] = { child, sides[side] };
+					continue;
+				}
+
+				int leaf = 0;
+				while ((1 << leaf) != sides[side])
+					leaf++;
+				allNodes[child] = leafNodes[leaf];
+				costs[child] = leafCosts[leaf];
+				if (allNodes[child].childIndex != -1)
+				{
+					parents[allNodes[child].childIndex] = child;
+					parents[allNodes[child].childIndex + 1] = child;
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Node reinsertion (Bittner et al. 2013) on the first `numNodes` nodes.
+	 *
+	 * The `BVH_REINSERTION_FRACTION` of nodes with the largest area are taken out one after the other, with
+	 * their subtree, and put back as the sibling of the node where they add the least area to the tree. The
+	 * sibling they leave takes their parent's place. The search runs from the root, best first by the area
+	 * the node's ancestors would grow by, and stops once that alone costs more than the best place so far.
+	 * Where the node was is one of the places searched, so in exact arithmetic no move raises the SAH cost,
+	 * only float rounding of the areas can. Sequential, each move changes the areas the next search sees.
+	 * Leaf ranges are out of order afterwards, like after treelets, and moves can put nodes below `maxDepth`.
+	 */
+	void reinsertNodes(int numNodes)
+	{
+		std::vector<int> parents(numNodes, -1);
+		std::vector<std::pair<float, int>> candidates;
+		candidates.reserve(numNodes - 1);
+		for (int i = 0; i < numNodes; i++)
+		{
+			const Node& node = allNodes[i];
+			if (i != 0)
+				candidates.push_back({ node.bounds.halfArea(), i });
+			if (node.childIndex != -1)
+			{
+				parents[node.childIndex] = i;
+				parents[node.childIndex + 1] = i;
+			}
+		}
+		int numCandidates = std::max(1, static_cast<int>(candidates.size() * BVH_REINSERTION_FRACTION));
+		std::partial_sort(candidates.begin(), candidates.begin() + numCandidates, candidates.end(),
+			[](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+		trackBuildMemory(vectorBytes(allNodes) + vectorBytes(parents) + vectorBytes(candidates));
+
+		// Moves change which node is in which slot, a candidate is only a slot by then. Any slot but the root will do
+		using SearchEntry = std::pair<float, int>;
+		std::vector<SearchEntry> search;
+		for (int c = 0; c < numCandidates; c++)
+		{
+			int index = candidates[c].second;
+			int parent = parents[index];
+			int pair = allNodes[parent].childIndex;
+			int sibling = pair == index ? pair + 1 : pair;
+			const Node moved = allNodes[index];
+
+			allNodes[parent] = allNodes[sibling];
+			if (allNodes[parent].childIndex != -1)
+			{
+				parents[allNodes[parent].childIndex] = parent;
+				parents[allNodes[parent].childIndex + 1] = parent;
+			}
+			refitAncestors(parents[parent], parents);
+
+			float movedArea = moved.bounds.halfArea();
+			float bestCost = 1e32f;
+			int best = 0;
+			search.assign(1, { 0.0f, 0 });
+			while (!search.empty())
+			{
+				std::pop_heap(search.begin(), search.end(), std::greater<SearchEntry>());
+				auto [inducedCost, candidate] = search.back();
+				search.pop_back();
+				if (inducedCost + movedArea >= bestCost)
+					break;
+
+				const Node& node = allNodes[candidate];
+				BoundingBox merged = node.bounds;
+				merged.growToInclude(moved.bounds);
+				float cost = inducedCost + merged.halfArea();
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					best = candidate;
+				}
+
+				float childInducedCost = cost - node.bounds.halfArea();
+				if (node.childIndex != -1 && childInducedCost + movedArea < bestCost)
+				{
+					search.push_back({ childInducedCost, node.childIndex });
+					std::push_heap(search.begin(), search.end(), std::greater<SearchEntry>());
+					search.push_back({ childInducedCost, node.childIndex + 1 });
+					std::push_heap(search.begin(), search.end(), std::greater<SearchEntry>());
+				}
+			}
+
+			// The sibling's slot is free, it takes the node at `best`, which becomes their parent
+			allNodes[sibling] = allNodes[best];
+			if (allNodes[sibling].childIndex != -1)
+			{
+				parents[allNodes[sibling].childIndex] = sibling;
+				parents[allNodes[sibling].childIndex + 1] = sibling;
+			}
+			parents[sibling] = best;
+			parents[index] = best;
+
+			BoundingBox merged = allNodes[sibling].bounds;
+			merged.growToInclude(moved.bounds);
+			allNodes[best] = Node(merged, allNodes[sibling].triangleIndex, allNodes[sibling].triangleCount + moved.triangleCount, pair);
+			refitAncestors(parents[best], parents);
+		}
+	}
+
+	// Bounds and triangle counts of `index` and every node above it from their children, after a move below
+	void refitAncestors(int index, const std::vector<int>& parents)
+	{
+		for (; index != -1; index = parents[index])
+		{
+			Node& node = allNodes[index];
+			node.bounds = allNodes[node.childIndex].bounds;
+			node.bounds.growToInclude(allNodes[node.childIndex + 1].bounds);
+			node.triangleCount = allNodes[node.childIndex].triangleCount + allNodes[node.childIndex + 1].triangleCount;
+		}
+	}
+
+	/**
+	 * @brief Writes the first `numNodes` nodes out again in depth first order, with contiguous leaf ranges.
+	 *
+	 * Subtrees reaching below `maxDepth` become single leaves.
+	 * @param positions Output, for every new triangle position the old one
+	 * @return the number of nodes
+	 */
+	int relayoutDepthFirst(int numNodes, std::vector<int>& positions)
+	{
+		struct PendingNode
+		{
+			int from;
+			int to;
+			int depth;
+		};
+
+		std::vector<Node> nodes(numNodes);
+		positions.clear();
+		positions.reserve(allNodes[0].triangleCount);
+		trackBuildMemory(vectorBytes(allNodes) + vectorBytes(nodes) + vectorBytes(positions));
+
+		std::vector<PendingNode> stack = { { 0, 0, 1 } };
+		std::vector<int> subtree;
+		int nextIndex = 1;
+		while (!stack.empty())
+		{
+			PendingNode pending = stack.back();
+			stack.pop_back();
+
+			const Node& node = allNodes[pending.from];
+			nodes[pending.to] = Node(node.bounds, static_cast<int>(positions.size()), node.triangleCount, -1);
+			if (node.childIndex != -1 && pending.depth < maxDepth)
+			{
+				nodes[pending.to].childIndex = nextIndex;
+				stack.push_back({ node.childIndex + 1, nextIndex + 1, pending.depth + 1 });
+				stack.push_back({ node.childIndex, nextIndex, pending.depth + 1 });
+				nextIndex += 2;
+				continue;
+			}
+
+			subtree.assign(1, pending.from);
+			while (!subtree.empty())
+			{
+				const Node& below = allNodes[subtree.back()];
+				subtree.pop_back();
+				if (below.childIndex != -1)
+				{
+					subtree.push_back(below.childIndex + 1);
+					subtree.push_back(below.childIndex);
+					continue;
+				}
+				for (int position = below.triangleIndex; position < below.triangleIndex + below.triangleCount; position++)
+					positions.push_back(position);
+			}
+		}
+
+		allNodes = std::move(nodes);
+		return nextIndex;
+	}
+
+	// `bvhSAHCost` of the tree as `relayoutDepthFirst` writes it, subtrees reaching below `maxDepth` as single leaves
+	float relayoutSAHCost() const
+	{
+		double cost = 0.0;
+		std::vector<std::pair<int, int>> stack = { { 0, 1 } };
+		while (!stack.empty())
+		{
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+			const Node& node = allNodes[index];
+			if (node.childIndex != -1 && depth < maxDepth)
+			{
+				cost += node.bounds.halfArea();
+				stack.push_back({ node.childIndex, depth + 1 });
+				stack.push_back({ node.childIndex + 1, depth + 1 });
+			}
+			else if (node.triangleCount > 0)
+				cost += double(node.bounds.halfArea()) * node.triangleCount;
+		}
+		return static_cast<float>(cost / allNodes[0].bounds.halfArea());
+	}
+
+	// Levels of internal nodes on the longest path from the root, 0 for a single leaf
+	int treeHeight() const
+	{
+		int height = 0;
+		std::vector<std::pair<int, int>> stack = { { 0, 0 } };
+		while (!stack.empty())
+		{
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+			const Node& node = allNodes[index];
+			if (node.childIndex == -1)
+				continue;
+			height = std::max(height, depth + 1);
+			stack.push_back({ node.childIndex, depth + 1 });
+			stack.push_back({ node.childIndex + 1, depth + 1 });
+		}
+		return height;
+	}
+
+	// Top levels breadth first, then the subtree of every node below them depth first, left to right
+	void appendBreadthFirstTopPairs(std::vector<int>& pairs) const
+	{
+		std::vector<int> level = { 0 };
+		std::vector<int> nextLevel;
+		for (int depth = 0; depth < BVH_LAYOUT_TOP_LEVELS && !level.empty(); depth++)
+		{
+			nextLevel.clear();
+			for (int index : level)
+			{
+				const Node& node = allNodes[index];
+				if (node.childIndex == -1)
+					continue;
+				pairs.push_back(index);
+				nextLevel.push_back(node.childIndex);
+				nextLevel.push_back(node.childIndex + 1);
+			}
+			std::swap(level, nextLevel);
+		}
+
+		std::vector<int> stack;
+		for (int subtreeRoot : level)
+		{
+			stack.assign(1, subtreeRoot);
+			while (!stack.empty())
+			{
+				int index = stack.back();
+				stack.pop_back();
+				const Node& node = allNodes[index];
+				if (node.childIndex == -1)
+					continue;
+				pairs.push_back(index);
+				stack.push_back(node.childIndex + 1);
+				stack.push_back(node.childIndex);
+			}
+		}
+	}
+
+	/**
+	 * @brief Van Emde Boas order of the `levels` levels of internal nodes below `root`.
+	 *
+	 * The top half of the levels is laid out first, then the subtree below each node it ends in, left to
+	 * right, every part recursively the same way. Any block of nodes the size of a cache line or page then
+	 * holds a subtree of about that size, whatever the cache, so a path from the root crosses few blocks.
+	 */
+	void appendVanEmdeBoasPairs(int root, int levels, std::vector<int>& pairs) const
+	{
+		if (levels == 0 || allNodes[root].childIndex == -1)
+			return;
+		if (levels == 1)
+		{
+			pairs.push_back(root);
+			return;
+		}
+
+		int topLevels = levels / 2;
+		appendVanEmdeBoasPairs(root, topLevels, pairs);
+
+		std::vector<int> bottomRoots = { root };
+		std::vector<int> nextRoots;
+		for (int depth = 0; depth < topLevels; depth++)
+		{
+			nextRoots.clear();
+			for (int index : bottomRoots)
+			{
+				const Node& node = allNodes[index];
+				if (node.childIndex == -1)
+					continue;
+				nextRoots.push_back(node.childIndex);
+				nextRoots.push_back(node.childIndex + 1);
+			}
+			std::swap(bottomRoots, nextRoots);
+		}
+		for (int bottomRoot : bottomRoots)
+			appendVanEmdeBoasPairs(bottomRoot, levels - topLevels, pairs);
+	}
+
+	// Moves the children of every node in `pairs` to the next free pair of slots after the root, in that order
+	void reorderPairs(const std::vector<int>& pairs)
+	{
+		std::vector<int> newIndices(allNodes.size());
+		newIndices[0] = 0;
+		int nextIndex = 1;
+		for (int parent : pairs)
+		{
+			newIndices[allNodes[parent].childIndex] = nextIndex;
+			newIndices[allNodes[parent].childIndex + 1] = nextIndex + 1;
+			nextIndex += 2;
+		}
+
+		std::vector<Node> nodes(allNodes.size());
+		for (size_t i = 0; i < allNodes.size(); i++)
+		{
+			Node node = allNodes[i];
+			if (node.childIndex != -1)
+				node.childIndex = newIndices[node.childIndex];
+			nodes[newIndices[i]] = node;
+		}
+		allNodes = std::move(nodes);
+	}
+
+	// Walks the finished tree, `numTriangles` is the size of the root
+	BVHBuildStats collectStats(int numTriangles) const
+	{
+		BVHBuildStats stats;
+		stats.numTriangles = numTriangles;
+		stats.numNodes = static_cast<int>(allNodes.size());
+		stats.minLeafTriangles = numTriangles;
+		stats.sahCost = sahCost;
+		stats.buildMilliseconds = buildMilliseconds;
+		stats.peakBuildBytes = peakBuildBytes;
+		stats.optimizeIterations = optimizeIterations;
+		stats.unoptimizedSAHCost = unoptimizedSAHCost;
+		stats.optimizeMilliseconds = optimizeMilliseconds;
+
+		std::vector<std::pair<int, int>> stack = { { 0, 1 } };
+		while (!stack.empty())
+		{
+			auto [index, depth] = stack.back();
+			stack.pop_back();
+
+			const Node& node = allNodes[index];
+			if (node.childIndex != -1)
+			{
+				stack.push_back({ node.childIndex + 1, depth + 1 });
+				stack.push_back({ node.childIndex, depth + 1 });
+				continue;
+			}
+
+			stats.numLeaves++;
+			stats.minLeafTriangles = std::min(stats.minLeafTriangles, node.triangleCount);
+			stats.maxLeafTriangles = std::max(stats.maxLeafTriangles, node.triangleCount);
+			stats.maxLeafDepth = std::max(stats.maxLeafDepth, depth);
+			if (depth == maxDepth && node.triangleCount > 1)
+				stats.depthLimitedLeaves++;
+		}
+		return stats;
+	}
+
+private:
+	// Nodes grouped by depth for `refit`, level i is refitLevels[refitLevelStarts[i] .. refitLevelStarts[i + 1]]
+	std::vector<int> refitLevels;
+	std::vector<int> refitLevelStarts;
+
+	void findRefitLevels()
+	{
+		refitLevels.assign(1, 0);
+		refitLevelStarts.assign(1, 0);
+		for (size_t first = 0; first < refitLevels.size(); first = refitLevelStarts.back())
+		{
+			size_t last = refitLevels.size();
+			refitLevelStarts.push_back(static_cast<int>(last));
+			for (size_t i = first; i < last; i++)
+			{
+				const Node& node = allNodes[refitLevels[i]];
+				if (node.childIndex == -1)
+					continue;
+				refitLevels.push_back(node.childIndex);
+				refitLevels.push_back(node.childIndex + 1);
+			}
+		}
+	}
+
+	template<typename T>
+	static size_t vectorBytes(const std::vector<T>& items)
+	{
+		return items.capacity() * sizeof(T);
+	}
+
+	void trackBuildMemory(size_t bytes)
+	{
+		peakBuildBytes = std::max(peakBuildBytes, bytes);
+	}
+
+	/**
+	 * @brief Puts `triangles` and `bvhTriangles` in leaf order, the order of `primitives`.
+	 *
+	 * Follows the cycles of the permutation, so every triangle is moved once and no copy of either vector
+	 * is needed. `primitives` is used up, each index is pointed at its own slot once that slot is filled.
+	 */
+	template<typename Triangle>
+	static void gather(std::vector<Triangle>& triangles, std::vector<BVHTriangle>& bvhTriangles, std::vector<BVHPrimitive>& primitives)
+	{
+		int numPrimitives = static_cast<int>(primitives.size());
+		for (int start = 0; start < numPrimitives; start++)
+		{
+			if (primitives[start].index == start)
+				continue;
+
+			Triangle triangle = triangles[start];
+			BVHTriangle bvhTriangle = bvhTriangles[start];
+			int slot = start;
+			while (primitives[slot].index != start)
+			{
+				int source = primitives[slot].index;
+				triangles[slot] = triangles[source];
+				bvhTriangles[slot] = bvhTriangles[source];
+				primitives[slot].index = slot;
+				slot = source;
+			}
+			triangles[slot] = triangle;
+			bvhTriangles[slot] = bvhTriangle;
+			primitives[slot].index = slot;
+		}
+	}
+};
+
+/**
+ * @brief Converts the binary tree below `nodes[root]` to ChildBoundsNodes appended to `childBoundsNodes`.
+ *
+ * Only internal nodes become ChildBoundsNodes, leaves live on as the triangle ranges of their parent's
+ * children, so there are half as many nodes of a third more bytes. A root that is a leaf becomes the only
+ * child of its node, empty leaves become unused children.
+ * @return index of the root in `childBoundsNodes`
+ */
+int makeChildBoundsBVH(const Node* nodes, int root, std::vector<ChildBoundsNode>& childBoundsNodes)
+{
+	// `from` is the binary node whose children the ChildBoundsNode at `to` holds
+	struct PendingNode
+	{
+		int from;
+		int to;
+	};
+
+	int childBoundsRoot = static_cast<int>(childBoundsNodes.size());
+	childBoundsNodes.emplace_back();
+	std::vector<PendingNode> stack = { { root, childBoundsRoot } };
+	while (!stack.empty())
+	{
+		PendingNode pending = stack.back();
+		stack.pop_back();
+
+		const Node& from = nodes[pending.from];
+		int children[2] = { from.childIndex, from.childIndex + 1 };
+		if (from.childIndex == -1)
+		{
+			children[0] = pending.from;
+			children[1] = -1;
+		}
+
+		ChildBoundsNode childBoundsNode;
+		for (int i = 0; i < 2; i++)
+		{
+			if (children[i] == -1)
+				continue;
+
+			const Node& node = nodes[children[i]];
+			BVHChild& child = childBoundsNode.children[i];
+			if (node.childIndex != -1)
+			{
+				child.index = static_cast<int>(childBoundsNodes.size());
+				child.count = 0;
+				childBoundsNodes.emplace_back();
+				stack.push_back({ children[i], child.index });
+			}
+			else if (node.triangleCount > 0)
+			{
+				child.index = node.triangleIndex;
+				child.count = node.triangleCount;
+			}
+			else
+				continue;
+			child.boundsMin = node.bounds.min;
+			child.boundsMax = node.bounds.max;
+		}
+		childBoundsNodes[pending.to] = childBoundsNode;
+	}
+	return childBoundsRoot;
+}
+
+/**
+ * @brief Builds the BVH of every model folder in `dataFolderPath` with each builder and prints build time, SAH cost
+ * and the peak memory of the build's own buffers.
+ *
+ * Every build starts from the same parsed triangles and runs with progress logging off so it does not end up in
+ * the timings.
+ */
+void compareBVHBuilders(const std::string& dataFolderPath)
+{
+	const BVHBuilder builders[] = { BVH_BUILDER_SWEEP, BVH_BUILDER_BINNED_SAH, BVH_BUILDER_SBVH, BVH_BUILDER_LBVH, BVH_BUILDER_LBVH_TREELETS };
+	const char* builderNames[] = { "sweep", "binned", "sbvh", "lbvh", "treelets" };
+	const int numBuilders = sizeof(builders) / sizeof(builders[0]);
+
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles";
+	for (int b = 0; b < numBuilders; b++)
+		std::cout << std::setw(12) << (std::string(builderNames[b]) + " ms") << std::setw(14) << (std::string(builderNames[b]) + " SAH")
+			<< std::setw(14) << (std::string(builderNames[b]) + " nodes") << std::setw(12) << (std::string(builderNames[b]) + " MB");
+	std::cout << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size() << std::flush;
+		for (int b = 0; b < numBuilders; b++)
+		{
+			std::vector<RTXTriangle> rtxCopy = rtxTriangles;
+			std::vector<BVHTriangle> bvhCopy = bvhTriangles;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			BVH bvh(bvhCopy, rtxCopy, MAX_DEPTH, builders[b], nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+			std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - start;
+
+			std::cout << std::fixed << std::setprecision(2) << std::setw(12) << buildTime.count()
+				<< std::setw(14) << bvhSAHCost(bvh.allNodes) << std::setw(14) << bvh.allNodes.size()
+				<< std::setw(12) << bvh.peakBuildBytes / (1024.0 * 1024.0) << std::flush;
+		}
+		std::cout << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <map>
+#include <vector>
+#include <string>
+#include <filesystem>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+#include <Assets/headers/gltfLoader.h>
+
+// `reportBVHQuality` flags a model whose SAH cost rose by more than this fraction since the last report
+const float BVH_REPORT_REGRESSION_THRESHOLD = 0.01f;
+
+/**
+ * @brief Quality of a built BVH, everything `makeBVHReport` reads off the nodes.
+ *
+ * Only needs the nodes, so it works the same on a fresh build, a scene cache or a TLAS.
+ */
+struct BVHReport
+{
+	int numNodes = 0;
+	int numLeaves = 0;
+	int numTriangleRefs = 0;		// Triangles summed over the leaves, above the triangle count where the SBVH duplicated
+	int maxDepth = 0;
+	int depthLimitedLeaves = 0;		// Leaves of more than one triangle at the `maxDepth` passed in
+	float sahCost = 0.0f;
+	// Area of the overlap of two siblings over the area of their parent, averaged over the internal nodes.
+	// Rays through the overlap have to visit both children
+	float siblingOverlap = 0.0f;
+	// The same summed over all internal nodes before dividing, large nodes weigh in more like they do for rays
+	float weightedSiblingOverlap = 0.0f;
+	size_t nodeBytes = 0;
+	size_t triangleBytes = 0;		// `numTriangleRefs` triangles of the size passed in
+	std::map<int, int> depthHistogram;		// Leaves per depth, the root is at depth 1
+	std::map<int, int> leafSizeHistogram;	// Leaves per triangle count
+};
+
+const char* bvhBuilderName(BVHBuilder builder)
+{
+	switch (builder)
+	{
+	case BVH_BUILDER_SWEEP: return "sweep";
+	case BVH_BUILDER_BINNED_SAH: return "binned";
+	case BVH_BUILDER_SBVH: return "sbvh";
+	case BVH_BUILDER_LBVH: return "lbvh";
+	case BVH_BUILDER_LBVH_TREELETS: return "treelets";
+	}
+	return "unknown";
+}
+
+/**
+ * @brief Walks `nodes` from the root and measures the tree.
+ *
+ * @param triangleSize Bytes per triangle as uploaded, sizeof(RTXTriangle) before the geometry is indexed
+ * @param maxDepth Depth limit of the build, to count the leaves it cut short
+ */
+BVHReport makeBVHReport(const std::vector<Node>& nodes, size_t triangleSize, int maxDepth = MAX_DEPTH)
+{
+	BVHReport report;
+	if (nodes.empty())
+		return report;
+
+	report.numNodes = static_cast<int>(nodes.size());
+	report.sahCost = bvhSAHCost(nodes);
+	report.nodeBytes = nodes.size() * sizeof(Node);
+
+	double overlapRatios = 0.0;
+	double overlapArea = 0.0;
+	double parentArea = 0.0;
+	int numInternalNodes = 0;
+
+	std::vector<std::pair<int, int>> stack = { { 0, 1 } };
+	while (!stack.empty())
+	{
+		auto [index, depth] = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes[index];
+		if (node.childIndex != -1)
+		{
+			BoundingBox overlap = intersection(nodes[node.childIndex].bounds, nodes[node.childIndex + 1].bounds);
+			float area = overlap.isEmpty() ? 0.0f : overlap.halfArea();
+			float nodeArea = node.bounds.halfArea();
+			if (nodeArea > 0.0f)
+				overlapRatios += area / nodeArea;
+			overlapArea += area;
+			parentArea += nodeArea;
+			numInternalNodes++;
+
+			stack.push_back({ node.childIndex + 1, depth + 1 });
+			stack.push_back({ node.childIndex, depth + 1 });
+			continue;
+		}
+
+		report.numLeaves++;
+		report.numTriangleRefs += node.triangleCount;
+		report.maxDepth = std::max(report.maxDepth, depth);
+		if (depth == maxDepth && node.triangleCount > 1)
+			report.depthLimitedLeaves++;
+		report.depthHistogram[depth]++;
+		report.leafSizeHistogram[node.triangleCount]++;
+	}
+
+	if (numInternalNodes > 0)
+		report.siblingOverlap = static_cast<float>(overlapRatios / numInternalNodes);
+	if (parentArea > 0.0)
+		report.weightedSiblingOverlap = static_cast<float>(overlapArea / parentArea);
+	report.triangleBytes = report.numTriangleRefs * triangleSize;
+	return report;
+}
+
+std::string jsonString(const std::string& text)
+{
+	std::ostringstream out;
+	out << '"';
+	for (char ch : text)
+	{
+		if (ch == '"' || ch == '\\')
+			out << '\\' << ch;
+		else if (static_cast<unsigned char>(ch) < 0x20)
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(ch) << std::dec << std::setfill(' ');
+		else
+			out << ch;
+	}
+	out << '"';
+	return out.str();
+}
+
+// Writes the members of `report` as JSON object members, one per line after `indent`, no braces
+void writeBVHReportJson(std::ostream& out, const BVHReport& report, const std::string& indent)
+{
+	auto histogram = [&](const std::map<int, int>& counts)
+	{
+		out << "{";
+		bool first = true;
+		for (const auto& [key, count] : counts)
+		{
+			out << (first ? " " : ", ") << '"' << key << "\": " << count;
+			first = false;
+		}
+		out << " }";
+	};
+
+	out << std::setprecision(7);
+	out << indent << "\"sahCost\": " << report.sahCost << ",\n";
+	out << indent << "\"nodes\": " << report.numNodes << ",\n";
+	out << indent << "\"leaves\": " << report.numLeaves << ",\n";
+	out << indent << "\"triangleRefs\": " << report.numTriangleRefs << ",\n";
+	out << indent << "\"maxDepth\": " << report.maxDepth << ",\n";
+	out << indent << "\"depthLimitedLeaves\": " << report.depthLimitedLeaves << ",\n";
+	out << indent << "\"siblingOverlap\": " << report.siblingOverlap << ",\n";
+	out << indent << "\"weightedSiblingOverlap\": " << report.weightedSiblingOverlap << ",\n";
+	out << indent << "\"nodeBytes\": " << report.nodeBytes << ",\n";
+	out << indent << "\"triangleBytes\": " << report.triangleBytes << ",\n";
+	out << indent << "\"depthHistogram\": ";
+	histogram(report.depthHistogram);
+	out << ",\n" << indent << "\"leafSizeHistogram\": ";
+	histogram(report.leafSizeHistogram);
+	out << "\n";
+}
+
+// bvhReport.json -> bvhReport.latest.json
+std::string latestBVHReportPath(const std::string& reportPath)
+{
+	std::filesystem::path path(reportPath);
+	return (path.parent_path() / (path.stem().string() + ".latest" + path.extension().string())).string();
+}
+
+/**
+ * @brief Builds the BVH of every model folder in `dataFolderPath` and writes their `BVHReport`s to `reportPath`
+ * as JSON, to keep track of the BVH quality per model over time.
+ *
+ * If `reportPath` already holds a report of the same builder and optimize iterations, the SAH cost of every
+ * model is compared against it and rises of more than `BVH_REPORT_REGRESSION_THRESHOLD` are printed as
+ * regressions. The file is only replaced when nothing regressed. Otherwise, and when it was written with
+ * other settings, it is kept as the baseline and the new report goes to `latestBVHReportPath`, copy that
+ * over `reportPath` to accept it.
+ * @return the number of regressions
+ */
+int reportBVHQuality(const std::string& dataFolderPath, const std::string& reportPath, BVHBuilder builder = BVH_BUILDER_BINNED_SAH,
+	int optimizeIterations = 0)
+{
+	std::map<std::string, double> previousCosts;
+	bool settingsChanged = false;
+	if (std::filesystem::exists(reportPath))
+	{
+		std::ifstream previousFile(reportPath, std::ios::binary);
+		std::string text((std::istreambuf_iterator<char>(previousFile)), std::istreambuf_iterator<char>());
+		try {
+			GltfJson previous = GltfJsonParser(text.data(), text.data() + text.size()).parse();
+			std::string previousBuilder = previous.getString("builder");
+			int previousIterations = previous.getInt("optimizeIterations", 0);
+			// Another builder gives other costs, comparing them would only report noise
+			if (previousBuilder != bvhBuilderName(builder) || previousIterations != optimizeIterations)
+			{
+				settingsChanged = true;
+				std::cout << "BVH settings changed since " << reportPath << " (" << previousBuilder << ", " << previousIterations
+					<< " optimize iterations), SAH costs not compared" << std::endl;
+			}
+			const GltfJson* models = previous.find("models");
+			for (size_t i = 0; !settingsChanged && models && i < models->size(); i++)
+				previousCosts[models->at(i).getString("model")] = models->at(i).getNumber("sahCost", 0.0);
+		}
+		catch (const std::exception& e) {
+			std::cout << "Ignoring unreadable BVH report " << reportPath << ": " << e.what() << std::endl;
+		}
+	}
+
+	std::ostringstream json;
+	json << "{\n\t\"builder\": " << jsonString(bvhBuilderName(builder)) << ",\n\t\"optimizeIterations\": " << optimizeIterations
+		<< ",\n\t\"models\": [";
+
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(12) << "SAH"
+		<< std::setw(12) << "previous" << std::setw(12) << "nodes" << std::setw(10) << "depth" << std::setw(12) << "overlap" << std::endl;
+
+	int numRegressions = 0;
+	bool firstModel = true;
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		int numTriangles = static_cast<int>(bvhTriangles.size());
+
+		BVH bvh(bvhTriangles, rtxTriangles, MAX_DEPTH, builder, nullptr, optimizeIterations, BVH_LAYOUT_BUILD_ORDER, false);
+		BVHReport report = makeBVHReport(bvh.allNodes, sizeof(RTXTriangle), bvh.maxDepth);
+
+		json << (firstModel ? "\n" : ",\n") << "\t\t{\n";
+		json << "\t\t\t\"model\": " << jsonString(modelName) << ",\n";
+		json << "\t\t\t\"triangles\": " << numTriangles << ",\n";
+		json << "\t\t\t\"buildMilliseconds\": " << std::setprecision(7) << bvh.buildMilliseconds + bvh.optimizeMilliseconds << ",\n";
+		writeBVHReportJson(json, report, "\t\t\t");
+		json << "\t\t}";
+		firstModel = false;
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << numTriangles << std::fixed << std::setprecision(2)
+			<< std::setw(12) << report.sahCost;
+		auto previous = previousCosts.find(modelName);
+		if (previous != previousCosts.end())
+			std::cout << std::setw(12) << previous->second;
+		else
+			std::cout << std::setw(12) << "-";
+		std::cout << std::setw(12) << report.numNodes << std::setw(10) << report.maxDepth << std::setprecision(4)
+			<< std::setw(12) << report.weightedSiblingOverlap;
+		if (previous != previousCosts.end() && report.sahCost > previous->second * (1.0 + BVH_REPORT_REGRESSION_THRESHOLD))
+		{
+			std::cout << "REGRESSION";
+			numRegressions++;
+		}
+		std::cout << std::defaultfloat << std::endl;
+	});
+	json << "\n\t]\n}\n";
+
+	// A regression must not become the baseline the next run compares against
+	std::string outputPath = settingsChanged || numRegressions > 0 ? latestBVHReportPath(reportPath) : reportPath;
+	std::ofstream reportFile(outputPath, std::ios::binary);
+	if (!reportFile)
+		throw std::runtime_error("Failed to write BVH report: " + outputPath);
+	reportFile << json.str();
+	std::cout << "Wrote BVH report: " << outputPath << ", " << numRegressions << " regressions" << std::endl;
+	if (outputPath != reportPath)
+		std::cout << "Kept the baseline " << reportPath << ", copy the new report over it to accept it" << std::endl;
+	return numRegressions;
+}
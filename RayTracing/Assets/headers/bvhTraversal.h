@@ -0,0 +1,710 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+#include <Assets/headers/threadPool.h>
+
+// Camera rays per side of the image traced by `compareBVHTraversal`, per view
+const int TRAVERSAL_IMAGE_SIZE = 256;
+
+// Rays with random origins inside the scene bounds traced by `compareBVHTraversal`, stand ins for bounces
+const int TRAVERSAL_RANDOM_RAYS = 64 * 1024;
+
+// Cache modelled by `CacheSimulator`, 32 KB like a typical L1 data cache
+const int TRAVERSAL_CACHE_LINE_BYTES = 64;
+const int TRAVERSAL_CACHE_SETS = 64;
+const int TRAVERSAL_CACHE_WAYS = 8;
+
+struct TraversalStats
+{
+	long long nodesVisited = 0;		// Nodes popped from the stack
+	long long nodeFetches = 0;		// Nodes read, a binary step reads both children again for their boxes
+	long long triangleTests = 0;
+	long long hits = 0;
+};
+
+/**
+ * @brief Set associative LRU cache fed the addresses `traceBVH` reads, counting the misses.
+ *
+ * No prefetching, so it only approximates the hardware counter, but it works on every platform and gives
+ * the same count on every run.
+ */
+struct CacheSimulator
+{
+	std::vector<uintptr_t> tags = std::vector<uintptr_t>(TRAVERSAL_CACHE_SETS * TRAVERSAL_CACHE_WAYS, 0);	// Line + 1, 0 is empty
+	std::vector<uint32_t> lastUses = std::vector<uint32_t>(TRAVERSAL_CACHE_SETS * TRAVERSAL_CACHE_WAYS, 0);
+	uint32_t clock = 0;
+	long long misses = 0;
+
+	void read(const void* address, size_t bytes)
+	{
+		uintptr_t first = reinterpret_cast<uintptr_t>(address) / TRAVERSAL_CACHE_LINE_BYTES;
+		uintptr_t last = (reinterpret_cast<uintptr_t>(address) + bytes - 1) / TRAVERSAL_CACHE_LINE_BYTES;
+		for (uintptr_t line = first; line <= last; line++)
+		{
+			int set = static_cast<int>(line % TRAVERSAL_CACHE_SETS) * TRAVERSAL_CACHE_WAYS;
+			int victim = set;
+			bool isHit = false;
+			for (int way = set; way < set + TRAVERSAL_CACHE_WAYS; way++)
+			{
+				if (tags[way] == line + 1)
+				{
+					lastUses[way] = ++clock;
+					isHit = true;
+					break;
+				}
+				if (lastUses[way] < lastUses[victim])
+					victim = way;
+			}
+			if (isHit)
+				continue;
+
+			misses++;
+			tags[victim] = line + 1;
+			lastUses[victim] = ++clock;
+		}
+	}
+};
+
+/**
+ * @brief Hardware cache misses of the calling thread, from the perf_event_open counter.
+ *
+ * Linux only. `isAvailable` is false elsewhere and where the kernel or a VM does not expose the counter.
+ */
+class CacheMissCounter
+{
+public:
+	CacheMissCounter()
+	{
+#ifdef __linux__
+		perf_event_attr attributes = {};
+		attributes.size = sizeof(attributes);
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if (fd != -1)
+			close(fd);
+#endif
+	}
+
+	CacheMissCounter(const CacheMissCounter&) = delete;
+	CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+	bool isAvailable() const
+	{
+		return fd != -1;
+	}
+
+	void start()
+	{
+#ifdef __linux__
+		if (fd != -1)
+		{
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	// Misses since `start`, 0 without the counter
+	long long stop()
+	{
+		long long misses = 0;
+#ifdef __linux__
+		if (fd != -1)
+		{
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(fd, &misses, sizeof(misses)) != sizeof(misses))
+				misses = 0;
+		}
+#endif
+		return misses;
+	}
+
+private:
+	int fd = -1;
+};
+
+// Same test as `rayBoundsIntersect` in compute.glsl, 1e38 on a miss
+float rayBoundsDistance(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+	float tMin = -1e32f;
+	float tMax = 1e32f;
+	for (int i = 0; i < 3; i++)
+	{
+		if (direction[i] < 1e-6f && direction[i] > -1e-6f)
+			continue;
+
+		float t0 = (boundsMin[i] - origin[i]) / direction[i];
+		float t1 = (boundsMax[i] - origin[i]) / direction[i];
+		if (t0 > t1)
+			std::swap(t0, t1);
+		tMin = std::max(tMin, t0);
+		tMax = std::min(tMax, t1);
+		if (tMin >= tMax || tMax < 0)
+			return 1e38f;
+	}
+	return tMin;
+}
+
+float rayBoundsDistance(const glm::vec3& origin, const glm::vec3& direction, const BoundingBox& bounds)
+{
+	return rayBoundsDistance(origin, direction, bounds.min, bounds.max);
+}
+
+// Same test as `rayTriangleIntersect` in compute.glsl, back faces are culled. 1e38 on a miss
+float rayTriangleDistance(const glm::vec3& origin, const glm::vec3& direction, const RTXTriangle& tri)
+{
+	glm::vec3 a(tri.a);
+	glm::vec3 e0 = glm::vec3(tri.b) - a;
+	glm::vec3 e1 = glm::vec3(tri.c) - a;
+	glm::vec3 cross01 = glm::cross(e0, e1);
+	float det = -glm::dot(direction, cross01);
+	if (det < 1e-10f)
+		return 1e38f;
+
+	float invDet = 1.0f / det;
+	glm::vec3 ao = origin - a;
+	float dst = glm::dot(ao, cross01) * invDet;
+	if (dst <= 1e-6f)
+		return 1e38f;
+
+	glm::vec3 dirCrossAO = glm::cross(direction, ao);
+	float u = -glm::dot(e1, dirCrossAO) * invDet;
+	float v = glm::dot(e0, dirCrossAO) * invDet;
+	if (u < 0 || v < 0 || 1 - u - v < 0)
+		return 1e38f;
+	return dst;
+}
+
+/**
+ * @brief CPU copy of `calculateRayCollisionBVH` in compute.glsl, counting the work it does.
+ *
+ * Visits the nodes in the same order as the shader, nearer child first and only children closer than the
+ * nearest hit so far, so the counts match what a GPU thread does for the same ray.
+ * @param cache If set, gets every node and triangle read
+ * @return distance to the nearest hit, 1e38 if nothing was hit
+ */
+float traceBVH(const glm::vec3& origin, const glm::vec3& direction, const std::vector<Node>& nodes,
+	const std::vector<RTXTriangle>& triangles, TraversalStats& stats, CacheSimulator* cache = nullptr)
+{
+	int stack[64];
+	int stackIndex = 0;
+	stack[stackIndex++] = 0;
+
+	float nearest = 1e38f;
+	while (stackIndex > 0)
+	{
+		const Node& node = nodes[stack[--stackIndex]];
+		stats.nodesVisited++;
+		stats.nodeFetches++;
+		if (cache)
+			cache->read(&node, sizeof(Node));
+
+		if (node.childIndex == -1)
+		{
+			for (int i = node.triangleIndex; i < node.triangleIndex + node.triangleCount; i++)
+			{
+				stats.triangleTests++;
+				if (cache)
+					cache->read(&triangles[i], sizeof(RTXTriangle));
+				nearest = std::min(nearest, rayTriangleDistance(origin, direction, triangles[i]));
+			}
+			continue;
+		}
+
+		int childIndexA = node.childIndex;
+		int childIndexB = node.childIndex + 1;
+		float dstA = rayBoundsDistance(origin, direction, nodes[childIndexA].bounds);
+		float dstB = rayBoundsDistance(origin, direction, nodes[childIndexB].bounds);
+		stats.nodeFetches += 2;
+		if (cache)
+			cache->read(&nodes[childIndexA], 2 * sizeof(Node));
+
+		bool isNearestA = dstA < dstB;
+		float dstNear = isNearestA ? dstA : dstB;
+		float dstFar = isNearestA ? dstB : dstA;
+		if (dstFar < nearest)
+			stack[stackIndex++] = isNearestA ? childIndexB : childIndexA;
+		if (dstNear < nearest)
+			stack[stackIndex++] = isNearestA ? childIndexA : childIndexB;
+	}
+
+	if (nearest < 1e38f)
+		stats.hits++;
+	return nearest;
+}
+
+/**
+ * @brief CPU copy of the CHILD_BOUNDS_BVH `traverseBVH` in compute.glsl, `traceBVH` over ChildBoundsNodes.
+ *
+ * Both child boxes come with the node, leaf children are intersected on the spot, nearer first, and only
+ * internal children are pushed. Finds the same nearest hit as `traceBVH` on the binary tree.
+ */
+float traceBVH(const glm::vec3& origin, const glm::vec3& direction, const std::vector<ChildBoundsNode>& nodes,
+	const std::vector<RTXTriangle>& triangles, TraversalStats& stats)
+{
+	int stack[64];
+	int stackIndex = 0;
+	stack[stackIndex++] = 0;
+
+	float nearest = 1e38f;
+	auto intersectLeaf = [&](const BVHChild& leaf)
+	{
+		for (int i = leaf.index; i < leaf.index + leaf.count; i++)
+		{
+			stats.triangleTests++;
+			nearest = std::min(nearest, rayTriangleDistance(origin, direction, triangles[i]));
+		}
+	};
+
+	while (stackIndex > 0)
+	{
+		const ChildBoundsNode& node = nodes[stack[--stackIndex]];
+		stats.nodesVisited++;
+		stats.nodeFetches++;
+
+		float dstA = rayBoundsDistance(origin, direction, node.children[0].boundsMin, node.children[0].boundsMax);
+		float dstB = rayBoundsDistance(origin, direction, node.children[1].boundsMin, node.children[1].boundsMax);
+		bool isNearestA = dstA < dstB;
+		const BVHChild& nearChild = node.children[isNearestA ? 0 : 1];
+		const BVHChild& farChild = node.children[isNearestA ? 1 : 0];
+		float dstNear = isNearestA ? dstA : dstB;
+		float dstFar = isNearestA ? dstB : dstA;
+
+		if (nearChild.count > 0 && dstNear < nearest)
+			intersectLeaf(nearChild);
+		if (farChild.count > 0 && dstFar < nearest)
+			intersectLeaf(farChild);
+
+		if (farChild.count == 0 && dstFar < nearest)
+			stack[stackIndex++] = farChild.index;
+		if (nearChild.count == 0 && dstNear < nearest)
+			stack[stackIndex++] = nearChild.index;
+	}
+
+	if (nearest < 1e38f)
+		stats.hits++;
+	return nearest;
+}
+
+/**
+ * @brief Fixed set of test rays for `bounds`: three camera views from outside plus random rays from inside.
+ *
+ * The views look at the center from the front, the side and above at twice the scene radius, with a 60
+ * degree field of view. The random rays use a fixed seed, so every BVH of a model traces the same rays.
+ */
+void makeTraversalRays(const BoundingBox& bounds, std::vector<glm::vec3>& origins, std::vector<glm::vec3>& directions)
+{
+	glm::vec3 center = bounds.center();
+	float radius = glm::length(bounds.size()) * 0.5f;
+	const glm::vec3 viewDirections[] = { glm::vec3(0.3f, 0.2f, 1.0f), glm::vec3(1.0f, 0.3f, -0.2f), glm::vec3(0.2f, 1.0f, 0.3f) };
+
+	for (const glm::vec3& viewDirection : viewDirections)
+	{
+		glm::vec3 forward = -glm::normalize(viewDirection);
+		glm::vec3 eye = center - forward * radius * 2.0f;
+		glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+		glm::vec3 up = glm::cross(right, forward);
+		float halfWidth = std::tan(glm::radians(30.0f));
+
+		for (int y = 0; y < TRAVERSAL_IMAGE_SIZE; y++)
+		{
+			for (int x = 0; x < TRAVERSAL_IMAGE_SIZE; x++)
+			{
+				float u = ((x + 0.5f) / TRAVERSAL_IMAGE_SIZE * 2.0f - 1.0f) * halfWidth;
+				float v = ((y + 0.5f) / TRAVERSAL_IMAGE_SIZE * 2.0f - 1.0f) * halfWidth;
+				origins.push_back(eye);
+				directions.push_back(glm::normalize(forward + right * u + up * v));
+			}
+		}
+	}
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> normal(0.0f, 1.0f);
+	for (int i = 0; i < TRAVERSAL_RANDOM_RAYS; i++)
+	{
+		glm::vec3 t(unit(random), unit(random), unit(random));
+		glm::vec3 direction(normal(random), normal(random), normal(random));
+		origins.push_back(bounds.min + t * bounds.size());
+		directions.push_back(glm::normalize(direction));
+	}
+}
+
+/**
+ * @brief Traces the rays of `makeTraversalRays` through `nodes` on the thread pool.
+ *
+ * `NodeType` is Node or ChildBoundsNode.
+ * @param milliseconds Output, wall time of the whole batch, the CPU counterpart of a frame
+ */
+template<typename NodeType>
+TraversalStats traceTraversalRays(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions,
+	const std::vector<NodeType>& nodes, const std::vector<RTXTriangle>& triangles, double& milliseconds)
+{
+	const int raysPerTask = 1024;
+	int numRays = static_cast<int>(origins.size());
+	int numTasks = (numRays + raysPerTask - 1) / raysPerTask;
+	std::vector<TraversalStats> taskStats(numTasks);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	getThreadPool().parallelFor(numTasks, [&](int task)
+	{
+		int last = std::min(numRays, (task + 1) * raysPerTask);
+		for (int i = task * raysPerTask; i < last; i++)
+			traceBVH(origins[i], directions[i], nodes, triangles, taskStats[task]);
+	});
+	std::chrono::duration<double, std::milli> traceTime = std::chrono::high_resolution_clock::now() - start;
+	milliseconds = traceTime.count();
+
+	TraversalStats stats;
+	for (const TraversalStats& task : taskStats)
+	{
+		stats.nodesVisited += task.nodesVisited;
+		stats.nodeFetches += task.nodeFetches;
+		stats.triangleTests += task.triangleTests;
+		stats.hits += task.hits;
+	}
+	return stats;
+}
+
+// The rays of `makeTraversalRays` for one model
+struct TraversalRays
+{
+	std::vector<glm::vec3> origins;
+	std::vector<glm::vec3> directions;
+
+	double count() const
+	{
+		return static_cast<double>(origins.size());
+	}
+
+	// Millions of rays per second for a batch traced in `milliseconds`
+	double megaRaysPerSecond(double milliseconds) const
+	{
+		return count() / (milliseconds * 1000.0);
+	}
+};
+
+// `makeTraversalRays` over the bounds of a model's triangles
+TraversalRays makeModelTraversalRays(const std::vector<BVHTriangle>& bvhTriangles)
+{
+	BoundingBox bounds;
+	for (const BVHTriangle& tri : bvhTriangles)
+		bounds.growToInclude(tri);
+
+	TraversalRays rays;
+	makeTraversalRays(bounds, rays.origins, rays.directions);
+	return rays;
+}
+
+/**
+ * @brief Calls `trace` `numRuns` times and returns the fastest of the batch times in milliseconds it returned.
+ *
+ * One batch is at the mercy of whatever else the machine does, the fastest of a few is what the compare tools print.
+ */
+template<typename TraceFunction>
+double fastestTrace(int numRuns, TraceFunction trace)
+{
+	double fastest = 1e30;
+	for (int run = 0; run < numRuns; run++)
+		fastest = std::min(fastest, trace());
+	return fastest;
+}
+
+/**
+ * @brief Builds every model folder in `dataFolderPath` with the binned SAH and the SBVH builder and prints the
+ * traversal work per ray of each.
+ *
+ * Both BVHs trace the same rays with `traceBVH`, which walks the tree like the compute shader does. Nodes
+ * and triangle tests per ray are what the spatial splits are meant to bring down, the trace time is the
+ * CPU frame time of the batch. The GPU frame time of a model is in the window title while it is shown.
+ */
+void compareBVHTraversal(const std::string& dataFolderPath)
+{
+	const BVHBuilder builders[] = { BVH_BUILDER_BINNED_SAH, BVH_BUILDER_SBVH };
+	const char* builderNames[] = { "binned", "sbvh" };
+	const int numBuilders = sizeof(builders) / sizeof(builders[0]);
+
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles";
+	for (int b = 0; b < numBuilders; b++)
+		std::cout << std::setw(14) << (std::string(builderNames[b]) + " refs") << std::setw(18) << (std::string(builderNames[b]) + " nodes/ray")
+			<< std::setw(18) << (std::string(builderNames[b]) + " tris/ray") << std::setw(18) << (std::string(builderNames[b]) + " frame ms");
+	std::cout << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		TraversalRays rays = makeModelTraversalRays(bvhTriangles);
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size() << std::flush;
+		for (int b = 0; b < numBuilders; b++)
+		{
+			std::vector<RTXTriangle> rtxCopy = rtxTriangles;
+			std::vector<BVHTriangle> bvhCopy = bvhTriangles;
+
+			BVH bvh(bvhCopy, rtxCopy, MAX_DEPTH, builders[b], nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+
+			double frameMilliseconds;
+			TraversalStats stats = traceTraversalRays(rays.origins, rays.directions, bvh.allNodes, rtxCopy, frameMilliseconds);
+
+			std::cout << std::fixed << std::setprecision(2) << std::setw(14) << rtxCopy.size()
+				<< std::setw(18) << stats.nodesVisited / rays.count() << std::setw(18) << stats.triangleTests / rays.count()
+				<< std::setw(18) << frameMilliseconds << std::flush;
+		}
+		std::cout << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
+
+/**
+ * @brief Builds every model folder in `dataFolderPath` with the binned SAH builder, runs `BVH::optimize` on
+ * the result and prints what the optimization costs and gains.
+ *
+ * The gain in rays per second is measured with `traceTraversalRays` before and after, the faster of
+ * `numRuns` batches each. Worth it once the optimization time is small next to the render time saved.
+ */
+void compareBVHOptimizer(const std::string& dataFolderPath, int maxIterations = 8, int numRuns = 3)
+{
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(12) << "build ms"
+		<< std::setw(12) << "SAH" << std::setw(12) << "iterations" << std::setw(14) << "optimized SAH" << std::setw(12) << "SAH gain %"
+		<< std::setw(14) << "optimize ms" << std::setw(12) << "Mrays/s" << std::setw(18) << "optimized Mrays/s" << std::setw(14) << "rays/s gain %" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		TraversalRays rays = makeModelTraversalRays(bvhTriangles);
+
+		auto raysPerSecond = [&](const BVH& bvh)
+		{
+			return rays.megaRaysPerSecond(fastestTrace(numRuns, [&]()
+			{
+				double milliseconds;
+				traceTraversalRays(rays.origins, rays.directions, bvh.allNodes, rtxTriangles, milliseconds);
+				return milliseconds;
+			}));
+		};
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size() << std::flush;
+
+		BVH bvh(bvhTriangles, rtxTriangles, MAX_DEPTH, BVH_BUILDER_BINNED_SAH, nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+		double builtRaysPerSecond = raysPerSecond(bvh);
+
+		bvh.optimize(bvhTriangles, rtxTriangles, maxIterations);
+		double optimizedRaysPerSecond = raysPerSecond(bvh);
+
+		std::cout << std::fixed << std::setprecision(2) << std::setw(12) << bvh.buildMilliseconds << std::setw(12) << bvh.unoptimizedSAHCost
+			<< std::setw(12) << bvh.optimizeIterations << std::setw(14) << bvh.sahCost
+			<< std::setw(12) << 100.0f * (1.0f - bvh.sahCost / bvh.unoptimizedSAHCost)
+			<< std::setw(14) << bvh.optimizeMilliseconds << std::setw(12) << builtRaysPerSecond << std::setw(18) << optimizedRaysPerSecond
+			<< std::setw(14) << 100.0 * (optimizedRaysPerSecond / builtRaysPerSecond - 1.0) << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
+
+/**
+ * @brief Animates every model folder in `dataFolderPath` for `numFrames` frames, keeps its binned SAH and its SBVH
+ * up to date with `BVH::update` and checks each frame against a fresh build of the moved triangles.
+ *
+ * Every frame moves each triangle along a smooth swirl by up to `frameMotion` times the scene radius, neighbouring
+ * triangles about the same way and without changing their shape. The refitted tree
+ * must find the same nearest hit as the fresh one for every ray of `makeTraversalRays`, its SAH cost over that
+ * of the fresh build is what the refits have lost. `update` rebuilds once that passes `BVH_REFIT_REBUILD_RATIO`,
+ * an SBVH with the binned builder.
+ */
+void compareBVHRefit(const std::string& dataFolderPath, int numFrames = 12, float frameMotion = 0.02f)
+{
+	const BVHBuilder builders[] = { BVH_BUILDER_BINNED_SAH, BVH_BUILDER_SBVH };
+	const char* builderNames[] = { "binned", "sbvh" };
+	const int numBuilders = sizeof(builders) / sizeof(builders[0]);
+
+	std::cout << std::left << std::setw(16) << "model" << std::setw(10) << "builder" << std::setw(8) << "frame"
+		<< std::setw(12) << "update ms" << std::setw(12) << "SAH" << std::setw(12) << "fresh SAH" << std::setw(10) << "ratio"
+		<< std::setw(10) << "rebuilt" << "same hits" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		for (int b = 0; b < numBuilders; b++)
+		{
+			std::vector<RTXTriangle> rtxCopy = rtxTriangles;
+			std::vector<BVHTriangle> bvhCopy = bvhTriangles;
+			BVH bvh(bvhCopy, rtxCopy, MAX_DEPTH, builders[b], nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+
+			BoundingBox startBounds;
+			for (const BVHTriangle& tri : bvhCopy)
+				startBounds.growToInclude(tri);
+			float radius = glm::length(startBounds.size()) * 0.5f;
+			float frequency = glm::two_pi<float>() / radius;
+			for (int frame = 1; frame <= numFrames; frame++)
+			{
+				for (size_t i = 0; i < rtxCopy.size(); i++)
+				{
+					RTXTriangle& tri = rtxCopy[i];
+					glm::vec3 p = bvhCopy[i].center;
+					glm::vec3 swirl(std::sin(p.y * frequency), std::sin(p.z * frequency), std::sin(p.x * frequency));
+					glm::vec4 offset(swirl * frameMotion * radius, 0.0f);
+					tri.a += offset;
+					tri.b += offset;
+					tri.c += offset;
+					bvhCopy[i] = BVHTriangle(tri.a, tri.b, tri.c);
+				}
+
+				auto start = std::chrono::high_resolution_clock::now();
+				bool rebuilt = bvh.update(bvhCopy, rtxCopy);
+				std::chrono::duration<double, std::milli> updateTime = std::chrono::high_resolution_clock::now() - start;
+
+				std::vector<RTXTriangle> freshRtx = rtxCopy;
+				std::vector<BVHTriangle> freshBvh = bvhCopy;
+				BVH fresh(freshBvh, freshRtx, MAX_DEPTH, bvh.builder, nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+
+				TraversalRays rays = makeModelTraversalRays(bvhCopy);
+				std::atomic<int> numMismatches(0);
+				getThreadPool().parallelFor(static_cast<int>(rays.origins.size()), [&](int i)
+				{
+					const glm::vec3& origin = rays.origins[i];
+					const glm::vec3& direction = rays.directions[i];
+					TraversalStats stats;
+					if (traceBVH(origin, direction, bvh.allNodes, rtxCopy, stats) != traceBVH(origin, direction, fresh.allNodes, freshRtx, stats))
+						numMismatches++;
+				});
+
+				std::cout << std::left << std::setw(16) << modelName << std::setw(10) << builderNames[b] << std::setw(8) << frame
+					<< std::fixed << std::setprecision(2) << std::setw(12) << updateTime.count() << std::setw(12) << bvh.sahCost
+					<< std::setw(12) << fresh.sahCost << std::setw(10) << bvh.sahCost / fresh.sahCost << std::setw(10) << (rebuilt ? "yes" : "no")
+					<< (numMismatches == 0 ? "yes" : "NO, " + std::to_string(numMismatches.load()) + " rays") << std::endl;
+			}
+		}
+	});
+	std::cout << std::defaultfloat;
+}
+
+/**
+ * @brief Builds every model folder in `dataFolderPath` with the binned SAH builder and prints nodes fetched per
+ * ray and CPU rays per second of the binary layout and of the same tree as ChildBoundsNodes.
+ *
+ * The CPU side of the CHILD_BOUNDS_BVH A/B, the faster of `numRuns` batches each. On the CPU the fetches
+ * mostly hit the cache, the GPU frame time in the window title shows what they cost there.
+ */
+void compareChildBoundsBVH(const std::string& dataFolderPath, int numRuns = 3)
+{
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(12) << "binary KB"
+		<< std::setw(20) << "binary fetches/ray" << std::setw(16) << "binary Mrays/s" << std::setw(18) << "child bounds KB"
+		<< std::setw(26) << "child bounds fetches/ray" << std::setw(22) << "child bounds Mrays/s" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		TraversalRays rays = makeModelTraversalRays(bvhTriangles);
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size() << std::flush;
+
+		BVH bvh(bvhTriangles, rtxTriangles, MAX_DEPTH, BVH_BUILDER_BINNED_SAH, nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+		std::vector<ChildBoundsNode> childBoundsNodes;
+		makeChildBoundsBVH(bvh.allNodes.data(), 0, childBoundsNodes);
+
+		auto traceFastest = [&](const auto& nodes, TraversalStats& stats)
+		{
+			return rays.megaRaysPerSecond(fastestTrace(numRuns, [&]()
+			{
+				double milliseconds;
+				stats = traceTraversalRays(rays.origins, rays.directions, nodes, rtxTriangles, milliseconds);
+				return milliseconds;
+			}));
+		};
+		TraversalStats binaryStats;
+		TraversalStats childBoundsStats;
+		double binaryRaysPerSecond = traceFastest(bvh.allNodes, binaryStats);
+		double childBoundsRaysPerSecond = traceFastest(childBoundsNodes, childBoundsStats);
+
+		std::cout << std::fixed << std::setprecision(2) << std::setw(12) << bvh.allNodes.size() * sizeof(Node) / 1024
+			<< std::setw(20) << binaryStats.nodeFetches / rays.count() << std::setw(16) << binaryRaysPerSecond
+			<< std::setw(18) << childBoundsNodes.size() * sizeof(ChildBoundsNode) / 1024
+			<< std::setw(26) << childBoundsStats.nodeFetches / rays.count() << std::setw(22) << childBoundsRaysPerSecond << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
+
+/**
+ * @brief Builds every model folder in `dataFolderPath` with the binned SAH builder, puts the tree in every
+ * BVHLayout with `BVH::relayout` and prints cache misses per ray and CPU rays per second of each.
+ *
+ * Rays per second are the faster of `numRuns` batches on the thread pool. The misses come from one pass
+ * over the rays on this thread: simulated L1 misses of the node and triangle reads, and the hardware
+ * counter of all cache misses where perf_event_open provides it, "-" otherwise.
+ */
+void compareBVHLayouts(const std::string& dataFolderPath, int numRuns = 3)
+{
+	const BVHLayout layouts[] = { BVH_LAYOUT_BUILD_ORDER, BVH_LAYOUT_DEPTH_FIRST, BVH_LAYOUT_BREADTH_FIRST_TOP, BVH_LAYOUT_VAN_EMDE_BOAS };
+	const char* layoutNames[] = { "build order", "depth first", "bfs top", "van emde boas" };
+	const int numLayouts = sizeof(layouts) / sizeof(layouts[0]);
+
+	CacheMissCounter missCounter;
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(16) << "layout"
+		<< std::setw(12) << "Mrays/s" << std::setw(18) << "L1 sim misses/ray" << std::setw(16) << "misses/ray" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		TraversalRays rays = makeModelTraversalRays(bvhTriangles);
+
+		BVH built(bvhTriangles, rtxTriangles, MAX_DEPTH, BVH_BUILDER_BINNED_SAH, nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+
+		for (int l = 0; l < numLayouts; l++)
+		{
+			BVH bvh = built;
+			std::vector<RTXTriangle> rtxCopy = rtxTriangles;
+			std::vector<BVHTriangle> bvhCopy = bvhTriangles;
+			if (layouts[l] != BVH_LAYOUT_BUILD_ORDER)
+				bvh.relayout(bvhCopy, rtxCopy, layouts[l]);
+
+			double fastest = fastestTrace(numRuns, [&]()
+			{
+				double milliseconds;
+				traceTraversalRays(rays.origins, rays.directions, bvh.allNodes, rtxCopy, milliseconds);
+				return milliseconds;
+			});
+
+			TraversalStats stats;
+			missCounter.start();
+			for (size_t i = 0; i < rays.origins.size(); i++)
+				traceBVH(rays.origins[i], rays.directions[i], bvh.allNodes, rtxCopy, stats);
+			long long hardwareMisses = missCounter.stop();
+
+			CacheSimulator cache;
+			for (size_t i = 0; i < rays.origins.size(); i++)
+				traceBVH(rays.origins[i], rays.directions[i], bvh.allNodes, rtxCopy, stats, &cache);
+
+			std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size()
+				<< std::setw(16) << layoutNames[l] << std::fixed << std::setprecision(2) << std::setw(12) << rays.megaRaysPerSecond(fastest)
+				<< std::setw(18) << cache.misses / rays.count();
+			if (missCounter.isAvailable())
+				std::cout << std::setw(16) << hardwareMisses / rays.count();
+			else
+				std::cout << std::setw(16) << "-";
+			std::cout << std::endl;
+		}
+	});
+	std::cout << std::defaultfloat;
+}
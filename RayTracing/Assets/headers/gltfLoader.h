@@ -0,0 +1,963 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <charconv>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <filesUtil/mappedFile.h>
+
+#include <Assets/headers/mesh.h>
+
+/*
+ * Binary glTF 2.0 (.glb) loader, the alternative to the OBJ + MTL path:
+ *   header        uint32 magic "glTF", uint32 version 2, uint32 total length
+ *   JSON chunk    scene description (nodes, meshes, accessors, materials), parsed by GltfJson
+ *   BIN chunk     buffer 0, vertex attributes and indices are read from the mapped file in place
+ *
+ * Only the data the renderer uses is read: POSITION, TEXCOORD_0, indices, the node transforms and each
+ * material's baseColorFactor, baseColorTexture and emissiveFactor. Meshes are flattened into world space
+ * triangles in scene order, so the output matches what `getTrianglesData_` produces for the same model
+ * exported as OBJ.
+ */
+
+const uint32_t GLB_MAGIC = 0x46546C67;		// "glTF"
+const uint32_t GLB_CHUNK_JSON = 0x4E4F534A;	// "JSON"
+const uint32_t GLB_CHUNK_BIN = 0x004E4942;	// "BIN\0"
+
+const int GLTF_BYTE = 5120;
+const int GLTF_UNSIGNED_BYTE = 5121;
+const int GLTF_SHORT = 5122;
+const int GLTF_UNSIGNED_SHORT = 5123;
+const int GLTF_UNSIGNED_INT = 5125;
+const int GLTF_FLOAT = 5126;
+
+const int GLTF_MODE_TRIANGLES = 4;
+const int GLTF_MODE_TRIANGLE_STRIP = 5;
+const int GLTF_MODE_TRIANGLE_FAN = 6;
+
+/**
+ * @brief Parsed JSON value, just enough of JSON for glTF scene descriptions.
+ *
+ * Object members are kept in two parallel vectors in file order, glTF objects only have a handful of keys.
+ */
+struct GltfJson
+{
+	enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+	Type type = NUL;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<GltfJson> elements;		// ARRAY elements, OBJECT member values
+	std::vector<std::string> keys;		// OBJECT member names
+
+	// Member `key`, nullptr if missing or if this is not an object
+	const GltfJson* find(const std::string& key) const
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+			if (keys[i] == key)
+				return &elements[i];
+		return nullptr;
+	}
+
+	// Array element, throws if out of range
+	const GltfJson& at(size_t i) const
+	{
+		if (type != ARRAY || i >= elements.size())
+			throw std::runtime_error("glTF index out of range");
+		return elements[i];
+	}
+
+	size_t size() const
+	{
+		return type == ARRAY ? elements.size() : 0;
+	}
+
+	double getNumber(const std::string& key, double fallback) const
+	{
+		const GltfJson* value = find(key);
+		return value && value->type == NUMBER ? value->number : fallback;
+	}
+
+	int getInt(const std::string& key, int fallback) const
+	{
+		return static_cast<int>(getNumber(key, fallback));
+	}
+
+	std::string getString(const std::string& key, const std::string& fallback = "") const
+	{
+		const GltfJson* value = find(key);
+		return value && value->type == STRING ? value->string : fallback;
+	}
+};
+
+class GltfJsonParser
+{
+public:
+	GltfJsonParser(const char* begin, const char* end) : p(begin), end(end) {}
+
+	GltfJson parse()
+	{
+		GltfJson root = parseValue(0);
+		skipSpaces();
+		if (p != end && *p != '\0')
+			fail();
+		return root;
+	}
+
+private:
+	static const int MAX_DEPTH = 256;
+
+	const char* p;
+	const char* end;
+
+	[[noreturn]] void fail()
+	{
+		throw std::runtime_error("Malformed glTF JSON");
+	}
+
+	void skipSpaces()
+	{
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+			p++;
+	}
+
+	void expect(char ch)
+	{
+		skipSpaces();
+		if (p == end || *p != ch)
+			fail();
+		p++;
+	}
+
+	bool consumeLiteral(const char* literal)
+	{
+		size_t length = std::strlen(literal);
+		if (static_cast<size_t>(end - p) < length || std::memcmp(p, literal, length) != 0)
+			return false;
+		p += length;
+		return true;
+	}
+
+	GltfJson parseValue(int depth)
+	{
+		if (depth > MAX_DEPTH)
+			fail();
+
+		skipSpaces();
+		if (p == end)
+			fail();
+
+		GltfJson value;
+		if (*p == '{')
+		{
+			value.type = GltfJson::OBJECT;
+			p++;
+			skipSpaces();
+			if (p < end && *p == '}')
+			{
+				p++;
+				return value;
+			}
+			while (true)
+			{
+				skipSpaces();
+				value.keys.push_back(parseString());
+				expect(':');
+				value.elements.push_back(parseValue(depth + 1));
+				skipSpaces();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				expect('}');
+				return value;
+			}
+		}
+		if (*p == '[')
+		{
+			value.type = GltfJson::ARRAY;
+			p++;
+			skipSpaces();
+			if (p < end && *p == ']')
+			{
+				p++;
+				return value;
+			}
+			while (true)
+			{
+				value.elements.push_back(parseValue(depth + 1));
+				skipSpaces();
+				if (p < end && *p == ',')
+				{
+					p++;
+					continue;
+				}
+				expect(']');
+				return value;
+			}
+		}
+		if (*p == '"')
+		{
+			value.type = GltfJson::STRING;
+			value.string = parseString();
+			return value;
+		}
+		if (consumeLiteral("true") || consumeLiteral("false"))
+		{
+			value.type = GltfJson::BOOLEAN;
+			value.boolean = p[-2] == 'u'; // "true" ends in "ue", "false" in "se"
+			return value;
+		}
+		if (consumeLiteral("null"))
+			return value;
+
+		// from_chars rejects a leading '+' like JSON does, but also accepts "inf"/"nan", which no exporter writes
+		value.type = GltfJson::NUMBER;
+		std::from_chars_result result = std::from_chars(p, end, value.number);
+		if (result.ec != std::errc() || result.ptr == p)
+			fail();
+		p = result.ptr;
+		return value;
+	}
+
+	std::string parseString()
+	{
+		if (p == end || *p != '"')
+			fail();
+		p++;
+
+		std::string str;
+		while (true)
+		{
+			if (p == end)
+				fail();
+			char ch = *p++;
+			if (ch == '"')
+				return str;
+			if (ch != '\\')
+			{
+				str.push_back(ch);
+				continue;
+			}
+
+			if (p == end)
+				fail();
+			char escaped = *p++;
+			switch (escaped)
+			{
+			case '"': str.push_back('"'); break;
+			case '\\': str.push_back('\\'); break;
+			case '/': str.push_back('/'); break;
+			case 'b': str.push_back('\b'); break;
+			case 'f': str.push_back('\f'); break;
+			case 'n': str.push_back('\n'); break;
+			case 'r': str.push_back('\r'); break;
+			case 't': str.push_back('\t'); break;
+			case 'u':
+			{
+				uint32_t codePoint = parseHex4();
+				if (codePoint >= 0xD800 && codePoint < 0xDC00)
+				{
+					// UTF-16 surrogate pair
+					if (!consumeLiteral("\\u"))
+						fail();
+					uint32_t low = parseHex4();
+					if (low < 0xDC00 || low >= 0xE000)
+						fail();
+					codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+				}
+				appendUtf8(str, codePoint);
+				break;
+			}
+			default:
+				fail();
+			}
+		}
+	}
+
+	uint32_t parseHex4()
+	{
+		if (end - p < 4)
+			fail();
+		uint32_t value = 0;
+		std::from_chars_result result = std::from_chars(p, p + 4, value, 16);
+		if (result.ptr != p + 4)
+			fail();
+		p += 4;
+		return value;
+	}
+
+	static void appendUtf8(std::string& str, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+			str.push_back(static_cast<char>(codePoint));
+		else if (codePoint < 0x800)
+		{
+			str.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+			str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000)
+		{
+			str.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+			str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+		else
+		{
+			str.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+			str.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+			str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+			str.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+		}
+	}
+};
+
+// glTF URIs are percent encoded ("my%20texture.png")
+std::string decodeGltfUri(const std::string& uri)
+{
+	std::string decoded;
+	for (size_t i = 0; i < uri.size(); i++)
+	{
+		unsigned int value = 0;
+		if (uri[i] == '%' && i + 2 < uri.size()
+			&& std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16).ptr == uri.data() + i + 3)
+		{
+			decoded.push_back(static_cast<char>(value));
+			i += 2;
+		}
+		else
+			decoded.push_back(uri[i]);
+	}
+	return decoded;
+}
+
+// Typed, strided view of an accessor's elements inside a mapped buffer
+struct GltfAccessor
+{
+	const unsigned char* data = nullptr;
+	size_t count = 0;
+	size_t stride = 0;
+	int componentType = GLTF_FLOAT;
+	int numComponents = 1;
+	bool normalized = false;
+
+	float component(size_t element, int c) const
+	{
+		const unsigned char* src = data + element * stride;
+		switch (componentType)
+		{
+		case GLTF_FLOAT: { float v; std::memcpy(&v, src + 4 * c, 4); return v; }
+		case GLTF_UNSIGNED_BYTE: { uint8_t v = src[c]; return normalized ? v / 255.0f : v; }
+		case GLTF_BYTE: { int8_t v; std::memcpy(&v, src + c, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+		case GLTF_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, src + 2 * c, 2); return normalized ? v / 65535.0f : v; }
+		case GLTF_SHORT: { int16_t v; std::memcpy(&v, src + 2 * c, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+		case GLTF_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, src + 4 * c, 4); return static_cast<float>(v); }
+		}
+		return 0.0f;
+	}
+
+	uint32_t index(size_t element) const
+	{
+		const unsigned char* src = data + element * stride;
+		switch (componentType)
+		{
+		case GLTF_UNSIGNED_BYTE: return src[0];
+		case GLTF_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, src, 2); return v; }
+		case GLTF_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, src, 4); return v; }
+		}
+		throw std::runtime_error("Unsupported glTF index type");
+	}
+};
+
+/**
+ * @brief A mapped .glb file, its parsed JSON chunk and the buffers its accessors point into.
+ *
+ * Buffer 0 is the BIN chunk. Buffers with a relative `uri` are mapped from files next to the .glb,
+ * base64 `data:` URIs are not supported.
+ */
+class GlbDocument
+{
+public:
+	std::filesystem::path path;
+	GltfJson json;
+
+	explicit GlbDocument(const std::filesystem::path& glbPath) : path(glbPath), file(glbPath.string())
+	{
+		if (!file.isOpen())
+		{
+			std::cerr << "Failed to open GLB file: " << glbPath << std::endl;
+			throw std::runtime_error("GLB file not found");
+		}
+
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.data);
+		if (file.size < 20 || readU32(bytes) != GLB_MAGIC || readU32(bytes + 4) != 2)
+			throw std::runtime_error("Not a glTF 2.0 binary file");
+		size_t length = std::min<size_t>(readU32(bytes + 8), file.size);
+
+		const unsigned char* binChunk = nullptr;
+		size_t binLength = 0;
+		bool hasJson = false;
+		for (size_t offset = 12; offset + 8 <= length;)
+		{
+			size_t chunkLength = readU32(bytes + offset);
+			uint32_t chunkType = readU32(bytes + offset + 4);
+			const unsigned char* chunkData = bytes + offset + 8;
+			if (chunkLength > length - offset - 8)
+				throw std::runtime_error("Truncated GLB chunk");
+
+			if (chunkType == GLB_CHUNK_JSON && !hasJson)
+			{
+				const char* text = reinterpret_cast<const char*>(chunkData);
+				json = GltfJsonParser(text, text + chunkLength).parse();
+				hasJson = true;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && !binChunk)
+			{
+				binChunk = chunkData;
+				binLength = chunkLength;
+			}
+			offset += 8 + (chunkLength + 3) / 4 * 4;
+		}
+		if (!hasJson)
+			throw std::runtime_error("GLB file without JSON chunk");
+
+		const GltfJson* buffers = json.find("buffers");
+		for (size_t i = 0; buffers && i < buffers->size(); i++)
+		{
+			const GltfJson& buffer = buffers->at(i);
+			std::string uri = buffer.getString("uri");
+			if (uri.empty())
+			{
+				if (i != 0 || !binChunk)
+					throw std::runtime_error("glTF buffer without data");
+				bufferData.push_back(binChunk);
+				bufferSizes.push_back(binLength);
+				continue;
+			}
+			if (uri.rfind("data:", 0) == 0)
+				throw std::runtime_error("Embedded base64 glTF buffers are not supported");
+
+			auto external = std::make_unique<MappedFile>((glbPath.parent_path() / decodeGltfUri(uri)).string());
+			if (!external->isOpen())
+			{
+				std::cerr << "Failed to open glTF buffer: " << uri << std::endl;
+				throw std::runtime_error("glTF buffer not found");
+			}
+			bufferData.push_back(reinterpret_cast<const unsigned char*>(external->data));
+			bufferSizes.push_back(external->size);
+			externalBuffers.push_back(std::move(external));
+		}
+	}
+
+	GlbDocument(const GlbDocument&) = delete;
+	GlbDocument& operator=(const GlbDocument&) = delete;
+
+	// Element `index` of a top level array ("meshes", "nodes", ...), throws if missing
+	const GltfJson& get(const std::string& array, int index) const
+	{
+		const GltfJson* elements = json.find(array);
+		if (!elements || index < 0)
+			throw std::runtime_error("glTF index out of range");
+		return elements->at(index);
+	}
+
+	// Bytes of a buffer view, bounds checked against its buffer
+	const unsigned char* bufferView(int index, size_t& byteLength, size_t& byteStride) const
+	{
+		const GltfJson& view = get("bufferViews", index);
+		int buffer = view.getInt("buffer", -1);
+		size_t byteOffset = static_cast<size_t>(view.getNumber("byteOffset", 0));
+		byteLength = static_cast<size_t>(view.getNumber("byteLength", 0));
+		byteStride = static_cast<size_t>(view.getNumber("byteStride", 0));
+		if (buffer < 0 || buffer >= static_cast<int>(bufferData.size()) || byteOffset > bufferSizes[buffer] || byteLength > bufferSizes[buffer] - byteOffset)
+			throw std::runtime_error("glTF buffer view out of range");
+		return bufferData[buffer] + byteOffset;
+	}
+
+	GltfAccessor accessor(int index) const
+	{
+		const GltfJson& acc = get("accessors", index);
+		if (acc.find("sparse"))
+			throw std::runtime_error("Sparse glTF accessors are not supported");
+		if (!acc.find("bufferView"))
+			throw std::runtime_error("glTF accessors without a buffer view are not supported");
+
+		GltfAccessor result;
+		result.count = static_cast<size_t>(acc.getNumber("count", 0));
+		result.componentType = acc.getInt("componentType", 0);
+		result.normalized = acc.find("normalized") && acc.find("normalized")->boolean;
+
+		std::string type = acc.getString("type");
+		if (type == "SCALAR") result.numComponents = 1;
+		else if (type == "VEC2") result.numComponents = 2;
+		else if (type == "VEC3") result.numComponents = 3;
+		else if (type == "VEC4") result.numComponents = 4;
+		else throw std::runtime_error("Unsupported glTF accessor type");
+
+		size_t componentSize;
+		switch (result.componentType)
+		{
+		case GLTF_BYTE: case GLTF_UNSIGNED_BYTE: componentSize = 1; break;
+		case GLTF_SHORT: case GLTF_UNSIGNED_SHORT: componentSize = 2; break;
+		case GLTF_UNSIGNED_INT: case GLTF_FLOAT: componentSize = 4; break;
+		default: throw std::runtime_error("Unsupported glTF component type");
+		}
+		size_t elementSize = componentSize * result.numComponents;
+
+		size_t viewLength, viewStride;
+		const unsigned char* view = bufferView(acc.getInt("bufferView", -1), viewLength, viewStride);
+		size_t byteOffset = static_cast<size_t>(acc.getNumber("byteOffset", 0));
+		result.stride = viewStride ? viewStride : elementSize;
+		if (byteOffset > viewLength)
+			throw std::runtime_error("glTF accessor out of range");
+		size_t available = viewLength - byteOffset;
+		if (result.count > 0 && (elementSize > available || (result.count - 1) > (available - elementSize) / result.stride))
+			throw std::runtime_error("glTF accessor out of range");
+		result.data = view + byteOffset;
+		return result;
+	}
+
+private:
+	MappedFile file;
+	std::vector<std::unique_ptr<MappedFile>> externalBuffers;
+	std::vector<const unsigned char*> bufferData;
+	std::vector<size_t> bufferSizes;
+
+	static uint32_t readU32(const unsigned char* p)
+	{
+		return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+	}
+};
+
+// Local transform of a glTF node, either its `matrix` or translation * rotation * scale
+glm::mat4 gltfNodeTransform(const GltfJson& node)
+{
+	auto readFloats = [&](const char* key, float* out, size_t count)
+	{
+		const GltfJson* values = node.find(key);
+		if (!values)
+			return false;
+		if (values->size() != count)
+			throw std::runtime_error("Malformed glTF node transform");
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<float>(values->at(i).number);
+		return true;
+	};
+
+	float matrix[16];
+	if (readFloats("matrix", matrix, 16))
+		return glm::make_mat4(matrix); // Column major in both glTF and glm
+
+	float t[3] = { 0.0f, 0.0f, 0.0f };
+	float r[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // x, y, z, w
+	float s[3] = { 1.0f, 1.0f, 1.0f };
+	readFloats("translation", t, 3);
+	readFloats("rotation", r, 4);
+	readFloats("scale", s, 3);
+
+	return glm::translate(glm::mat4(1.0f), glm::vec3(t[0], t[1], t[2]))
+		* glm::mat4_cast(glm::quat(r[3], r[0], r[1], r[2]))
+		* glm::scale(glm::mat4(1.0f), glm::vec3(s[0], s[1], s[2]));
+}
+
+/**
+ * @brief Converts the glTF materials, material i gets index i + 1 and index 0 is the default material.
+ *
+ * Same mapping as `loadMtlLibraries`: baseColorFactor is `Kd`, a non zero emissiveFactor (times
+ * KHR_materials_emissive_strength) is `Ke` and turns the material into a light, baseColorTexture is
+ * `map_Kd`. Only images referenced by a material are decoded, each once, in first reference order.
+ */
+void loadGltfMaterials(const GlbDocument& glb, std::vector<Material>& materials,
+	std::vector<std::future<DecodedTexture>>& pendingTextures, bool decodeTextures)
+{
+	Material defaultMtl = Material();
+	defaultMtl.index = 0;
+	materials.push_back(defaultMtl);
+
+	std::map<int, int> imageToTextureIndex;
+	auto resolveImage = [&](int imageIndex)
+	{
+		auto inserted = imageToTextureIndex.emplace(imageIndex, static_cast<int>(imageToTextureIndex.size()));
+		if (!inserted.second || !decodeTextures)
+			return inserted.first->second;
+
+		const GltfJson& image = glb.get("images", imageIndex);
+		std::string uri = image.getString("uri");
+		if (!uri.empty())
+		{
+			if (uri.rfind("data:", 0) == 0)
+				throw std::runtime_error("Embedded base64 glTF images are not supported");
+			std::filesystem::path texPath = glb.path.parent_path() / decodeGltfUri(uri);
+			if (!std::filesystem::is_regular_file(texPath))
+			{
+				std::cerr << "Texture referenced by glTF image not found: " << uri << std::endl;
+				throw std::runtime_error("Texture not found");
+			}
+			pendingTextures.push_back(decodeTextureAsync(texPath.lexically_normal().string()));
+		}
+		else
+		{
+			// Embedded in the BIN chunk, the bytes are copied so the decode does not depend on the mapping
+			size_t byteLength, byteStride;
+			const unsigned char* encoded = glb.bufferView(image.getInt("bufferView", -1), byteLength, byteStride);
+			std::string name = glb.path.string() + "#image" + std::to_string(imageIndex);
+			pendingTextures.push_back(decodeTextureAsync(std::vector<unsigned char>(encoded, encoded + byteLength), name));
+		}
+		return inserted.first->second;
+	};
+
+	const GltfJson* gltfMaterials = glb.json.find("materials");
+	for (size_t m = 0; gltfMaterials && m < gltfMaterials->size(); m++)
+	{
+		const GltfJson& gltfMaterial = gltfMaterials->at(m);
+		Material mat = Material();
+		mat.index = static_cast<int>(m) + 1;
+
+		const GltfJson* pbr = gltfMaterial.find("pbrMetallicRoughness");
+		const GltfJson* baseColor = pbr ? pbr->find("baseColorFactor") : nullptr;
+		if (baseColor && baseColor->size() >= 3)
+			mat.color = glm::vec4(baseColor->at(0).number, baseColor->at(1).number, baseColor->at(2).number, 0.0f);
+
+		glm::vec3 emission(0.0f);
+		const GltfJson* emissive = gltfMaterial.find("emissiveFactor");
+		if (emissive && emissive->size() == 3)
+			emission = glm::vec3(emissive->at(0).number, emissive->at(1).number, emissive->at(2).number);
+		const GltfJson* extensions = gltfMaterial.find("extensions");
+		const GltfJson* emissiveStrength = extensions ? extensions->find("KHR_materials_emissive_strength") : nullptr;
+		if (emissiveStrength)
+			emission *= static_cast<float>(emissiveStrength->getNumber("emissiveStrength", 1.0));
+
+		if (emission.x > 0.0f || emission.y > 0.0f || emission.z > 0.0f)
+			mat.makeLight(emission, 0.299f * emission.x + 0.587f * emission.y + 0.114f * emission.z);
+
+		const GltfJson* baseColorTexture = pbr ? pbr->find("baseColorTexture") : nullptr;
+		if (baseColorTexture && mat.materialType != LIGHT)
+		{
+			const GltfJson& texture = glb.get("textures", baseColorTexture->getInt("index", -1));
+			if (texture.find("source"))
+			{
+				mat.materialType = TEXTURE;
+				mat.textureIndex = resolveImage(texture.getInt("source", -1));
+			}
+		}
+
+		materials.push_back(mat);
+	}
+}
+
+/**
+ * @brief Appends the triangles of one mesh primitive, transformed to world space.
+ *
+ * glTF puts the UV origin at the top left, V is flipped to the OBJ convention the textures are loaded
+ * for. Transforms with a negative determinant mirror the mesh, their triangles are swapped back to
+ * counter clockwise winding.
+ */
+void appendGltfPrimitive(const GlbDocument& glb, const GltfJson& primitive, const glm::mat4& transform,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+{
+	int mode = primitive.getInt("mode", GLTF_MODE_TRIANGLES);
+	if (mode != GLTF_MODE_TRIANGLES && mode != GLTF_MODE_TRIANGLE_STRIP && mode != GLTF_MODE_TRIANGLE_FAN)
+		return; // Points and lines have no surface to hit
+
+	const GltfJson* attributes = primitive.find("attributes");
+	if (!attributes || !attributes->find("POSITION"))
+		throw std::runtime_error("glTF primitive without POSITION");
+
+	GltfAccessor positionAccessor = glb.accessor(attributes->getInt("POSITION", -1));
+	if (positionAccessor.componentType != GLTF_FLOAT || positionAccessor.numComponents != 3)
+		throw std::runtime_error("glTF POSITION must be float VEC3");
+
+	std::vector<glm::vec3> positions(positionAccessor.count);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		glm::vec3 p;
+		std::memcpy(&p, positionAccessor.data + i * positionAccessor.stride, sizeof(p));
+		positions[i] = glm::vec3(transform * glm::vec4(p, 1.0f));
+	}
+
+	std::vector<glm::vec2> texCoords(positions.size(), glm::vec2(0.0f));
+	if (attributes->find("TEXCOORD_0"))
+	{
+		GltfAccessor uvAccessor = glb.accessor(attributes->getInt("TEXCOORD_0", -1));
+		if (uvAccessor.numComponents != 2 || uvAccessor.count != positions.size())
+			throw std::runtime_error("Malformed glTF TEXCOORD_0");
+		for (size_t i = 0; i < texCoords.size(); i++)
+			texCoords[i] = glm::vec2(uvAccessor.component(i, 0), 1.0f - uvAccessor.component(i, 1));
+	}
+
+	std::vector<uint32_t> indices;
+	if (primitive.find("indices"))
+	{
+		GltfAccessor indexAccessor = glb.accessor(primitive.getInt("indices", -1));
+		if (indexAccessor.numComponents != 1)
+			throw std::runtime_error("Malformed glTF indices");
+		indices.resize(indexAccessor.count);
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = indexAccessor.index(i);
+	}
+	else
+	{
+		indices.resize(positions.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			indices[i] = static_cast<uint32_t>(i);
+	}
+
+	bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+	int mtlIndex = primitive.getInt("material", -1) + 1;
+	const GltfJson* gltfMaterials = glb.json.find("materials");
+	if (mtlIndex < 0 || mtlIndex > static_cast<int>(gltfMaterials ? gltfMaterials->size() : 0))
+		throw std::runtime_error("glTF material index out of range");
+
+	auto addTriangle = [&](uint32_t i0, uint32_t i1, uint32_t i2)
+	{
+		if (i0 >= positions.size() || i1 >= positions.size() || i2 >= positions.size())
+			throw std::runtime_error("glTF index out of range");
+		if (mirrored)
+			std::swap(i1, i2);
+
+		glm::vec3 trianglePoints[3] = { positions[i0], positions[i1], positions[i2] };
+		glm::vec2 triangleTexCoords[3] = { texCoords[i0], texCoords[i1], texCoords[i2] };
+		rtxTriangles.push_back(makeObjTriangle(mtlIndex, trianglePoints, triangleTexCoords));
+		bvhTriangles.push_back(BVHTriangle(trianglePoints[0], trianglePoints[1], trianglePoints[2]));
+	};
+
+	if (mode == GLTF_MODE_TRIANGLES)
+	{
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			addTriangle(indices[i], indices[i + 1], indices[i + 2]);
+	}
+	else if (mode == GLTF_MODE_TRIANGLE_STRIP)
+	{
+		for (size_t i = 0; i + 2 < indices.size(); i++)
+		{
+			if (i % 2 == 0)
+				addTriangle(indices[i], indices[i + 1], indices[i + 2]);
+			else
+				addTriangle(indices[i + 1], indices[i], indices[i + 2]);
+		}
+	}
+	else
+	{
+		for (size_t i = 1; i + 1 < indices.size(); i++)
+			addTriangle(indices[0], indices[i], indices[i + 1]);
+	}
+}
+
+/**
+ * @brief Loads the default scene of a .glb file into the same vectors the OBJ path fills.
+ *
+ * Nodes are walked depth first from the scene roots and every mesh instance is flattened into world
+ * space triangles, material indices follow `loadGltfMaterials`. No GL calls, the referenced textures are
+ * queued on the thread pool and uploaded later with `uploadSceneTextures`.
+ *
+ * @param decodeTextures If false, textures are only assigned their indices and nothing is decoded
+ * @throws std::runtime_error on malformed files and on features the loader does not support
+ */
+void loadGlb(const std::filesystem::path& glbPath, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	std::vector<Material>& materials, std::vector<std::future<DecodedTexture>>& pendingTextures, bool decodeTextures = true)
+{
+	GlbDocument glb(glbPath);
+
+	// Materials first, so the texture decodes run while the geometry is read
+	loadGltfMaterials(glb, materials, pendingTextures, decodeTextures);
+
+	const GltfJson* nodes = glb.json.find("nodes");
+	size_t numNodes = nodes ? nodes->size() : 0;
+
+	std::vector<int> roots;
+	const GltfJson* scenes = glb.json.find("scenes");
+	if (scenes && scenes->size() > 0)
+	{
+		const GltfJson* sceneNodes = scenes->at(glb.json.getInt("scene", 0)).find("nodes");
+		for (size_t i = 0; sceneNodes && i < sceneNodes->size(); i++)
+			roots.push_back(static_cast<int>(sceneNodes->at(i).number));
+	}
+	else
+	{
+		// No scene, every node that is nobody's child is a root
+		std::vector<bool> isChild(numNodes, false);
+		for (size_t n = 0; n < numNodes; n++)
+		{
+			const GltfJson* children = nodes->at(n).find("children");
+			for (size_t c = 0; children && c < children->size(); c++)
+			{
+				int child = static_cast<int>(children->at(c).number);
+				if (child >= 0 && child < static_cast<int>(numNodes))
+					isChild[child] = true;
+			}
+		}
+		for (size_t n = 0; n < numNodes; n++)
+			if (!isChild[n])
+				roots.push_back(static_cast<int>(n));
+	}
+
+	struct PendingNode
+	{
+		int index;
+		glm::mat4 parentTransform;
+	};
+	std::vector<PendingNode> stack;
+	for (auto root = roots.rbegin(); root != roots.rend(); ++root)
+		stack.push_back({ *root, glm::mat4(1.0f) });
+
+	size_t numVisited = 0;
+	while (!stack.empty())
+	{
+		PendingNode pending = stack.back();
+		stack.pop_back();
+
+		// A valid glTF node hierarchy is a forest, more visits than nodes means a cycle
+		if (++numVisited > numNodes)
+			throw std::runtime_error("glTF node hierarchy is not a tree");
+
+		const GltfJson& node = glb.get("nodes", pending.index);
+		glm::mat4 transform = pending.parentTransform * gltfNodeTransform(node);
+
+		if (node.find("mesh"))
+		{
+			const GltfJson* primitives = glb.get("meshes", node.getInt("mesh", -1)).find("primitives");
+			for (size_t p = 0; primitives && p < primitives->size(); p++)
+				appendGltfPrimitive(glb, primitives->at(p), transform, rtxTriangles, bvhTriangles);
+		}
+
+		const GltfJson* children = node.find("children");
+		for (size_t c = children ? children->size() : 0; c-- > 0;)
+			stack.push_back({ static_cast<int>(children->at(c).number), transform });
+	}
+}
+
+std::filesystem::path findFirstGlbFile(const std::filesystem::path& folderPath) {
+	return findFirstFileWithExtension(folderPath, ".glb");
+}
+
+/**
+ * @brief `getTrianglesData_` for a model folder holding a .glb file instead of an OBJ.
+ *
+ * @param textures Output textures, texture i is the one of `Material::textureIndex` i
+ * @throws std::runtime_error if the folder has no .glb file or the file cannot be loaded
+ */
+void getGlbTrianglesData(const std::string& folderRelativePath,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	std::vector<Material>& materials, SceneTextures& textures)
+{
+	std::filesystem::path glbFilePath = findFirstGlbFile(folderRelativePath);
+	if (glbFilePath.empty()) {
+		std::cerr << "No .glb file found in selected folder: " << folderRelativePath << std::endl;
+		throw std::runtime_error("GLB file not found");
+	}
+
+	std::cout << "Loading model, please wait..." << std::endl;
+
+	std::vector<std::future<DecodedTexture>> pendingTextures;
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	loadGlb(glbFilePath, rtxTriangles, bvhTriangles, materials, pendingTextures);
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+
+	std::cout << bvhTriangles.size() << " triangles loaded, GLB read in " << loadTime.count() << " ms" << std::endl;
+
+	textures = uploadSceneTextures(pendingTextures);
+}
+
+// True if both triangle sets have the same count and, within float tolerance, the same bounds
+bool sameTriangleBounds(const std::vector<BVHTriangle>& bvhA, const std::vector<BVHTriangle>& bvhB)
+{
+	if (bvhA.size() != bvhB.size())
+		return false;
+
+	glm::vec3 minA(1e30f), maxA(-1e30f), minB(1e30f), maxB(-1e30f);
+	for (const BVHTriangle& tri : bvhA)
+	{
+		minA = glm::min(minA, tri.min);
+		maxA = glm::max(maxA, tri.max);
+	}
+	for (const BVHTriangle& tri : bvhB)
+	{
+		minB = glm::min(minB, tri.min);
+		maxB = glm::max(maxB, tri.max);
+	}
+
+	float tolerance = 1e-4f * std::max(1.0f, glm::length(maxA - minA));
+	return glm::all(glm::lessThanEqual(glm::abs(minA - minB), glm::vec3(tolerance)))
+		&& glm::all(glm::lessThanEqual(glm::abs(maxA - maxB), glm::vec3(tolerance)));
+}
+
+/**
+ * @brief Times the OBJ and GLB loaders on every model folder in `dataFolderPath` that has both files.
+ *
+ * The OBJ side is the MTL parse plus the parallel OBJ parser, the GLB side is `loadGlb`. Textures are
+ * not decoded on either side. Each loader is run `numRuns` times and the fastest run is reported.
+ * Triangle order differs between exporters, so only the triangle count and the scene bounds are compared.
+ */
+void compareModelFormats(const std::string& dataFolderPath, int numRuns = 3)
+{
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(12) << "obj MB"
+		<< std::setw(12) << "glb MB" << std::setw(12) << "obj ms" << std::setw(12) << "glb ms" << std::setw(10) << "speedup"
+		<< "same geometry" << std::endl;
+
+	forEachDataModelFolder(dataFolderPath, [&](const std::filesystem::path& modelFolder, const std::filesystem::path& objFilePath)
+	{
+		std::filesystem::path glbFilePath = findFirstGlbFile(modelFolder);
+		if (glbFilePath.empty())
+			return;
+
+		double objTime = 1e30;
+		double glbTime = 1e30;
+		std::vector<BVHTriangle> objBvh;
+		std::vector<BVHTriangle> glbBvh;
+
+		try {
+			for (int run = 0; run < numRuns; run++)
+			{
+				std::vector<RTXTriangle> rtxTriangles;
+				objBvh.clear();
+
+				auto start = std::chrono::high_resolution_clock::now();
+				TextureReferences textureRefs;
+				std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+				loadMtlLibraries(modelFolder, textureRefs, libToMtlMaps);
+				parseObj(OBJ_PARSER_PARALLEL, objFilePath, libToMtlMaps, rtxTriangles, objBvh);
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+				objTime = std::min(objTime, elapsed.count());
+			}
+
+			for (int run = 0; run < numRuns; run++)
+			{
+				std::vector<RTXTriangle> rtxTriangles;
+				std::vector<Material> materials;
+				std::vector<std::future<DecodedTexture>> pendingTextures;
+				glbBvh.clear();
+
+				auto start = std::chrono::high_resolution_clock::now();
+				loadGlb(glbFilePath, rtxTriangles, glbBvh, materials, pendingTextures, false);
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+				glbTime = std::min(glbTime, elapsed.count());
+			}
+		}
+		catch (...) {
+			std::cout << std::left << std::setw(16) << modelFolder.filename().string() << "failed to load, skipped" << std::endl;
+			return;
+		}
+
+		double objMB = std::filesystem::file_size(objFilePath) / (1024.0 * 1024.0);
+		double glbMB = std::filesystem::file_size(glbFilePath) / (1024.0 * 1024.0);
+
+		std::cout << std::left << std::setw(16) << modelFolder.filename().string() << std::setw(12) << glbBvh.size()
+			<< std::fixed << std::setprecision(2) << std::setw(12) << objMB << std::setw(12) << glbMB
+			<< std::setw(12) << objTime << std::setw(12) << glbTime << std::setw(10) << objTime / std::max(glbTime, 1e-3)
+			<< (sameTriangleBounds(objBvh, glbBvh) ? "yes" : "NO") << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
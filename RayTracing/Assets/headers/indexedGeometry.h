@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <chrono>
+#include <iomanip>
+
+#include <glm/glm.hpp>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/splitGeometry.h>
+
+/*
+ * Shared vertex layout, the alternative to the self contained 80 byte RTXTriangle:
+ *   positions[]   vec4 per vertex (w unused, std430 pads vec3 arrays to 16 bytes anyway)   -> PositionsBlock
+ *   texCoords[]   vec2 per vertex, indexed like positions                                  -> TexCoordsBlock
+ *   triangles[]   IndexedTriangle, 16 bytes                                                -> TrianglesBlock
+ *
+ * A vertex is a unique (position, uv) pair, so vertices are only duplicated along UV seams, like in a
+ * regular GPU vertex buffer. A closed mesh has roughly half as many vertices as triangles, which puts a
+ * triangle at about 16 + 0.5 * 24 bytes instead of 80.
+ */
+
+enum GeometryLayout
+{
+	GEOMETRY_TRIANGLES,	// RTXTriangle, three positions and three UVs inline
+	GEOMETRY_INDEXED,	// IndexedGeometry, shared vertices referenced by index
+	GEOMETRY_SPLIT,		// SplitGeometry, RTXTriangle split into an intersection and an attribute stream, see splitGeometry.h
+};
+
+struct IndexedTriangle
+{
+	int a;
+	int b;
+	int c;
+	int materialIndex; // 16 bytes
+};
+
+// Bytes per TrianglesBlock entry in `layout`
+size_t geometryTriangleSize(GeometryLayout layout)
+{
+	switch (layout)
+	{
+	case GEOMETRY_INDEXED: return sizeof(IndexedTriangle);
+	case GEOMETRY_SPLIT: return sizeof(IntersectionTriangle);
+	default: return sizeof(RTXTriangle);
+	}
+}
+
+struct IndexedGeometry
+{
+	std::vector<glm::vec4> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<IndexedTriangle> triangles;
+
+	size_t sizeInBytes() const
+	{
+		return positions.size() * sizeof(glm::vec4) + texCoords.size() * sizeof(glm::vec2) + triangles.size() * sizeof(IndexedTriangle);
+	}
+};
+
+struct IndexedVertexKey
+{
+	float values[5]; // position xyz, uv
+
+	IndexedVertexKey(const glm::vec4& position, const glm::vec2& uv)
+		: values{ position.x, position.y, position.z, uv.x, uv.y } {}
+
+	// Compared bit for bit, so 0.0 and -0.0 stay apart just like in the hash
+	bool operator==(const IndexedVertexKey& other) const
+	{
+		return std::memcmp(values, other.values, sizeof(values)) == 0;
+	}
+};
+
+struct IndexedVertexKeyHash
+{
+	size_t operator()(const IndexedVertexKey& key) const
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (float value : key.values)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			hash = (hash ^ bits) * 0x100000001b3ull;
+		}
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+};
+
+/**
+ * @brief Converts triangles to the shared vertex layout, merging bitwise identical (position, uv) pairs.
+ *
+ * Triangle order is kept, so `IndexedGeometry::triangles[i]` still matches `bvhTriangles[i]` and can be
+ * reordered by the BVH build in place of the RTXTriangles.
+ */
+IndexedGeometry buildIndexedGeometry(const std::vector<RTXTriangle>& rtxTriangles)
+{
+	IndexedGeometry geometry;
+	geometry.triangles.reserve(rtxTriangles.size());
+	geometry.positions.reserve(rtxTriangles.size());
+	geometry.texCoords.reserve(rtxTriangles.size());
+
+	std::unordered_map<IndexedVertexKey, int, IndexedVertexKeyHash> vertexIndices;
+	vertexIndices.reserve(rtxTriangles.size());
+
+	auto addVertex = [&](const glm::vec4& position, const glm::vec2& uv)
+	{
+		auto inserted = vertexIndices.emplace(IndexedVertexKey(position, uv), static_cast<int>(geometry.positions.size()));
+		if (inserted.second)
+		{
+			geometry.positions.push_back(glm::vec4(glm::vec3(position), 0.0f));
+			geometry.texCoords.push_back(uv);
+		}
+		return inserted.first->second;
+	};
+
+	for (const RTXTriangle& tri : rtxTriangles)
+	{
+		// RTXTriangle stores its UVs rotated (aTex belongs to b, bTex to c, cTex to a), undo it here
+		IndexedTriangle indexed;
+		indexed.a = addVertex(tri.a, tri.cTex);
+		indexed.b = addVertex(tri.b, tri.aTex);
+		indexed.c = addVertex(tri.c, tri.bTex);
+		indexed.materialIndex = tri.materialIndex;
+		geometry.triangles.push_back(indexed);
+	}
+
+	geometry.positions.shrink_to_fit();
+	geometry.texCoords.shrink_to_fit();
+	return geometry;
+}
+
+// True if expanding `geometry` gives back exactly `rtxTriangles`
+bool sameGeometry(const std::vector<RTXTriangle>& rtxTriangles, const IndexedGeometry& geometry)
+{
+	if (rtxTriangles.size() != geometry.triangles.size())
+		return false;
+
+	for (size_t i = 0; i < rtxTriangles.size(); i++)
+	{
+		const RTXTriangle& tri = rtxTriangles[i];
+		const IndexedTriangle& indexed = geometry.triangles[i];
+		if (tri.materialIndex != indexed.materialIndex
+			|| glm::vec3(tri.a) != glm::vec3(geometry.positions[indexed.a])
+			|| glm::vec3(tri.b) != glm::vec3(geometry.positions[indexed.b])
+			|| glm::vec3(tri.c) != glm::vec3(geometry.positions[indexed.c])
+			|| tri.cTex != geometry.texCoords[indexed.a]
+			|| tri.aTex != geometry.texCoords[indexed.b]
+			|| tri.bTex != geometry.texCoords[indexed.c])
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Prints the triangle memory of the geometry layouts for every model folder in `dataFolderPath`.
+ *
+ * Only the buffers that differ between the layouts are counted (TrianglesBlock, PositionsBlock and
+ * TexCoordsBlock), nodes and materials are the same size either way. The split layout is the size of
+ * the triangle one, its column is the intersection stream, what traversal reads.
+ */
+void compareGeometryLayouts(const std::string& dataFolderPath)
+{
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(12) << "vertices"
+		<< std::setw(14) << "triangle MB" << std::setw(14) << "indexed MB" << std::setw(10) << "ratio"
+		<< std::setw(16) << "split hot MB" << std::setw(12) << "build ms" << "lossless" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>&)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		IndexedGeometry geometry = buildIndexedGeometry(rtxTriangles);
+		std::chrono::duration<double, std::milli> buildTime = std::chrono::high_resolution_clock::now() - start;
+
+		double triangleBytes = double(rtxTriangles.size() * sizeof(RTXTriangle));
+		double indexedBytes = double(geometry.sizeInBytes());
+		SplitGeometry splitGeometry = buildSplitGeometry(rtxTriangles);
+		double splitHotBytes = double(splitGeometry.triangles.size() * sizeof(IntersectionTriangle));
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << rtxTriangles.size()
+			<< std::setw(12) << geometry.positions.size() << std::fixed << std::setprecision(2)
+			<< std::setw(14) << triangleBytes / (1024.0 * 1024.0) << std::setw(14) << indexedBytes / (1024.0 * 1024.0)
+			<< std::setw(10) << triangleBytes / std::max(indexedBytes, 1.0) << std::setw(16) << splitHotBytes / (1024.0 * 1024.0)
+			<< std::setw(12) << buildTime.count()
+			<< (sameGeometry(rtxTriangles, geometry) && sameGeometry(rtxTriangles, splitGeometry) ? "yes" : "NO") << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <map>
+
+#include <glm/glm.hpp>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+
+/*
+ * Two level scene layout, for scenes repeating the same meshes:
+ *   NodesBlock       BLAS (bottom level BVH) of every unique mesh, one after the other
+ *   TrianglesBlock   triangles of every unique mesh in BLAS leaf order, stored once however often it is placed
+ *   TLASNodesBlock   TLAS (top level BVH) over the world space boxes of the instances, leaves hold instance ranges
+ *   InstancesBlock   GPUInstance, a world to object transform, its handedness and the root of the instance's BLAS
+ *
+ * The compute shader is compiled with INSTANCING to walk the TLAS and trace each instance it reaches in
+ * object space. Without it NodesBlock is the single BVH of the flattened scene as before.
+ */
+
+// Placement of one of the meshes of `buildInstancedSceneGeometry`
+struct MeshInstance
+{
+	int mesh;
+	glm::mat4 objectToWorld;
+};
+
+// Instance as InstancesBlock stores it
+struct GPUInstance
+{
+	glm::mat4 worldToObject;
+	int blasRoot;	// Root node of the instance's mesh in NodesBlock
+	float handedness;	// 1, or -1 if the transform mirrors the mesh, which turns the winding of its triangles around
+	int pad1;
+	int pad2;		// 80 bytes
+};
+
+// Triangles of one unique mesh, in any order, the BLAS build reorders them
+struct InstancedMesh
+{
+	std::vector<RTXTriangle> rtxTriangles;
+	std::vector<BVHTriangle> bvhTriangles;
+};
+
+// Box around `bounds` after `transform`, from all eight corners
+BoundingBox transformBounds(const BoundingBox& bounds, const glm::mat4& transform)
+{
+	BoundingBox transformed;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point((corner & 1) ? bounds.max.x : bounds.min.x, (corner & 2) ? bounds.max.y : bounds.min.y,
+			(corner & 4) ? bounds.max.z : bounds.min.z);
+		transformed.growToInclude(glm::vec3(transform * glm::vec4(point, 1.0f)));
+	}
+	return transformed;
+}
+
+/**
+ * @brief Builds the TLAS, a BVH whose leaves hold ranges of `instances` instead of triangles.
+ *
+ * `instances` is reordered together with `instanceBounds`, their world space boxes, like triangles are by
+ * a regular build.
+ */
+std::vector<Node> buildTLAS(std::vector<GPUInstance>& instances, const std::vector<BoundingBox>& instanceBounds)
+{
+	std::vector<BVHTriangle> instanceBoxes;
+	instanceBoxes.reserve(instanceBounds.size());
+	for (const BoundingBox& bounds : instanceBounds)
+	{
+		BVHTriangle box(bounds.min, bounds.max, bounds.max);
+		box.center = bounds.center();
+		instanceBoxes.push_back(box);
+	}
+
+	BVH tlas(instanceBoxes, instances, MAX_DEPTH, BVH_BUILDER_BINNED_SAH);
+	return std::move(tlas.allNodes);
+}
+
+/**
+ * @brief `instancesPerSide` x `instancesPerSide` copies of a mesh with `meshBounds`, side by side on the XZ plane.
+ *
+ * The grid is centered on the mesh's own position, so the middle instance is where the single mesh would be.
+ */
+std::vector<MeshInstance> makeInstanceGrid(int mesh, const BoundingBox& meshBounds, int instancesPerSide, float spacing = 1.2f)
+{
+	std::vector<MeshInstance> instances;
+	glm::vec3 step = meshBounds.size() * spacing;
+	float center = (instancesPerSide - 1) * 0.5f;
+	for (int x = 0; x < instancesPerSide; x++)
+	{
+		for (int z = 0; z < instancesPerSide; z++)
+		{
+			glm::vec3 offset((x - center) * step.x, 0.0f, (z - center) * step.z);
+			glm::mat4 objectToWorld(1.0f);
+			objectToWorld[3] = glm::vec4(offset, 1.0f);
+			instances.push_back({ mesh, objectToWorld });
+		}
+	}
+	return instances;
+}
+
+/**
+ * @brief ChildBoundsNode version of the scene's `numNodes` binary nodes, what NodesBlock holds with CHILD_BOUNDS_BVH.
+ *
+ * Like `collapseSceneBVH`, a two level scene has every BLAS converted on its own and `instances` pointed at
+ * the new root of theirs.
+ */
+std::vector<ChildBoundsNode> makeSceneChildBoundsBVH(const Node* nodes, size_t numNodes, std::vector<GPUInstance>& instances)
+{
+	std::vector<ChildBoundsNode> childBoundsNodes;
+	childBoundsNodes.reserve(numNodes / 2 + 1);
+	if (instances.empty())
+	{
+		makeChildBoundsBVH(nodes, 0, childBoundsNodes);
+		return childBoundsNodes;
+	}
+
+	std::map<int, int> roots;
+	for (GPUInstance& instance : instances)
+	{
+		auto root = roots.find(instance.blasRoot);
+		if (root == roots.end())
+			root = roots.emplace(instance.blasRoot, makeChildBoundsBVH(nodes, instance.blasRoot, childBoundsNodes)).first;
+		instance.blasRoot = root->second;
+	}
+	return childBoundsNodes;
+}
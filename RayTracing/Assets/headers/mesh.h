@@ -9,9 +9,17 @@
 #include <algorithm>
 #include <cstring>
 #include <map>
+#include <charconv>
+#include <string_view>
+#include <chrono>
+#include <iomanip>
+#include <functional>
 
 #include <textureClass.h>
 #include <filesUtil/myFile.h>
+#include <filesUtil/mappedFile.h>
+
+#include <Assets/headers/threadPool.h>
 
 const int DIFFUSE = 0;
 const int SPECULAR = 1;
@@ -21,7 +29,11 @@ const int GLASS = 4;
 const int TEXTURE = 5;
 const int GLASS_HIGHLIGHT = 6; // A very specific type of material to use of edges highlight due to back face culling
 
-const int MAX_TEXTURES = 5;
+// Scene textures are grouped into NUM_TEXTURE_ARRAYS texture arrays of square layers, TEXTURE_ARRAY_MIN_SIZE
+// doubling up to TEXTURE_ARRAY_MAX_SIZE (GL 4.3 guarantees 16384). Bigger textures are downsampled to the largest class
+const int TEXTURE_ARRAY_MIN_SIZE = 256;
+const int TEXTURE_ARRAY_MAX_SIZE = 4096;
+const int NUM_TEXTURE_ARRAYS = 5;
 
 struct Material
 {
@@ -220,7 +232,8 @@ int find(const std::string& str, int startPos, char chr)
 }
 
 
-std::filesystem::path findFirstObjFile(const std::filesystem::path& folderPath) {
+// First regular file in `folderPath` with the given extension (".obj", ".glb", ...), empty if there is none
+std::filesystem::path findFirstFileWithExtension(const std::filesystem::path& folderPath, const std::string& extension) {
 	try {
 		std::filesystem::path path(folderPath);
 
@@ -235,7 +248,7 @@ std::filesystem::path findFirstObjFile(const std::filesystem::path& folderPath)
 		}
 
 		for (const auto& entry : std::filesystem::directory_iterator(path)) {
-			if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+			if (entry.is_regular_file() && entry.path().extension() == extension) {
 				return entry.path();
 			}
 		}
@@ -252,73 +265,60 @@ std::filesystem::path findFirstObjFile(const std::filesystem::path& folderPath)
 	return "";
 }
 
+std::filesystem::path findFirstObjFile(const std::filesystem::path& folderPath) {
+	return findFirstFileWithExtension(folderPath, ".obj");
+}
+
 /**
- * @brief Loads 3D model geometry, materials, and textures from an OBJ directory.
+ * @brief Textures referenced by `map_Kd`, registered in first reference order.
  *
- * Given a path to a directory containing a model (OBJ, MTL, textures), this function:
- *  - Automatically locates the first `.obj` file in the directory
- *  - Parses vertex, texture coordinate, and face data from the OBJ file
- *  - Loads any associated `.mtl` material libraries and maps materials to triangle data
- *  - Loads texture files from a `textures/` subdirectory if referenced by materials
- *  - Populates the provided vectors with triangle, BVH, material, and texture data
- *
- * @param folderRelativePath Path to the directory containing model files (relative or absolute)
- * @param dirUpTraversal Number of parent directories to traverse upward (currently unused)
- * @param rtxTriangles Output vector to store RTX-compatible triangle data (for rendering)
- * @param bvhTriangles Output vector to store BVH-compatible triangle data (for acceleration structures)
- * @param materials Output vector to store parsed material properties
- * @param textures Output vector to store loaded textures
- *
- * @throws std::runtime_error if required files (e.g., OBJ) cannot be found or opened
- * @throws std::out_of_range if material references in the OBJ do not exist in MTL files
- *
- * @note Assumes OBJ file is named arbitrarily and located within the provided folder.
- *       Assumes texture images are located in a `textures/` subfolder within the model directory.
- *       Only triangle face definitions are supported.
+ * A material's `textureIndex` indexes `paths`. Every texture is registered once, however many
+ * materials or libraries reference it, and files nobody references are never touched.
  */
-void getTrianglesData_(const std::string& folderRelativePath, int dirUpTraversal,
-	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
-	std::vector<Material>& materials, std::vector<Texture2D>& textures)
+struct TextureReferences
 {
-	size_t namePosStart = folderRelativePath.find_last_of('\\') + 1;
-	size_t namePosEnd = folderRelativePath.find_last_of('.');
-	std::string fileName = folderRelativePath.substr(namePosStart, namePosEnd);
-	std::filesystem::path objFilePath = findFirstObjFile(folderRelativePath);
-	if (objFilePath.empty()) {
-		std::cerr << "No .obj file found in selected folder: " << folderRelativePath << std::endl;
-		throw std::runtime_error("OBJ file not found");
-	}
-
-	std::filesystem::path folderPath = objFilePath.parent_path(); // Ex. Data/campfire
-
-	std::ifstream objFileStream(objFilePath);
-
-	if (!objFileStream.is_open())
-	{
-		std::cout << "Cannot find the OBJ path specified." << std::endl;
-		std::cout << "OBJ path: " << objFilePath << std::endl;
-		throw(errno);
-	}
-
-	std::cout << "Loading model, please wait..." << std::endl;
-
-	// Texture files
-	std::map<std::string, int> texFileToIndex;
-	std::filesystem::path textureFolderPath = std::filesystem::path(folderPath) / "textures";
-	std::vector<std::string> textureNames = getFilenamesInFolder(textureFolderPath.string());
-
-	for (int i = 0; i < textureNames.size(); i++)
+	std::vector<std::filesystem::path> paths;
+	std::map<std::string, int> pathToIndex;
+
+	/**
+	 * @brief Returns the index of a `map_Kd` texture, registering it on first use.
+	 *
+	 * The name is looked up in the model's `textures/` folder first, then relative to the model folder.
+	 *
+	 * @throws std::runtime_error if the file exists in neither place
+	 */
+	int resolve(const std::filesystem::path& folderPath, const std::string& texName)
 	{
-		std::string textureFileName = textureNames[i];
-		std::filesystem::path fullTexPath = textureFolderPath / textureFileName;
+		std::filesystem::path texPath = folderPath / "textures" / texName;
+		if (!std::filesystem::is_regular_file(texPath))
+			texPath = folderPath / texName;
+		if (!std::filesystem::is_regular_file(texPath))
+		{
+			std::cerr << "Texture referenced by map_Kd not found: " << texName << std::endl;
+			throw std::runtime_error("Texture not found");
+		}
 
-		texFileToIndex[textureFileName] = i;
-		Texture2D texture(fullTexPath.string(), GL_TEXTURE0 + i);
-		textures.push_back(texture);
+		std::string key = texPath.lexically_normal().generic_string();
+		auto inserted = pathToIndex.emplace(key, static_cast<int>(paths.size()));
+		if (inserted.second)
+			paths.push_back(texPath.lexically_normal());
+		return inserted.first->second;
 	}
+};
 
-	// MTL files
-	std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+/**
+ * @brief Parses every `.mtl` library found in a model folder.
+ *
+ * Materials are indexed in declaration order starting at 1, index 0 is reserved for the
+ * `_default_` material that is used by faces appearing before any `usemtl` statement.
+ *
+ * @param folderPath Model folder containing the `.mtl` files
+ * @param textureRefs Output, every texture referenced by a `map_Kd`
+ * @param libToMtlMaps Output map of library file name -> material name -> material
+ */
+void loadMtlLibraries(const std::filesystem::path& folderPath, TextureReferences& textureRefs,
+	std::map<std::string, std::map<std::string, Material>>& libToMtlMaps)
+{
 	Material defaultMtl = Material();
 	defaultMtl.index = 0;
 	libToMtlMaps["_default_"]["_default_"] = defaultMtl;
@@ -437,31 +437,32 @@ void getTrianglesData_(const std::string& folderRelativePath, int dirUpTraversal
 					std::string texName;
 					strStream >> texName;
 					nameToMtl[mtlName].materialType = TEXTURE;
-					int index;
-					try {
-						index = texFileToIndex.at(texName);
-					}
-					catch (const std::out_of_range& e) {
-						std::cerr << "Key not found: " << e.what() << std::endl;
-						throw(errno);
-					}
-					nameToMtl[mtlName].textureIndex = index;
+					nameToMtl[mtlName].textureIndex = textureRefs.resolve(folderPath, texName);
 				}
 			}
 		}
 		libToMtlMaps[name] = nameToMtl;
 	}
+}
 
-	// Add materials to the materials vector
-	for (const auto& libNameToMtlDict : libToMtlMaps)
+/**
+ * @brief Reference OBJ parser, reads the file line by line through `std::stringstream`.
+ *
+ * Kept as the baseline for `compareObjParsers`, `parseObjMapped` is the one used for loading.
+ */
+void parseObjStream(const std::filesystem::path& objFilePath,
+	const std::map<std::string, std::map<std::string, Material>>& libToMtlMaps,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+{
+	std::ifstream objFileStream(objFilePath);
+
+	if (!objFileStream.is_open())
 	{
-		for (const auto& mtlNameToMtl : libNameToMtlDict.second)
-		{
-			materials.push_back(mtlNameToMtl.second);
-		}
+		std::cout << "Cannot find the OBJ path specified." << std::endl;
+		std::cout << "OBJ path: " << objFilePath << std::endl;
+		throw(errno);
 	}
 
-	// OBJ file parsing
 	std::vector<glm::vec3> verts;
 	std::vector<glm::vec2> texCoords;
 
@@ -510,7 +511,7 @@ void getTrianglesData_(const std::string& folderRelativePath, int dirUpTraversal
 
 			std::string vertexInfo[3];
 			glm::vec3 trianglePoints[3];
-			glm::vec2 triangleTexCoords[3];
+			glm::vec2 triangleTexCoords[3] = {};
 			bool isTexture = false;
 
 			switch (slashOccurances)
@@ -608,6 +609,919 @@ void getTrianglesData_(const std::string& folderRelativePath, int dirUpTraversal
 			bvhTriangles.push_back(BVHTriangle(trianglePoints[0], trianglePoints[1], trianglePoints[2]));
 		}
 	}
+}
+
+// OBJ tokenizing helpers used by the mapped parsers, they work on [p, end) of a mapped buffer and never allocate
+
+bool isObjSpace(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r';
+}
+
+const char* skipObjSpaces(const char* p, const char* end)
+{
+	while (p < end && isObjSpace(*p))
+		p++;
+	return p;
+}
+
+std::string_view nextObjToken(const char*& p, const char* end)
+{
+	p = skipObjSpaces(p, end);
+	const char* tokenStart = p;
+	while (p < end && !isObjSpace(*p))
+		p++;
+	return std::string_view(tokenStart, p - tokenStart);
+}
+
+bool parseObjFloat(const char*& p, const char* end, float& value)
+{
+	p = skipObjSpaces(p, end);
+	if (p < end && *p == '+') // from_chars does not accept an explicit plus sign
+		p++;
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+		return false;
+	p = result.ptr;
+	return true;
+}
+
+bool parseObjInt(const char*& p, const char* end, int& value)
+{
+	std::from_chars_result result = std::from_chars(p, end, value);
+	if (result.ec != std::errc())
+		return false;
+	p = result.ptr;
+	return true;
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to a 0-based one
+bool resolveObjIndex(int index, size_t count, size_t& resolved)
+{
+	if (index > 0 && static_cast<size_t>(index) <= count)
+	{
+		resolved = static_cast<size_t>(index) - 1;
+		return true;
+	}
+	if (index < 0 && static_cast<size_t>(-static_cast<long long>(index)) <= count)
+	{
+		resolved = count - static_cast<size_t>(-static_cast<long long>(index));
+		return true;
+	}
+	return false;
+}
+
+void parseObjVertex(const char*& p, const char* lineEnd, glm::vec3& v)
+{
+	const char* lineStart = p;
+	if (!parseObjFloat(p, lineEnd, v.x) || !parseObjFloat(p, lineEnd, v.y) || !parseObjFloat(p, lineEnd, v.z))
+	{
+		std::cerr << "Invalid OBJ vertex: v" << std::string_view(lineStart, lineEnd - lineStart) << std::endl;
+		throw std::runtime_error("Invalid OBJ vertex");
+	}
+}
+
+void parseObjTexCoord(const char*& p, const char* lineEnd, glm::vec2& v)
+{
+	const char* lineStart = p;
+	if (!parseObjFloat(p, lineEnd, v.x) || !parseObjFloat(p, lineEnd, v.y))
+	{
+		std::cerr << "Invalid OBJ texture coordinate: vt" << std::string_view(lineStart, lineEnd - lineStart) << std::endl;
+		throw std::runtime_error("Invalid OBJ texture coordinate");
+	}
+}
+
+/**
+ * @brief Reads the three `v`, `v/vt`, `v/vt/vn` or `v//vn` corners of a triangle face.
+ *
+ * Indices are returned exactly as written in the file, `texIndices` is 0 for corners without one.
+ * Throws on malformed corners and on faces that are not triangles.
+ */
+void parseObjFace(const char*& p, const char* lineEnd, int vertIndices[3], int texIndices[3])
+{
+	const char* lineStart = p;
+	int numFaceVerts = 0;
+
+	while (true)
+	{
+		p = skipObjSpaces(p, lineEnd);
+		if (p == lineEnd)
+			break;
+
+		if (numFaceVerts == 3)
+		{
+			std::cerr << "Invalid OBJ file, non-triangle face not supported.\nLine: f" << std::string_view(lineStart, lineEnd - lineStart) << std::endl;
+			throw std::runtime_error("Non-triangle OBJ face");
+		}
+
+		int normalIndex;
+		texIndices[numFaceVerts] = 0;
+		bool validIndices = parseObjInt(p, lineEnd, vertIndices[numFaceVerts]);
+		if (validIndices && p < lineEnd && *p == '/')
+		{
+			p++;
+			if (p < lineEnd && *p != '/')
+				validIndices = parseObjInt(p, lineEnd, texIndices[numFaceVerts]);
+			if (validIndices && p < lineEnd && *p == '/')
+			{
+				p++;
+				validIndices = parseObjInt(p, lineEnd, normalIndex);
+			}
+		}
+
+		if (!validIndices || vertIndices[numFaceVerts] == 0 || (p < lineEnd && !isObjSpace(*p)))
+		{
+			std::cerr << "Invalid OBJ face: f" << std::string_view(lineStart, lineEnd - lineStart) << std::endl;
+			throw std::runtime_error("Invalid OBJ face");
+		}
+		numFaceVerts++;
+	}
+
+	if (numFaceVerts != 3)
+	{
+		std::cerr << "Invalid OBJ file, non-triangle face not supported.\nLine: f" << std::string_view(lineStart, lineEnd - lineStart) << std::endl;
+		throw std::runtime_error("Non-triangle OBJ face");
+	}
+}
+
+int lookupMaterialIndex(const std::map<std::string, std::map<std::string, Material>>& libToMtlMaps,
+	const std::string& lib, const std::string& mtlName)
+{
+	try {
+		return libToMtlMaps.at(lib).at(mtlName).index;
+	}
+	catch (const std::out_of_range& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		std::cerr << "Requested material or library not found: " << lib << ", " << mtlName << std::endl;
+		throw;
+	}
+}
+
+RTXTriangle makeObjTriangle(int mtlIndex, const glm::vec3 trianglePoints[3], const glm::vec2 triangleTexCoords[3])
+{
+	// Texture coordinates are rotated to match the barycentric weights used by the shader
+	return RTXTriangle(mtlIndex,
+		glm::vec4(trianglePoints[0], 0.0f),
+		glm::vec4(trianglePoints[1], 0.0f),
+		glm::vec4(trianglePoints[2], 0.0f),
+		triangleTexCoords[1], triangleTexCoords[2], triangleTexCoords[0]);
+}
+
+// Receives the triangles parsed so far, see `parseObjMapped`
+using ObjBatchCallback = std::function<void(const std::vector<RTXTriangle>&, const std::vector<BVHTriangle>&)>;
+
+/**
+ * @brief Fast OBJ parser, maps the file into memory and parses `v`/`vt`/`f`/`usemtl`/`mtllib` in place.
+ *
+ * Numbers are read with `std::from_chars` straight from the mapped bytes, so apart from the growth
+ * of the vertex and output vectors there is no heap allocation per line. The material of the current
+ * `usemtl` is looked up once when the first face using it is reached instead of for every face.
+ * Produces the same triangles, in the same order, as `parseObjStream`.
+ *
+ * When `onBatch` is set it is called with the triangles parsed so far once `firstBatchSize` triangles
+ * are in, then every time the count has doubled, so a caller rebuilding something over the partial
+ * result does O(n) work in total.
+ */
+void parseObjMapped(const std::filesystem::path& objFilePath,
+	const std::map<std::string, std::map<std::string, Material>>& libToMtlMaps,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	const ObjBatchCallback& onBatch = nullptr, size_t firstBatchSize = 0)
+{
+	size_t nextBatchSize = firstBatchSize;
+
+	MappedFile objFile(objFilePath.string());
+
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec2> texCoords;
+
+	std::string currentLib = "_default_";
+	std::string currentMtlName = "_default_";
+	int currentMtlIndex = -1; // Resolved lazily, -1 means the lib/name pair changed since the last face
+
+	const char* p = objFile.data;
+	const char* fileEnd = objFile.data + objFile.size;
+
+	while (p < fileEnd)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', fileEnd - p));
+		if (lineEnd == nullptr)
+			lineEnd = fileEnd;
+
+		std::string_view lineType = nextObjToken(p, lineEnd);
+
+		if (lineType == "v")
+		{
+			glm::vec3 v;
+			parseObjVertex(p, lineEnd, v);
+			verts.push_back(v);
+		}
+		else if (lineType == "vt")
+		{
+			glm::vec2 v;
+			parseObjTexCoord(p, lineEnd, v);
+			texCoords.push_back(v);
+		}
+		else if (lineType == "f")
+		{
+			int vertIndices[3];
+			int texIndices[3];
+			parseObjFace(p, lineEnd, vertIndices, texIndices);
+
+			glm::vec3 trianglePoints[3];
+			glm::vec2 triangleTexCoords[3] = {};
+			for (int i = 0; i < 3; i++)
+			{
+				size_t vert;
+				size_t tex;
+				if (!resolveObjIndex(vertIndices[i], verts.size(), vert)
+					|| (texIndices[i] != 0 && !resolveObjIndex(texIndices[i], texCoords.size(), tex)))
+					throw std::runtime_error("OBJ face references a missing vertex");
+
+				trianglePoints[i] = verts[vert];
+				if (texIndices[i] != 0)
+					triangleTexCoords[i] = texCoords[tex];
+			}
+
+			if (currentMtlIndex == -1)
+				currentMtlIndex = lookupMaterialIndex(libToMtlMaps, currentLib, currentMtlName);
+
+			rtxTriangles.push_back(makeObjTriangle(currentMtlIndex, trianglePoints, triangleTexCoords));
+			bvhTriangles.push_back(BVHTriangle(trianglePoints[0], trianglePoints[1], trianglePoints[2]));
+
+			if (onBatch && rtxTriangles.size() >= nextBatchSize)
+			{
+				onBatch(rtxTriangles, bvhTriangles);
+				nextBatchSize = rtxTriangles.size() * 2;
+			}
+		}
+		else if (lineType == "usemtl")
+		{
+			std::string_view name = nextObjToken(p, lineEnd);
+			currentMtlName.assign(name.data(), name.size());
+			currentMtlIndex = -1;
+		}
+		else if (lineType == "mtllib")
+		{
+			std::string_view name = nextObjToken(p, lineEnd);
+			currentLib.assign(name.data(), name.size());
+			currentMtlIndex = -1;
+		}
+
+		p = lineEnd < fileEnd ? lineEnd + 1 : fileEnd;
+	}
+}
+
+// Chunks smaller than this are not worth a task of their own
+const size_t OBJ_MIN_CHUNK_BYTES = 256 * 1024;
+
+// Face as parsed inside one chunk, before global vertex offsets are known
+struct ObjChunkFace
+{
+	int verts[3];
+	int texCoords[3];	// -1 when the corner has no texture coordinate
+	int relativeMask;	// Bit i set when corner i was a negative index, stored chunk-local instead of global
+};
+
+// Material state change (`mtllib` or `usemtl`) seen inside a chunk
+struct ObjChunkMtlChange
+{
+	size_t faceIndex; // Index of the first chunk face using the new state
+	bool isLib;
+	std::string name;
+};
+
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec2> texCoords;
+	std::vector<ObjChunkFace> faces;
+	std::vector<ObjChunkMtlChange> mtlChanges;
+
+	// Filled in by the merge step
+	size_t vertBase = 0;
+	size_t texCoordBase = 0;
+	size_t faceBase = 0;
+	int startMtlIndex = -1;
+	std::vector<int> changeMtlIndices; // Material index in effect after each mtlChanges entry, -1 if unresolved
+};
+
+void parseObjChunk(ObjChunk& chunk)
+{
+	const char* p = chunk.begin;
+
+	while (p < chunk.end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+		if (lineEnd == nullptr)
+			lineEnd = chunk.end;
+
+		std::string_view lineType = nextObjToken(p, lineEnd);
+
+		if (lineType == "v")
+		{
+			glm::vec3 v;
+			parseObjVertex(p, lineEnd, v);
+			chunk.verts.push_back(v);
+		}
+		else if (lineType == "vt")
+		{
+			glm::vec2 v;
+			parseObjTexCoord(p, lineEnd, v);
+			chunk.texCoords.push_back(v);
+		}
+		else if (lineType == "f")
+		{
+			int vertIndices[3];
+			int texIndices[3];
+			parseObjFace(p, lineEnd, vertIndices, texIndices);
+
+			ObjChunkFace face;
+			face.relativeMask = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				// Negative indices are relative to the vertices read so far, which is only known locally
+				if (vertIndices[i] < 0)
+				{
+					face.verts[i] = static_cast<int>(chunk.verts.size()) + vertIndices[i];
+					face.relativeMask |= 1 << i;
+				}
+				else
+					face.verts[i] = vertIndices[i] - 1;
+
+				if (texIndices[i] < 0)
+				{
+					face.texCoords[i] = static_cast<int>(chunk.texCoords.size()) + texIndices[i];
+					face.relativeMask |= 1 << (i + 3);
+				}
+				else
+					face.texCoords[i] = texIndices[i] - 1;
+			}
+			chunk.faces.push_back(face);
+		}
+		else if (lineType == "usemtl" || lineType == "mtllib")
+		{
+			std::string_view name = nextObjToken(p, lineEnd);
+			chunk.mtlChanges.push_back({ chunk.faces.size(), lineType == "mtllib", std::string(name) });
+		}
+
+		p = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+	}
+}
+
+/**
+ * @brief Multi-threaded OBJ parser, splits the mapped file into newline aligned chunks parsed in parallel.
+ *
+ * Each chunk collects its own vertices, texture coordinates, faces (with chunk-local indices) and
+ * material changes on the shared thread pool. A sequential prefix-sum pass then computes every chunk's
+ * vertex/face offsets and the `usemtl` state it starts in, and a second parallel pass writes each chunk's
+ * triangles into its own slice of the output. The result is identical, in order, to `parseObjMapped`.
+ *
+ * With `onBatch` the chunks go through these passes in waves of one chunk per thread, in file order, and
+ * `onBatch` gets the triangles of the waves so far like in `parseObjMapped`, not after the last wave. Faces
+ * may then only reference vertices defined before them, which `parseObjMapped` requires as well.
+ */
+void parseObjParallel(const std::filesystem::path& objFilePath,
+	const std::map<std::string, std::map<std::string, Material>>& libToMtlMaps,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	const ObjBatchCallback& onBatch = nullptr, size_t firstBatchSize = 0)
+{
+	ThreadPool& pool = getThreadPool();
+
+	// Split into newline aligned chunks, a few per thread so uneven chunks balance out
+	size_t maxChunks = static_cast<size_t>(pool.size()) * 4;
+	size_t numChunks = std::max<size_t>(1, std::min<size_t>(maxChunks, std::filesystem::file_size(objFilePath) / OBJ_MIN_CHUNK_BYTES));
+	if (numChunks == 1)
+	{
+		// Not worth the merge step
+		parseObjMapped(objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles, onBatch, firstBatchSize);
+		return;
+	}
+
+	MappedFile objFile(objFilePath.string());
+	std::vector<ObjChunk> chunks(numChunks);
+
+	const char* fileEnd = objFile.data + objFile.size;
+	const char* chunkStart = objFile.data;
+	for (size_t i = 0; i < numChunks; i++)
+	{
+		const char* chunkEnd = fileEnd;
+		if (i + 1 < numChunks)
+		{
+			chunkEnd = std::max(chunkStart, objFile.data + objFile.size / numChunks * (i + 1));
+			const char* newline = static_cast<const char*>(std::memchr(chunkEnd, '\n', fileEnd - chunkEnd));
+			chunkEnd = newline ? newline + 1 : fileEnd;
+		}
+		chunks[i].begin = chunkStart;
+		chunks[i].end = chunkEnd;
+		chunkStart = chunkEnd;
+	}
+
+	// Prefix sums of vertex, texture coordinate and face counts, and the material state each chunk starts in
+	size_t numVerts = 0;
+	size_t numTexCoords = 0;
+	size_t numFaces = 0;
+	std::string currentLib = "_default_";
+	std::string currentMtlName = "_default_";
+	int currentMtlIndex = -1;
+	bool currentMtlResolved = false;
+
+	auto resolveCurrentMtl = [&]()
+	{
+		if (!currentMtlResolved)
+		{
+			auto lib = libToMtlMaps.find(currentLib);
+			currentMtlIndex = -1;
+			if (lib != libToMtlMaps.end())
+			{
+				auto mtl = lib->second.find(currentMtlName);
+				if (mtl != lib->second.end())
+					currentMtlIndex = mtl->second.index;
+			}
+			currentMtlResolved = true;
+		}
+		return currentMtlIndex;
+	};
+
+	std::vector<glm::vec3> verts;
+	std::vector<glm::vec2> texCoords;
+	size_t outputBase = rtxTriangles.size();
+	size_t waveSize = onBatch ? static_cast<size_t>(pool.size()) : numChunks;
+	size_t nextBatchSize = firstBatchSize;
+	for (size_t waveStart = 0; waveStart < numChunks; waveStart += waveSize)
+	{
+		int waveCount = static_cast<int>(std::min(waveSize, numChunks - waveStart));
+		ObjChunk* wave = chunks.data() + waveStart;
+		pool.parallelFor(waveCount, [&](int i) { parseObjChunk(wave[i]); });
+
+		for (int c = 0; c < waveCount; c++)
+		{
+			ObjChunk& chunk = wave[c];
+			chunk.vertBase = numVerts;
+			chunk.texCoordBase = numTexCoords;
+			chunk.faceBase = numFaces;
+			chunk.startMtlIndex = resolveCurrentMtl();
+
+			for (const ObjChunkMtlChange& change : chunk.mtlChanges)
+			{
+				(change.isLib ? currentLib : currentMtlName) = change.name;
+				currentMtlResolved = false;
+				chunk.changeMtlIndices.push_back(resolveCurrentMtl());
+			}
+
+			numVerts += chunk.verts.size();
+			numTexCoords += chunk.texCoords.size();
+			numFaces += chunk.faces.size();
+		}
+
+		// Global vertex arrays, every chunk copies its own slice
+		verts.resize(numVerts);
+		texCoords.resize(numTexCoords);
+		pool.parallelFor(waveCount, [&](int i)
+		{
+			std::copy(wave[i].verts.begin(), wave[i].verts.end(), verts.begin() + wave[i].vertBase);
+			std::copy(wave[i].texCoords.begin(), wave[i].texCoords.end(), texCoords.begin() + wave[i].texCoordBase);
+		});
+
+		rtxTriangles.resize(outputBase + numFaces, RTXTriangle(0, glm::vec4(), glm::vec4(), glm::vec4(), glm::vec2(), glm::vec2(), glm::vec2()));
+		bvhTriangles.resize(outputBase + numFaces, BVHTriangle(glm::vec3(), glm::vec3(), glm::vec3()));
+
+		pool.parallelFor(waveCount, [&](int c)
+		{
+			const ObjChunk& chunk = wave[c];
+			int mtlIndex = chunk.startMtlIndex;
+			size_t nextChange = 0;
+
+			for (size_t f = 0; f < chunk.faces.size(); f++)
+			{
+				while (nextChange < chunk.mtlChanges.size() && chunk.mtlChanges[nextChange].faceIndex == f)
+					mtlIndex = chunk.changeMtlIndices[nextChange++];
+
+				if (mtlIndex == -1)
+					throw std::out_of_range("Requested material or library not found");
+
+				const ObjChunkFace& face = chunk.faces[f];
+				glm::vec3 trianglePoints[3];
+				glm::vec2 triangleTexCoords[3] = {};
+				for (int i = 0; i < 3; i++)
+				{
+					long long vert = face.verts[i] + static_cast<long long>((face.relativeMask >> i) & 1 ? chunk.vertBase : 0);
+					if (vert < 0 || static_cast<size_t>(vert) >= numVerts)
+						throw std::runtime_error("OBJ face references a missing vertex");
+					trianglePoints[i] = verts[vert];
+
+					if (face.texCoords[i] == -1 && !((face.relativeMask >> (i + 3)) & 1))
+						continue;
+					long long tex = face.texCoords[i] + static_cast<long long>((face.relativeMask >> (i + 3)) & 1 ? chunk.texCoordBase : 0);
+					if (tex < 0 || static_cast<size_t>(tex) >= numTexCoords)
+						throw std::runtime_error("OBJ face references a missing texture coordinate");
+					triangleTexCoords[i] = texCoords[tex];
+				}
+
+				size_t outputIndex = outputBase + chunk.faceBase + f;
+				rtxTriangles[outputIndex] = makeObjTriangle(mtlIndex, trianglePoints, triangleTexCoords);
+				bvhTriangles[outputIndex] = BVHTriangle(trianglePoints[0], trianglePoints[1], trianglePoints[2]);
+			}
+		});
+
+		if (onBatch && waveStart + waveCount < numChunks && rtxTriangles.size() >= nextBatchSize)
+		{
+			onBatch(rtxTriangles, bvhTriangles);
+			nextBatchSize = rtxTriangles.size() * 2;
+		}
+	}
+}
+
+enum ObjParserMode
+{
+	OBJ_PARSER_STREAM,	// Line by line std::stringstream parser, the original implementation
+	OBJ_PARSER_MAPPED,	// Memory mapped, allocation free parser
+	OBJ_PARSER_PARALLEL,	// Memory mapped parser running on newline aligned chunks across the thread pool
+};
+
+void parseObj(ObjParserMode parserMode, const std::filesystem::path& objFilePath,
+	const std::map<std::string, std::map<std::string, Material>>& libToMtlMaps,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+{
+	switch (parserMode)
+	{
+	case OBJ_PARSER_STREAM:
+		parseObjStream(objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles);
+		break;
+	case OBJ_PARSER_MAPPED:
+		parseObjMapped(objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles);
+		break;
+	case OBJ_PARSER_PARALLEL:
+		parseObjParallel(objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles);
+		break;
+	}
+}
+
+// Side of the layers of texture array `sizeClass`
+int textureArraySize(int sizeClass)
+{
+	return TEXTURE_ARRAY_MIN_SIZE << sizeClass;
+}
+
+// Smallest texture array whose layers hold a width x height image without downsampling it, the largest if none does
+int textureSizeClass(int width, int height)
+{
+	int sizeClass = 0;
+	while (sizeClass + 1 < NUM_TEXTURE_ARRAYS && textureArraySize(sizeClass) < std::max(width, height))
+		sizeClass++;
+	return sizeClass;
+}
+
+/**
+ * @brief A texture ready for upload, already resampled to the layer size of its texture array.
+ *
+ * The source image is freed on the decoding thread as soon as it is resampled, so only the final layers
+ * are held until the upload.
+ */
+struct DecodedTexture
+{
+	std::string path;
+	int width = 0;		// Of the source image
+	int height = 0;
+	int numColCh = 0;
+	int sizeClass = 0;	// See textureSizeClass
+	std::vector<unsigned char> layer;	// RGBA8, textureArraySize(sizeClass) squared
+	double decodeTime = 0.0;	// ms, measured on the decoding thread
+	double resampleTime = 0.0;
+};
+
+DecodedTexture makeDecodedTexture(const TextureImage& image, std::chrono::high_resolution_clock::time_point decodeStart)
+{
+	DecodedTexture texture;
+	texture.path = image.path;
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.numColCh = image.numColCh;
+	texture.sizeClass = textureSizeClass(image.width, image.height);
+
+	auto resampleStart = std::chrono::high_resolution_clock::now();
+	int size = textureArraySize(texture.sizeClass);
+	texture.layer = resampleToRGBA(image, size, size);
+	auto resampleEnd = std::chrono::high_resolution_clock::now();
+	texture.decodeTime = std::chrono::duration<double, std::milli>(resampleStart - decodeStart).count();
+	texture.resampleTime = std::chrono::duration<double, std::milli>(resampleEnd - resampleStart).count();
+	return texture;
+}
+
+// Queues the decode of an image on the thread pool, the GL texture is created later by `uploadSceneTextures`
+std::future<DecodedTexture> decodeTextureAsync(const std::string& path)
+{
+	return getThreadPool().submit([path]()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		return makeDecodedTexture(TextureImage(path), start);
+	});
+}
+
+// Same for an image held in memory (a texture embedded in a .glb), `name` labels it in logs and `SceneTextures::paths`
+std::future<DecodedTexture> decodeTextureAsync(std::vector<unsigned char> encoded, const std::string& name)
+{
+	return getThreadPool().submit([encoded = std::move(encoded), name]()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		return makeDecodedTexture(TextureImage(encoded.data(), encoded.size(), name), start);
+	});
+}
+
+/**
+ * @brief Material textures on the GPU, one texture array per size class.
+ *
+ * Texture i, the `Material::textureIndex`, is layer `layers[i].y` of `arrays[layers[i].x]`. `layers` is uploaded
+ * to TextureLayersBlock, array i is bound to texture unit GL_TEXTURE0 + i and sampled as `textures[i]`.
+ */
+struct SceneTextures
+{
+	Texture2DArray arrays[NUM_TEXTURE_ARRAYS];
+	std::vector<glm::ivec2> layers;
+	std::vector<std::string> paths; // Source image of texture i
+
+	bool isUploaded() const
+	{
+		return arrays[0].ID != 0;
+	}
+
+	void bind()
+	{
+		for (Texture2DArray& array : arrays)
+		{
+			array.SetActive();
+			array.Bind();
+		}
+	}
+
+	void Delete()
+	{
+		for (Texture2DArray& array : arrays)
+			if (array.ID != 0)
+				array.Delete();
+	}
+};
+
+/**
+ * @brief Waits for queued decodes and packs them into `SceneTextures`, texture i keeping index i.
+ *
+ * Must run on the thread owning the GL context. Every texture array gets exactly the layers of its size
+ * class, so a few large textures no longer inflate the small ones. Arrays without textures get one white
+ * 1x1 layer, so every sampler is complete. Decode failures are rethrown here. Prints the decode, resample
+ * and upload time of every texture.
+ */
+SceneTextures uploadSceneTextures(std::vector<std::future<DecodedTexture>>& pendingTextures)
+{
+	std::vector<DecodedTexture> decoded;
+	for (std::future<DecodedTexture>& pending : pendingTextures)
+		decoded.push_back(getThreadPool().wait(pending));
+	pendingTextures.clear();
+
+	SceneTextures textures;
+	int numLayers[NUM_TEXTURE_ARRAYS] = {};
+	for (const DecodedTexture& texture : decoded)
+	{
+		textures.layers.push_back(glm::ivec2(texture.sizeClass, numLayers[texture.sizeClass]++));
+		textures.paths.push_back(texture.path);
+	}
+
+	size_t totalBytes = 0;
+	for (int sizeClass = 0; sizeClass < NUM_TEXTURE_ARRAYS; sizeClass++)
+	{
+		GLenum unit = GL_TEXTURE0 + sizeClass;
+		if (numLayers[sizeClass] == 0)
+		{
+			const unsigned char white[4] = { 255, 255, 255, 255 };
+			textures.arrays[sizeClass] = Texture2DArray(1, 1, 1, unit);
+			textures.arrays[sizeClass].setLayer(0, white);
+			continue;
+		}
+		int size = textureArraySize(sizeClass);
+		textures.arrays[sizeClass] = Texture2DArray(size, size, numLayers[sizeClass], unit);
+		totalBytes += size_t(size) * size * 4 * numLayers[sizeClass];
+		std::cout << "Texture array " << sizeClass << ": " << numLayers[sizeClass] << " layers of " << size << "x" << size << std::endl;
+	}
 
-	std::cout << bvhTriangles.size() << " triangles loaded" << std::endl;
-}
\ No newline at end of file
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		DecodedTexture& texture = decoded[i];
+
+		auto uploadStart = std::chrono::high_resolution_clock::now();
+		textures.arrays[texture.sizeClass].setLayer(textures.layers[i].y, texture.layer.data());
+		std::chrono::duration<double, std::milli> uploadTime = std::chrono::high_resolution_clock::now() - uploadStart;
+		std::vector<unsigned char>().swap(texture.layer);
+
+		std::cout << "Texture " << std::filesystem::path(texture.path).filename().string() << ": "
+			<< texture.width << "x" << texture.height << "x" << texture.numColCh
+			<< ", decoded in " << texture.decodeTime << " ms, resampled in " << texture.resampleTime
+			<< " ms, uploaded in " << uploadTime.count() << " ms" << std::endl;
+	}
+
+	std::cout << "Textures: " << decoded.size() << " in " << NUM_TEXTURE_ARRAYS << " texture arrays, "
+		<< totalBytes / (1024 * 1024) << " MB" << std::endl;
+	return textures;
+}
+
+/**
+ * @brief Loads 3D model geometry, materials, and textures from an OBJ directory.
+ *
+ * Given a path to a directory containing a model (OBJ, MTL, textures), this function:
+ *  - Automatically locates the first `.obj` file in the directory
+ *  - Parses vertex, texture coordinate, and face data from the OBJ file
+ *  - Loads any associated `.mtl` material libraries and maps materials to triangle data
+ *  - Loads the texture files referenced by materials (each once, from `textures/`), images are decoded
+ *    on the thread pool while the OBJ is parsed and uploaded afterwards on the calling (GL context) thread
+ *  - Populates the provided vectors with triangle, BVH, material, and texture data
+ *
+ * @param folderRelativePath Path to the directory containing model files (relative or absolute)
+ * @param dirUpTraversal Number of parent directories to traverse upward (currently unused)
+ * @param rtxTriangles Output vector to store RTX-compatible triangle data (for rendering)
+ * @param bvhTriangles Output vector to store BVH-compatible triangle data (for acceleration structures)
+ * @param materials Output vector to store parsed material properties
+ * @param textures Output textures, texture i is the one of `Material::textureIndex` i
+ * @param parserMode OBJ parser implementation to use, see `ObjParserMode`
+ *
+ * @throws std::runtime_error if required files (e.g., OBJ) cannot be found or opened
+ * @throws std::out_of_range if material references in the OBJ do not exist in MTL files
+ * @throws std::runtime_error if a `map_Kd` texture does not exist
+ *
+ * @note Assumes OBJ file is named arbitrarily and located within the provided folder.
+ *       Assumes texture images are located in a `textures/` subfolder within the model directory.
+ *       Only triangle face definitions are supported.
+ */
+void getTrianglesData_(const std::string& folderRelativePath, int dirUpTraversal,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	std::vector<Material>& materials, SceneTextures& textures,
+	ObjParserMode parserMode = OBJ_PARSER_PARALLEL)
+{
+	std::filesystem::path objFilePath = findFirstObjFile(folderRelativePath);
+	if (objFilePath.empty()) {
+		std::cerr << "No .obj file found in selected folder: " << folderRelativePath << std::endl;
+		throw std::runtime_error("OBJ file not found");
+	}
+
+	std::filesystem::path folderPath = objFilePath.parent_path(); // Ex. Data/campfire
+
+	std::cout << "Loading model, please wait..." << std::endl;
+
+	// MTL files, textures are only registered when a material references them
+	TextureReferences textureRefs;
+	std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+	loadMtlLibraries(folderPath, textureRefs, libToMtlMaps);
+
+	// Referenced textures, decoded in the background while the OBJ is parsed
+	std::vector<std::future<DecodedTexture>> pendingTextures;
+	for (const std::filesystem::path& texturePath : textureRefs.paths)
+		pendingTextures.push_back(decodeTextureAsync(texturePath.string()));
+
+	// Add materials to the materials vector
+	for (const auto& libNameToMtlDict : libToMtlMaps)
+	{
+		for (const auto& mtlNameToMtl : libNameToMtlDict.second)
+		{
+			materials.push_back(mtlNameToMtl.second);
+		}
+	}
+
+	// OBJ file parsing
+	auto parseStart = std::chrono::high_resolution_clock::now();
+	parseObj(parserMode, objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles);
+	std::chrono::duration<double, std::milli> parseTime = std::chrono::high_resolution_clock::now() - parseStart;
+
+	std::cout << bvhTriangles.size() << " triangles loaded, OBJ parsed in " << parseTime.count() << " ms" << std::endl;
+
+	textures = uploadSceneTextures(pendingTextures);
+}
+
+bool sameTriangles(const std::vector<RTXTriangle>& rtxA, const std::vector<BVHTriangle>& bvhA,
+	const std::vector<RTXTriangle>& rtxB, const std::vector<BVHTriangle>& bvhB)
+{
+	if (rtxA.size() != rtxB.size() || bvhA.size() != bvhB.size())
+		return false;
+
+	for (size_t i = 0; i < rtxA.size(); i++)
+	{
+		const RTXTriangle& a = rtxA[i];
+		const RTXTriangle& b = rtxB[i];
+		if (a.materialIndex != b.materialIndex || a.a != b.a || a.b != b.b || a.c != b.c
+			|| a.aTex != b.aTex || a.bTex != b.bTex || a.cTex != b.cTex)
+			return false;
+	}
+
+	for (size_t i = 0; i < bvhA.size(); i++)
+	{
+		if (bvhA[i].min != bvhB[i].min || bvhA[i].max != bvhB[i].max || bvhA[i].center != bvhB[i].center)
+			return false;
+	}
+
+	return true;
+}
+
+// Calls `onModelFolder` with every folder in `dataFolderPath` that holds an OBJ file and its first OBJ, in name order
+void forEachDataModelFolder(const std::string& dataFolderPath,
+	const std::function<void(const std::filesystem::path& modelFolder, const std::filesystem::path& objFilePath)>& onModelFolder)
+{
+	std::vector<std::filesystem::path> modelFolders;
+	for (const auto& entry : std::filesystem::directory_iterator(dataFolderPath))
+		if (entry.is_directory())
+			modelFolders.push_back(entry.path());
+	std::sort(modelFolders.begin(), modelFolders.end());
+
+	for (const std::filesystem::path& modelFolder : modelFolders)
+	{
+		std::filesystem::path objFilePath = findFirstObjFile(modelFolder);
+		if (!objFilePath.empty())
+			onModelFolder(modelFolder, objFilePath);
+	}
+}
+
+/**
+ * @brief Parses the OBJ of every model folder in `dataFolderPath`, in name order, and hands its triangles to `onModel`.
+ *
+ * For the compare tools. Textures are not decoded, `map_Kd` references are only resolved. A model that fails
+ * to load gets a "failed to load, skipped" row in the table and is not passed on.
+ */
+void forEachDataModel(const std::string& dataFolderPath,
+	const std::function<void(const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)>& onModel)
+{
+	forEachDataModelFolder(dataFolderPath, [&](const std::filesystem::path& modelFolder, const std::filesystem::path& objFilePath)
+	{
+		std::string modelName = modelFolder.filename().string();
+		std::vector<RTXTriangle> rtxTriangles;
+		std::vector<BVHTriangle> bvhTriangles;
+		try {
+			TextureReferences textureRefs;
+			std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+			loadMtlLibraries(modelFolder, textureRefs, libToMtlMaps);
+			parseObj(OBJ_PARSER_PARALLEL, objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles);
+		}
+		catch (...) {
+			std::cout << std::left << std::setw(16) << modelName << "failed to load, skipped" << std::endl;
+			return;
+		}
+		onModel(modelName, rtxTriangles, bvhTriangles);
+	});
+}
+
+/**
+ * @brief Times every OBJ parser on every model folder in `dataFolderPath` and checks they agree.
+ *
+ * Textures are not decoded, `map_Kd` references are only resolved.
+ * Each parser is run `numRuns` times and the fastest run is reported.
+ */
+void compareObjParsers(const std::string& dataFolderPath, int numRuns = 3)
+{
+	const ObjParserMode modes[] = { OBJ_PARSER_STREAM, OBJ_PARSER_MAPPED, OBJ_PARSER_PARALLEL };
+	const char* modeNames[] = { "stream", "mapped", "parallel" };
+	const int numModes = sizeof(modes) / sizeof(modes[0]);
+
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles";
+	for (int m = 0; m < numModes; m++)
+		std::cout << std::setw(14) << (std::string(modeNames[m]) + " ms");
+	std::cout << std::setw(10) << "speedup" << "identical" << std::endl;
+
+	forEachDataModelFolder(dataFolderPath, [&](const std::filesystem::path& modelFolder, const std::filesystem::path& objFilePath)
+	{
+		double bestTimes[numModes];
+		std::vector<RTXTriangle> rtxResults[numModes];
+		std::vector<BVHTriangle> bvhResults[numModes];
+
+		try {
+			TextureReferences textureRefs;
+			std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+			loadMtlLibraries(modelFolder, textureRefs, libToMtlMaps);
+
+			for (int m = 0; m < numModes; m++)
+			{
+				bestTimes[m] = 1e30;
+				for (int run = 0; run < numRuns; run++)
+				{
+					rtxResults[m].clear();
+					bvhResults[m].clear();
+
+					auto start = std::chrono::high_resolution_clock::now();
+					parseObj(modes[m], objFilePath, libToMtlMaps, rtxResults[m], bvhResults[m]);
+					std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+					bestTimes[m] = std::min(bestTimes[m], elapsed.count());
+				}
+			}
+		}
+		catch (...) {
+			std::cout << std::left << std::setw(16) << modelFolder.filename().string() << "failed to load, skipped" << std::endl;
+			return;
+		}
+
+		bool identical = true;
+		for (int m = 1; m < numModes; m++)
+			identical = identical && sameTriangles(rtxResults[0], bvhResults[0], rtxResults[m], bvhResults[m]);
+
+		std::cout << std::left << std::setw(16) << modelFolder.filename().string() << std::setw(12) << rtxResults[0].size();
+		for (int m = 0; m < numModes; m++)
+			std::cout << std::setw(14) << std::fixed << std::setprecision(2) << bestTimes[m];
+		std::cout << std::setw(10) << std::setprecision(2) << bestTimes[0] / bestTimes[numModes - 1]
+			<< (identical ? "yes" : "NO") << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,408 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+#include <glm/glm.hpp>
+
+#include <filesUtil/mappedFile.h>
+
+#include <Assets/headers/mesh.h>
+
+/*
+ * Binary PLY loader for scanned meshes:
+ *   text header    "ply", "format binary_little_endian 1.0" (or big endian), then element / property
+ *                  declarations up to "end_header"
+ *   body           every element's records back to back in declaration order, read from the mapped file
+ *
+ * Only `vertex` (x, y, z and optionally u/v, s/t or texture_u/texture_v) and `face` (vertex_indices or
+ * vertex_index) are used, other elements and properties are skipped. Polygons are triangulated as fans.
+ * PLY files carry no materials, every triangle gets the single material passed to the loader.
+ */
+
+enum PlyType
+{
+	PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+};
+
+struct PlyProperty
+{
+	std::string name;
+	PlyType type = PLY_FLOAT32;
+	bool isList = false;
+	PlyType countType = PLY_UINT8;	// List properties only
+	size_t offset = 0;				// Byte offset in the record, only valid while every earlier property has a fixed size
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+	size_t recordSize = 0;			// Fixed record size, 0 if the element has list properties
+
+	int findProperty(std::initializer_list<const char*> names) const
+	{
+		for (const char* name : names)
+			for (size_t i = 0; i < properties.size(); i++)
+				if (properties[i].name == name)
+					return static_cast<int>(i);
+		return -1;
+	}
+};
+
+size_t plyTypeSize(PlyType type)
+{
+	switch (type)
+	{
+	case PLY_INT8: case PLY_UINT8: return 1;
+	case PLY_INT16: case PLY_UINT16: return 2;
+	case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+	case PLY_FLOAT64: return 8;
+	}
+	return 0;
+}
+
+PlyType parsePlyType(const std::string& name)
+{
+	if (name == "char" || name == "int8") return PLY_INT8;
+	if (name == "uchar" || name == "uint8") return PLY_UINT8;
+	if (name == "short" || name == "int16") return PLY_INT16;
+	if (name == "ushort" || name == "uint16") return PLY_UINT16;
+	if (name == "int" || name == "int32") return PLY_INT32;
+	if (name == "uint" || name == "uint32") return PLY_UINT32;
+	if (name == "float" || name == "float32") return PLY_FLOAT32;
+	if (name == "double" || name == "float64") return PLY_FLOAT64;
+	std::cerr << "Unknown PLY property type: " << name << std::endl;
+	throw std::runtime_error("Malformed PLY header");
+}
+
+// Reads one value of `type` at `p` as a double, byte swapping when the file is big endian
+double readPlyValue(const unsigned char* p, PlyType type, bool bigEndian)
+{
+	unsigned char bytes[8];
+	size_t size = plyTypeSize(type);
+	for (size_t i = 0; i < size; i++)
+		bytes[i] = bigEndian ? p[size - 1 - i] : p[i];
+
+	switch (type)
+	{
+	case PLY_INT8: { int8_t v; std::memcpy(&v, bytes, 1); return v; }
+	case PLY_UINT8: return bytes[0];
+	case PLY_INT16: { int16_t v; std::memcpy(&v, bytes, 2); return v; }
+	case PLY_UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); return v; }
+	case PLY_INT32: { int32_t v; std::memcpy(&v, bytes, 4); return v; }
+	case PLY_UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); return v; }
+	case PLY_FLOAT32: { float v; std::memcpy(&v, bytes, 4); return v; }
+	case PLY_FLOAT64: { double v; std::memcpy(&v, bytes, 8); return v; }
+	}
+	return 0.0;
+}
+
+/**
+ * @brief Parses the PLY header, returns the offset of the first body byte.
+ *
+ * @throws std::runtime_error for ASCII files and malformed headers
+ */
+size_t parsePlyHeader(const char* data, size_t size, std::vector<PlyElement>& elements, bool& bigEndian)
+{
+	// The first occurrence is in the header, the search never reaches the body
+	size_t headerEndOffset = std::string_view(data, size).find("end_header");
+	if (size < 3 || std::memcmp(data, "ply", 3) != 0 || headerEndOffset == std::string_view::npos)
+		throw std::runtime_error("Not a PLY file");
+	const char* headerEnd = data + headerEndOffset;
+
+	// Body starts after the end_header line, whatever its line ending
+	const char* body = static_cast<const char*>(std::memchr(headerEnd, '\n', data + size - headerEnd));
+	if (!body)
+		throw std::runtime_error("Malformed PLY header");
+
+	std::stringstream header(std::string(data, headerEnd));
+	std::string line;
+	bool hasFormat = false;
+	while (std::getline(header, line))
+	{
+		std::stringstream strStream(line);
+		std::string key;
+		strStream >> key;
+
+		if (key == "format")
+		{
+			std::string format;
+			strStream >> format;
+			if (format == "ascii")
+				throw std::runtime_error("ASCII PLY files are not supported, only binary ones");
+			if (format != "binary_little_endian" && format != "binary_big_endian")
+				throw std::runtime_error("Malformed PLY header");
+			bigEndian = format == "binary_big_endian";
+			hasFormat = true;
+		}
+		else if (key == "element")
+		{
+			PlyElement element;
+			strStream >> element.name >> element.count;
+			if (strStream.fail())
+				throw std::runtime_error("Malformed PLY header");
+			elements.push_back(element);
+		}
+		else if (key == "property")
+		{
+			if (elements.empty())
+				throw std::runtime_error("Malformed PLY header");
+
+			PlyProperty property;
+			std::string type;
+			strStream >> type;
+			if (type == "list")
+			{
+				std::string countType, itemType;
+				strStream >> countType >> itemType;
+				property.isList = true;
+				property.countType = parsePlyType(countType);
+				property.type = parsePlyType(itemType);
+			}
+			else
+				property.type = parsePlyType(type);
+			strStream >> property.name;
+			if (strStream.fail())
+				throw std::runtime_error("Malformed PLY header");
+			elements.back().properties.push_back(property);
+		}
+		// "comment", "obj_info" and the "ply" magic line are ignored
+	}
+	if (!hasFormat)
+		throw std::runtime_error("Malformed PLY header");
+
+	for (PlyElement& element : elements)
+	{
+		size_t offset = 0;
+		bool fixedSize = true;
+		for (PlyProperty& property : element.properties)
+		{
+			property.offset = offset;
+			if (property.isList)
+				fixedSize = false;
+			offset += plyTypeSize(property.type);
+		}
+		element.recordSize = fixedSize ? offset : 0;
+	}
+
+	return body + 1 - data;
+}
+
+/**
+ * @brief Loads a binary PLY mesh into the same vectors the OBJ path fills.
+ *
+ * Vertices are read straight from the mapped body, fixed size records with a stride, faces are walked
+ * once and triangulated as fans (v0, vi, vi+1). Faces with fewer than three vertices are skipped.
+ * Every triangle gets material index 0, `materials` receives `material` as that single entry.
+ *
+ * @throws std::runtime_error on ASCII or malformed files and on out of range vertex indices
+ */
+void loadPly(const std::filesystem::path& plyPath, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	std::vector<Material>& materials, const Material& material = Material())
+{
+	MappedFile plyFile(plyPath.string());
+	if (!plyFile.isOpen())
+	{
+		std::cerr << "Failed to open PLY file: " << plyPath << std::endl;
+		throw std::runtime_error("PLY file not found");
+	}
+
+	std::vector<PlyElement> elements;
+	bool bigEndian = false;
+	size_t offset = parsePlyHeader(plyFile.data, plyFile.size, elements, bigEndian);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(plyFile.data);
+
+	auto require = [&](size_t numBytes)
+	{
+		if (numBytes > plyFile.size - offset)
+			throw std::runtime_error("Truncated PLY file");
+	};
+
+	Material plyMaterial = material;
+	plyMaterial.index = 0;
+	materials.push_back(plyMaterial);
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> polygon;
+
+	for (const PlyElement& element : elements)
+	{
+		if (element.name == "vertex")
+		{
+			if (element.recordSize == 0)
+				throw std::runtime_error("PLY vertices with list properties are not supported");
+			int x = element.findProperty({ "x" });
+			int y = element.findProperty({ "y" });
+			int z = element.findProperty({ "z" });
+			int u = element.findProperty({ "u", "s", "texture_u" });
+			int v = element.findProperty({ "v", "t", "texture_v" });
+			if (x < 0 || y < 0 || z < 0)
+				throw std::runtime_error("PLY vertices without x, y, z");
+
+			if (element.count > (plyFile.size - offset) / element.recordSize)
+				throw std::runtime_error("Truncated PLY file");
+
+			const PlyProperty* props = element.properties.data();
+			bool floatPositions = !bigEndian && props[x].type == PLY_FLOAT32 && props[y].type == PLY_FLOAT32 && props[z].type == PLY_FLOAT32;
+			positions.resize(element.count);
+			texCoords.assign(element.count, glm::vec2(0.0f));
+			for (size_t i = 0; i < element.count; i++)
+			{
+				const unsigned char* record = bytes + offset + i * element.recordSize;
+				if (floatPositions)
+				{
+					std::memcpy(&positions[i].x, record + props[x].offset, sizeof(float));
+					std::memcpy(&positions[i].y, record + props[y].offset, sizeof(float));
+					std::memcpy(&positions[i].z, record + props[z].offset, sizeof(float));
+				}
+				else
+					positions[i] = glm::vec3(
+						readPlyValue(record + props[x].offset, props[x].type, bigEndian),
+						readPlyValue(record + props[y].offset, props[y].type, bigEndian),
+						readPlyValue(record + props[z].offset, props[z].type, bigEndian));
+				if (u >= 0 && v >= 0)
+					texCoords[i] = glm::vec2(
+						readPlyValue(record + props[u].offset, props[u].type, bigEndian),
+						readPlyValue(record + props[v].offset, props[v].type, bigEndian));
+			}
+			offset += element.count * element.recordSize;
+		}
+		else if (element.name == "face")
+		{
+			int indicesProperty = element.findProperty({ "vertex_indices", "vertex_index" });
+			if (indicesProperty < 0 || !element.properties[indicesProperty].isList)
+				throw std::runtime_error("PLY faces without vertex_indices");
+
+			// Triangle meshes are by far the common case, reserve for them
+			rtxTriangles.reserve(rtxTriangles.size() + element.count);
+			bvhTriangles.reserve(bvhTriangles.size() + element.count);
+
+			// Layout written by most scanners: the index list is the only property, uchar count and 32 bit indices
+			const PlyProperty& indexList = element.properties[indicesProperty];
+			bool packedFaces = !bigEndian && element.properties.size() == 1 && indexList.countType == PLY_UINT8
+				&& (indexList.type == PLY_INT32 || indexList.type == PLY_UINT32);
+
+			for (size_t f = 0; f < element.count; f++)
+			{
+				if (packedFaces)
+				{
+					require(1);
+					size_t numItems = bytes[offset++];
+					require(numItems * sizeof(uint32_t));
+					polygon.resize(numItems);
+					std::memcpy(polygon.data(), bytes + offset, numItems * sizeof(uint32_t));
+					offset += numItems * sizeof(uint32_t);
+					for (uint32_t index : polygon)
+						if (index >= positions.size()) // Negative int32 indices wrap around and fail here too
+							throw std::runtime_error("PLY vertex index out of range");
+				}
+
+				for (int p = 0; !packedFaces && p < static_cast<int>(element.properties.size()); p++)
+				{
+					const PlyProperty& property = element.properties[p];
+					size_t itemSize = plyTypeSize(property.type);
+					size_t numItems = 1;
+					if (property.isList)
+					{
+						size_t countSize = plyTypeSize(property.countType);
+						require(countSize);
+						double count = readPlyValue(bytes + offset, property.countType, bigEndian);
+						if (count < 0)
+							throw std::runtime_error("Malformed PLY face");
+						numItems = static_cast<size_t>(count);
+						offset += countSize;
+					}
+					require(numItems * itemSize);
+
+					if (p == indicesProperty)
+					{
+						polygon.resize(numItems);
+						for (size_t i = 0; i < numItems; i++)
+						{
+							double index = readPlyValue(bytes + offset + i * itemSize, property.type, bigEndian);
+							if (index < 0 || index >= positions.size())
+								throw std::runtime_error("PLY vertex index out of range");
+							polygon[i] = static_cast<uint32_t>(index);
+						}
+					}
+					offset += numItems * itemSize;
+				}
+
+				for (size_t i = 1; i + 1 < polygon.size(); i++)
+				{
+					glm::vec3 trianglePoints[3] = { positions[polygon[0]], positions[polygon[i]], positions[polygon[i + 1]] };
+					glm::vec2 triangleTexCoords[3] = { texCoords[polygon[0]], texCoords[polygon[i]], texCoords[polygon[i + 1]] };
+					rtxTriangles.push_back(makeObjTriangle(0, trianglePoints, triangleTexCoords));
+					bvhTriangles.push_back(BVHTriangle(trianglePoints[0], trianglePoints[1], trianglePoints[2]));
+				}
+				polygon.clear();
+			}
+		}
+		else
+		{
+			// Unused element, skip its records
+			if (element.recordSize != 0)
+			{
+				if (element.count > (plyFile.size - offset) / element.recordSize)
+					throw std::runtime_error("Truncated PLY file");
+				offset += element.count * element.recordSize;
+				continue;
+			}
+			for (size_t r = 0; r < element.count; r++)
+			{
+				for (const PlyProperty& property : element.properties)
+				{
+					size_t numItems = 1;
+					if (property.isList)
+					{
+						require(plyTypeSize(property.countType));
+						numItems = static_cast<size_t>(std::max(0.0, readPlyValue(bytes + offset, property.countType, bigEndian)));
+						offset += plyTypeSize(property.countType);
+					}
+					require(numItems * plyTypeSize(property.type));
+					offset += numItems * plyTypeSize(property.type);
+				}
+			}
+		}
+	}
+}
+
+std::filesystem::path findFirstPlyFile(const std::filesystem::path& folderPath) {
+	return findFirstFileWithExtension(folderPath, ".ply");
+}
+
+/**
+ * @brief `getTrianglesData_` for a model folder holding a binary .ply file.
+ *
+ * @param material Material given to every triangle, PLY files have none of their own
+ * @param textures Output textures, none since PLY models are untextured
+ * @throws std::runtime_error if the folder has no .ply file or the file cannot be loaded
+ */
+void getPlyTrianglesData(const std::string& folderRelativePath,
+	std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles,
+	std::vector<Material>& materials, SceneTextures& textures, const Material& material = Material())
+{
+	std::filesystem::path plyFilePath = findFirstPlyFile(folderRelativePath);
+	if (plyFilePath.empty()) {
+		std::cerr << "No .ply file found in selected folder: " << folderRelativePath << std::endl;
+		throw std::runtime_error("PLY file not found");
+	}
+
+	std::cout << "Loading model, please wait..." << std::endl;
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	loadPly(plyFilePath, rtxTriangles, bvhTriangles, materials, material);
+	std::chrono::duration<double, std::milli> loadTime = std::chrono::high_resolution_clock::now() - loadStart;
+
+	std::cout << bvhTriangles.size() << " triangles loaded, PLY read in " << loadTime.count() << " ms" << std::endl;
+
+	std::vector<std::future<DecodedTexture>> noTextures;
+	textures = uploadSceneTextures(noTextures);
+}
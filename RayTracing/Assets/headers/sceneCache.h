@@ -0,0 +1,390 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include <filesUtil/mappedFile.h>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+#include <Assets/headers/indexedGeometry.h>
+
+/*
+ * .rtscene layout (all offsets from the start of the file, every section 64 byte aligned):
+ *   SceneCacheHeader
+ *   triangles[numTriangles]     RTXTriangle, IndexedTriangle or IntersectionTriangle depending on geometryLayout,
+ *                               already reordered by the BVH build, uploaded as is to TrianglesBlock
+ *   vec4[numVertices]           GEOMETRY_INDEXED only, PositionsBlock
+ *   vec2[numVertices]           GEOMETRY_INDEXED only, TexCoordsBlock
+ *   TriangleAttributes[numTriangles]   GEOMETRY_SPLIT only, TriangleAttributesBlock
+ *   Node[numNodes]              BVH::allNodes, uploaded as is to NodesBlock
+ *   Material[numMaterials]
+ *   texture references          per texture: uint32 texture index, uint32 path length, path bytes (relative to the model folder)
+ */
+
+const uint32_t SCENE_CACHE_MAGIC = 0x4E435352; // "RSCN"
+const uint32_t SCENE_CACHE_VERSION = 5;
+const uint64_t SCENE_CACHE_ALIGNMENT = 64;
+
+struct SceneCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t contentHash;
+
+	// Struct sizes at write time, a layout change without a version bump is still rejected
+	uint32_t triangleSize;
+	uint32_t nodeSize;
+	uint32_t materialSize;
+	uint32_t geometryLayout;
+
+	// BVH build settings, the nodes and the triangle order depend on them
+	uint32_t bvhBuilder;
+	uint32_t bvhOptimizeIterations;
+	uint32_t bvhLayout;
+	uint32_t pad;
+
+	uint64_t numTriangles;
+	uint64_t trianglesOffset;
+	uint64_t numVertices;
+	uint64_t positionsOffset;
+	uint64_t texCoordsOffset;
+	uint64_t attributesOffset;
+	uint64_t numNodes;
+	uint64_t nodesOffset;
+	uint64_t numMaterials;
+	uint64_t materialsOffset;
+	uint64_t numTextures;
+	uint64_t texturesOffset;
+};
+
+struct SceneCacheTexture
+{
+	int index; // Material::textureIndex
+	std::string relativePath;
+};
+
+uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+{
+	// FNV-1a, fed 8 bytes at a time so hashing stays I/O bound
+	const uint64_t prime = 0x100000001b3ull;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; i++)
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+	return hash;
+}
+
+std::filesystem::path sceneCachePath(const std::filesystem::path& folderPath)
+{
+	std::filesystem::path folder = folderPath;
+	if (!folder.has_filename())
+		folder = folder.parent_path();
+	return folder / (folder.filename().string() + ".rtscene");
+}
+
+/**
+ * @brief Hashes the relative path, size and content of every file under a model folder.
+ *
+ * Cache files themselves are skipped, so writing the cache does not invalidate it.
+ */
+uint64_t hashModelFolder(const std::filesystem::path& folderPath)
+{
+	std::vector<std::filesystem::path> files;
+	for (const auto& entry : std::filesystem::recursive_directory_iterator(folderPath))
+		if (entry.is_regular_file() && entry.path().extension() != ".rtscene")
+			files.push_back(entry.path());
+	std::sort(files.begin(), files.end());
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	hash = hashBytes(hash, reinterpret_cast<const char*>(&SCENE_CACHE_VERSION), sizeof(SCENE_CACHE_VERSION));
+	for (const std::filesystem::path& file : files)
+	{
+		std::string relativePath = file.lexically_relative(folderPath).generic_string();
+		hash = hashBytes(hash, relativePath.data(), relativePath.size());
+
+		MappedFile mapped(file.string());
+		hash = hashBytes(hash, reinterpret_cast<const char*>(&mapped.size), sizeof(mapped.size));
+		hash = hashBytes(hash, mapped.data, mapped.size);
+	}
+	return hash;
+}
+
+uint64_t alignSceneCacheOffset(uint64_t offset)
+{
+	return (offset + SCENE_CACHE_ALIGNMENT - 1) / SCENE_CACHE_ALIGNMENT * SCENE_CACHE_ALIGNMENT;
+}
+
+void writeSceneCacheSection(std::ofstream& out, uint64_t& offset, const void* data, uint64_t size)
+{
+	uint64_t alignedOffset = alignSceneCacheOffset(offset);
+	static const char zeros[SCENE_CACHE_ALIGNMENT] = {};
+	out.write(zeros, alignedOffset - offset);
+	out.write(static_cast<const char*>(data), size);
+	offset = alignedOffset + size;
+}
+
+/**
+ * @brief Writes the final, BVH ordered scene to a .rtscene file.
+ *
+ * The file is written next to the destination and renamed over it once complete, so an interrupted
+ * write never leaves a truncated cache behind.
+ *
+ * @param bvhBuilder, bvhOptimizeIterations, bvhLayout Settings the nodes were built with, `SceneCache::open` rejects the file when they change
+ * @return false if the file could not be written (the scene is still usable, only the cache is missing)
+ */
+bool writeSceneCache(const std::filesystem::path& cachePath, uint64_t contentHash, GeometryLayout geometryLayout,
+	BVHBuilder bvhBuilder, int bvhOptimizeIterations, BVHLayout bvhLayout,
+	const std::vector<RTXTriangle>& rtxTriangles, const IndexedGeometry& indexedGeometry, const SplitGeometry& splitGeometry,
+	const std::vector<Node>& nodes, const std::vector<Material>& materials, const SceneTextures& textures)
+{
+	bool indexed = geometryLayout == GEOMETRY_INDEXED;
+	bool split = geometryLayout == GEOMETRY_SPLIT;
+
+	// Textures are reloaded from their files, images embedded in a .glb have none
+	for (const std::string& texturePath : textures.paths)
+	{
+		if (!std::filesystem::is_regular_file(texturePath))
+		{
+			std::cout << "Scene cache not written, texture is not a file: " << texturePath << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::path tempPath = cachePath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+		{
+			std::cerr << "Failed to write scene cache: " << cachePath << std::endl;
+			return false;
+		}
+
+		SceneCacheHeader header = {};
+		header.magic = SCENE_CACHE_MAGIC;
+		header.version = SCENE_CACHE_VERSION;
+		header.contentHash = contentHash;
+		header.triangleSize = static_cast<uint32_t>(geometryTriangleSize(geometryLayout));
+		header.nodeSize = sizeof(Node);
+		header.materialSize = sizeof(Material);
+		header.geometryLayout = geometryLayout;
+		header.bvhBuilder = bvhBuilder;
+		header.bvhOptimizeIterations = static_cast<uint32_t>(bvhOptimizeIterations);
+		header.bvhLayout = bvhLayout;
+		header.numTriangles = indexed ? indexedGeometry.triangles.size() : split ? splitGeometry.triangles.size() : rtxTriangles.size();
+		header.numVertices = indexed ? indexedGeometry.positions.size() : 0;
+		header.numNodes = nodes.size();
+		header.numMaterials = materials.size();
+		header.numTextures = textures.paths.size();
+
+		// Header is rewritten once the section offsets are known
+		uint64_t offset = 0;
+		writeSceneCacheSection(out, offset, &header, sizeof(header));
+
+		header.trianglesOffset = alignSceneCacheOffset(offset);
+		if (indexed)
+			writeSceneCacheSection(out, offset, indexedGeometry.triangles.data(), sizeof(IndexedTriangle) * indexedGeometry.triangles.size());
+		else if (split)
+			writeSceneCacheSection(out, offset, splitGeometry.triangles.data(), sizeof(IntersectionTriangle) * splitGeometry.triangles.size());
+		else
+			writeSceneCacheSection(out, offset, rtxTriangles.data(), sizeof(RTXTriangle) * rtxTriangles.size());
+		header.positionsOffset = alignSceneCacheOffset(offset);
+		writeSceneCacheSection(out, offset, indexedGeometry.positions.data(), sizeof(glm::vec4) * header.numVertices);
+		header.texCoordsOffset = alignSceneCacheOffset(offset);
+		writeSceneCacheSection(out, offset, indexedGeometry.texCoords.data(), sizeof(glm::vec2) * header.numVertices);
+		header.attributesOffset = alignSceneCacheOffset(offset);
+		writeSceneCacheSection(out, offset, splitGeometry.attributes.data(), sizeof(TriangleAttributes) * (split ? header.numTriangles : 0));
+		header.nodesOffset = alignSceneCacheOffset(offset);
+		writeSceneCacheSection(out, offset, nodes.data(), sizeof(Node) * nodes.size());
+		header.materialsOffset = alignSceneCacheOffset(offset);
+		writeSceneCacheSection(out, offset, materials.data(), sizeof(Material) * materials.size());
+
+		header.texturesOffset = alignSceneCacheOffset(offset);
+		std::string textureRefs;
+		for (uint32_t index = 0; index < textures.paths.size(); index++)
+		{
+			std::string relativePath = std::filesystem::path(textures.paths[index]).lexically_relative(cachePath.parent_path()).generic_string();
+			uint32_t length = static_cast<uint32_t>(relativePath.size());
+			textureRefs.append(reinterpret_cast<const char*>(&index), sizeof(index));
+			textureRefs.append(reinterpret_cast<const char*>(&length), sizeof(length));
+			textureRefs.append(relativePath);
+		}
+		writeSceneCacheSection(out, offset, textureRefs.data(), textureRefs.size());
+
+		out.seekp(0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!out.good())
+		{
+			std::cerr << "Failed to write scene cache: " << cachePath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, cachePath, error);
+	if (error)
+	{
+		std::cerr << "Failed to write scene cache: " << cachePath << " (" << error.message() << ")" << std::endl;
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Read-only view of a .rtscene file mapped into memory.
+ *
+ * `triangles`, `positions`, `texCoords` and `nodes` point straight into the mapping and can be handed to
+ * `SSBO` without a copy, they stay valid until `close` is called or the cache is destroyed. `triangles` holds
+ * RTXTriangles, IndexedTriangles or IntersectionTriangles depending on the layout the cache was opened with,
+ * `triangleSize` bytes each. `attributes` is only set for GEOMETRY_SPLIT, one per triangle.
+ */
+class SceneCache
+{
+public:
+	const void* triangles = nullptr;
+	size_t numTriangles = 0;
+	size_t triangleSize = 0;
+	const glm::vec4* positions = nullptr;
+	const glm::vec2* texCoords = nullptr;
+	size_t numVertices = 0;
+	const TriangleAttributes* attributes = nullptr;
+	size_t numAttributes = 0;
+	const Node* nodes = nullptr;
+	size_t numNodes = 0;
+	const Material* materials = nullptr;
+	size_t numMaterials = 0;
+	std::vector<SceneCacheTexture> textures;
+
+	/**
+	 * @brief Maps the cache file and validates it against the expected content hash, geometry layout and BVH settings.
+	 *
+	 * @return false when the file is missing, from another version, layout or BVH build, stale or corrupt
+	 */
+	bool open(const std::filesystem::path& cachePath, uint64_t contentHash, GeometryLayout geometryLayout,
+		BVHBuilder bvhBuilder, int bvhOptimizeIterations, BVHLayout bvhLayout)
+	{
+		close();
+		if (!std::filesystem::exists(cachePath))
+			return false;
+
+		try {
+			file = std::make_unique<MappedFile>(cachePath.string());
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+
+		if (file->size < sizeof(SceneCacheHeader))
+			return reject("truncated");
+
+		SceneCacheHeader header;
+		std::memcpy(&header, file->data, sizeof(header));
+		if (header.magic != SCENE_CACHE_MAGIC || header.version != SCENE_CACHE_VERSION)
+			return reject("unknown version");
+		if (header.geometryLayout != static_cast<uint32_t>(geometryLayout))
+			return reject("geometry layout changed");
+		if (header.bvhBuilder != static_cast<uint32_t>(bvhBuilder)
+			|| header.bvhOptimizeIterations != static_cast<uint32_t>(bvhOptimizeIterations)
+			|| header.bvhLayout != static_cast<uint32_t>(bvhLayout))
+			return reject("BVH settings changed");
+		size_t expectedTriangleSize = geometryTriangleSize(geometryLayout);
+		uint64_t expectedAttributes = geometryLayout == GEOMETRY_SPLIT ? header.numTriangles : 0;
+		if (header.triangleSize != expectedTriangleSize || header.nodeSize != sizeof(Node) || header.materialSize != sizeof(Material))
+			return reject("struct layout changed");
+		if (header.contentHash != contentHash)
+			return reject("model folder changed");
+		if (!sectionFits(header.trianglesOffset, header.numTriangles, expectedTriangleSize)
+			|| !sectionFits(header.positionsOffset, header.numVertices, sizeof(glm::vec4))
+			|| !sectionFits(header.texCoordsOffset, header.numVertices, sizeof(glm::vec2))
+			|| !sectionFits(header.attributesOffset, expectedAttributes, sizeof(TriangleAttributes))
+			|| !sectionFits(header.nodesOffset, header.numNodes, sizeof(Node))
+			|| !sectionFits(header.materialsOffset, header.numMaterials, sizeof(Material))
+			|| header.texturesOffset > file->size)
+			return reject("corrupt");
+
+		triangles = file->data + header.trianglesOffset;
+		numTriangles = header.numTriangles;
+		triangleSize = expectedTriangleSize;
+		positions = reinterpret_cast<const glm::vec4*>(file->data + header.positionsOffset);
+		texCoords = reinterpret_cast<const glm::vec2*>(file->data + header.texCoordsOffset);
+		numVertices = header.numVertices;
+		attributes = expectedAttributes > 0 ? reinterpret_cast<const TriangleAttributes*>(file->data + header.attributesOffset) : nullptr;
+		numAttributes = expectedAttributes;
+		nodes = reinterpret_cast<const Node*>(file->data + header.nodesOffset);
+		numNodes = header.numNodes;
+		materials = reinterpret_cast<const Material*>(file->data + header.materialsOffset);
+		numMaterials = header.numMaterials;
+
+		const char* p = file->data + header.texturesOffset;
+		const char* end = file->data + file->size;
+		for (uint64_t i = 0; i < header.numTextures; i++)
+		{
+			uint32_t index;
+			uint32_t length;
+			if (end - p < 8)
+				return reject("corrupt");
+			std::memcpy(&index, p, 4);
+			std::memcpy(&length, p + 4, 4);
+			p += 8;
+			if (static_cast<uint64_t>(end - p) < length)
+				return reject("corrupt");
+			if (index != i)
+				return reject("corrupt");
+			textures.push_back({ static_cast<int>(index), std::string(p, length) });
+			p += length;
+		}
+
+		return true;
+	}
+
+	// Decodes the referenced textures in parallel and uploads them under their original texture indices
+	void loadTextures(const std::filesystem::path& folderPath, SceneTextures& outTextures) const
+	{
+		std::vector<std::future<DecodedTexture>> pendingTextures;
+		for (const SceneCacheTexture& texture : textures)
+			pendingTextures.push_back(decodeTextureAsync((folderPath / texture.relativePath).string()));
+		outTextures = uploadSceneTextures(pendingTextures);
+	}
+
+	void close()
+	{
+		file.reset();
+		triangles = nullptr;
+		positions = nullptr;
+		texCoords = nullptr;
+		attributes = nullptr;
+		nodes = nullptr;
+		materials = nullptr;
+		numTriangles = triangleSize = numVertices = numAttributes = numNodes = numMaterials = 0;
+		textures.clear();
+	}
+
+private:
+	std::unique_ptr<MappedFile> file;
+
+	bool sectionFits(uint64_t offset, uint64_t count, uint64_t elementSize) const
+	{
+		return offset % SCENE_CACHE_ALIGNMENT == 0 && offset <= file->size
+			&& count <= (file->size - offset) / elementSize;
+	}
+
+	bool reject(const char* reason)
+	{
+		std::cout << "Scene cache ignored: " << reason << std::endl;
+		close();
+		return false;
+	}
+};
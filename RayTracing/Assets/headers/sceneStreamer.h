@@ -0,0 +1,364 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <exception>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+#include <Assets/headers/indexedGeometry.h>
+#include <Assets/headers/instancing.h>
+
+// Depth of the BVH built over partially loaded geometry, shallow enough to rebuild on every batch
+const int STREAM_PREVIEW_BVH_DEPTH = 12;
+
+// Triangles parsed before the first preview is published, later previews follow each doubling
+const size_t STREAM_FIRST_BATCH_SIZE = 64 * 1024;
+
+/**
+ * @brief BVH ordered triangles in one of the geometry layouts, plus the nodes, ready to be uploaded.
+ */
+struct SceneGeometry
+{
+	GeometryLayout layout = GEOMETRY_TRIANGLES;
+	std::vector<RTXTriangle> rtxTriangles;	// GEOMETRY_TRIANGLES
+	IndexedGeometry indexedGeometry;		// GEOMETRY_INDEXED
+	SplitGeometry splitGeometry;			// GEOMETRY_SPLIT
+	std::vector<Node> nodes;				// Single BVH, or the BLAS of every mesh when instanced
+	std::vector<Node> tlasNodes;			// Instanced scenes only
+	std::vector<GPUInstance> instances;		// Instanced scenes only, TLAS leaf order
+	bool isFinal = false;					// False for the coarse previews of a streaming load
+
+	const void* triangleData() const
+	{
+		if (layout == GEOMETRY_INDEXED)
+			return indexedGeometry.triangles.data();
+		if (layout == GEOMETRY_SPLIT)
+			return splitGeometry.triangles.data();
+		return rtxTriangles.data();
+	}
+
+	size_t numTriangles() const
+	{
+		if (layout == GEOMETRY_INDEXED)
+			return indexedGeometry.triangles.size();
+		if (layout == GEOMETRY_SPLIT)
+			return splitGeometry.triangles.size();
+		return rtxTriangles.size();
+	}
+
+	size_t triangleSize() const
+	{
+		return geometryTriangleSize(layout);
+	}
+
+	bool isInstanced() const
+	{
+		return !instances.empty();
+	}
+};
+
+// Puts BVH ordered triangles in `geometry` in `geometryLayout`, consuming `rtxTriangles`
+void storeSceneTriangles(GeometryLayout geometryLayout, std::vector<RTXTriangle>& rtxTriangles, SceneGeometry& geometry)
+{
+	geometry.layout = geometryLayout;
+	if (geometryLayout == GEOMETRY_INDEXED)
+	{
+		geometry.indexedGeometry = buildIndexedGeometry(rtxTriangles);
+		std::vector<RTXTriangle>().swap(rtxTriangles);
+	}
+	else if (geometryLayout == GEOMETRY_SPLIT)
+	{
+		geometry.splitGeometry = buildSplitGeometry(rtxTriangles);
+		std::vector<RTXTriangle>().swap(rtxTriangles);
+	}
+	else
+	{
+		geometry.rtxTriangles = std::move(rtxTriangles);
+	}
+}
+
+/**
+ * @brief Builds the BVH over loaded triangles and stores them in `geometryLayout`.
+ *
+ * `rtxTriangles` and `bvhTriangles` are consumed, they are reordered or moved into `geometry`.
+ * `onBVHStats`, `bvhOptimizeIterations`, `bvhLayout` and `logProgress` are handed to the BVH build.
+ */
+void buildSceneGeometry(GeometryLayout geometryLayout, std::vector<RTXTriangle>& rtxTriangles,
+	std::vector<BVHTriangle>& bvhTriangles, SceneGeometry& geometry, int maxDepth = MAX_DEPTH,
+	BVHBuilder builder = BVH_BUILDER_BINNED_SAH, const BVHStatsCallback& onBVHStats = nullptr, int bvhOptimizeIterations = 0,
+	BVHLayout bvhLayout = BVH_LAYOUT_BUILD_ORDER, bool logProgress = true)
+{
+	geometry.layout = geometryLayout;
+	if (geometryLayout == GEOMETRY_INDEXED && builder == BVH_BUILDER_SBVH)
+	{
+		// The SBVH clips and duplicates whole triangles, index them once they are in leaf order
+		BVH BVH(bvhTriangles, rtxTriangles, maxDepth, builder, onBVHStats, bvhOptimizeIterations, bvhLayout, logProgress);
+		geometry.nodes = std::move(BVH.allNodes);
+		storeSceneTriangles(geometryLayout, rtxTriangles, geometry);
+	}
+	else if (geometryLayout == GEOMETRY_INDEXED)
+	{
+		geometry.indexedGeometry = buildIndexedGeometry(rtxTriangles);
+		std::vector<RTXTriangle>().swap(rtxTriangles);
+
+		BVH BVH(bvhTriangles, geometry.indexedGeometry.triangles, maxDepth, builder, onBVHStats, bvhOptimizeIterations, bvhLayout,
+			logProgress);
+		geometry.nodes = std::move(BVH.allNodes);
+	}
+	else
+	{
+		BVH BVH(bvhTriangles, rtxTriangles, maxDepth, builder, onBVHStats, bvhOptimizeIterations, bvhLayout, logProgress);
+		geometry.nodes = std::move(BVH.allNodes);
+		storeSceneTriangles(geometryLayout, rtxTriangles, geometry);
+	}
+}
+
+/**
+ * @brief Two level version of `buildSceneGeometry`: a BLAS per mesh in `meshes` and a TLAS over `instances`.
+ *
+ * The BLASes go into `geometry.nodes` one after the other, with their child and triangle indices moved to
+ * where their nodes and triangles end up, and each mesh's triangles are stored once. The meshes are consumed.
+ * `bvhOptimizeIterations` and `bvhLayout` apply to the BLASes, the TLAS is rarely large enough to gain from them.
+ */
+void buildInstancedSceneGeometry(GeometryLayout geometryLayout, std::vector<InstancedMesh>& meshes,
+	const std::vector<MeshInstance>& instances, SceneGeometry& geometry, BVHBuilder builder = BVH_BUILDER_BINNED_SAH,
+	int bvhOptimizeIterations = 0, BVHLayout bvhLayout = BVH_LAYOUT_BUILD_ORDER)
+{
+	std::vector<RTXTriangle> rtxTriangles;
+	std::vector<int> meshRoots;
+	std::vector<BoundingBox> meshBounds;
+	geometry.nodes.clear();
+	for (InstancedMesh& mesh : meshes)
+	{
+		BVH blas(mesh.bvhTriangles, mesh.rtxTriangles, MAX_DEPTH, builder, nullptr, bvhOptimizeIterations, bvhLayout);
+		int nodeOffset = static_cast<int>(geometry.nodes.size());
+		int triangleOffset = static_cast<int>(rtxTriangles.size());
+		for (Node node : blas.allNodes)
+		{
+			node.triangleIndex += triangleOffset;
+			if (node.childIndex != -1)
+				node.childIndex += nodeOffset;
+			geometry.nodes.push_back(node);
+		}
+		meshRoots.push_back(nodeOffset);
+		meshBounds.push_back(blas.allNodes[0].bounds);
+
+		rtxTriangles.insert(rtxTriangles.end(), mesh.rtxTriangles.begin(), mesh.rtxTriangles.end());
+		std::vector<RTXTriangle>().swap(mesh.rtxTriangles);
+		std::vector<BVHTriangle>().swap(mesh.bvhTriangles);
+	}
+
+	std::vector<BoundingBox> instanceBounds;
+	geometry.instances.clear();
+	for (const MeshInstance& instance : instances)
+	{
+		GPUInstance gpuInstance = {};
+		gpuInstance.worldToObject = glm::inverse(instance.objectToWorld);
+		gpuInstance.handedness = glm::determinant(glm::mat3(instance.objectToWorld)) < 0.0f ? -1.0f : 1.0f;
+		gpuInstance.blasRoot = meshRoots[instance.mesh];
+		geometry.instances.push_back(gpuInstance);
+		instanceBounds.push_back(transformBounds(meshBounds[instance.mesh], instance.objectToWorld));
+	}
+	geometry.tlasNodes = buildTLAS(geometry.instances, instanceBounds);
+
+	storeSceneTriangles(geometryLayout, rtxTriangles, geometry);
+}
+
+void printSceneGeometry(const SceneGeometry& geometry)
+{
+	size_t triangleBytes = geometry.triangleSize() * geometry.numTriangles();
+	if (geometry.layout == GEOMETRY_INDEXED)
+		triangleBytes = geometry.indexedGeometry.sizeInBytes();
+	else if (geometry.layout == GEOMETRY_SPLIT)
+		triangleBytes = geometry.splitGeometry.sizeInBytes();
+
+	std::cout << "Scene geometry: " << geometry.numTriangles() << " triangles";
+	if (geometry.layout == GEOMETRY_INDEXED)
+		std::cout << ", " << geometry.indexedGeometry.positions.size() << " shared vertices";
+	std::cout << ", " << triangleBytes / 1024 << " KB, " << geometry.nodes.size() << " BVH nodes";
+	if (geometry.isInstanced())
+		std::cout << ", " << geometry.instances.size() << " instances under " << geometry.tlasNodes.size() << " TLAS nodes";
+	std::cout << std::endl;
+}
+
+/**
+ * @brief Loads a model folder on a background thread and publishes the geometry as it arrives.
+ *
+ * The loader thread parses the MTL libraries first and hands the materials (plus the texture decodes it
+ * queued) to `waitForMaterials`. It then parses the OBJ with `parseObjParallel` in waves of chunks and, each
+ * time the triangle count has doubled, publishes a preview: everything parsed so far under a coarse, quietly
+ * built `STREAM_PREVIEW_BVH_DEPTH` LBVH. The full BVH is published last with `SceneGeometry::isFinal` set.
+ * The render thread polls `takeGeometry` between frames and only ever sees the newest version. `onBVHStats`
+ * is only called for the final BVH, from the loader thread, and only the final BVH gets `builder`,
+ * `bvhOptimizeIterations` and `bvhLayout`.
+ *
+ * Nothing here touches GL, uploads stay on the context thread.
+ */
+class SceneStreamer
+{
+public:
+	// Appends the extra scene materials after the model's own
+	using AddMaterials = std::function<void(std::vector<Material>&)>;
+	// Adds the extra scene geometry once the model is parsed, before the final BVH build
+	using AddGeometry = std::function<void(std::vector<RTXTriangle>&, std::vector<BVHTriangle>&, int numMaterials)>;
+
+	SceneStreamer() = default;
+
+	~SceneStreamer()
+	{
+		cancelled = true;
+		if (worker.joinable())
+			worker.join();
+	}
+
+	SceneStreamer(const SceneStreamer&) = delete;
+	SceneStreamer& operator=(const SceneStreamer&) = delete;
+
+	void start(const std::string& folderPath, GeometryLayout geometryLayout, BVHBuilder builder, int bvhOptimizeIterations,
+		BVHLayout bvhLayout, BVHStatsCallback onBVHStats, AddMaterials addMaterials, AddGeometry addGeometry)
+	{
+		materialsFuture = materialsPromise.get_future();
+		worker = std::thread([this, folderPath, geometryLayout, builder, bvhOptimizeIterations, bvhLayout, onBVHStats, addMaterials, addGeometry]()
+		{
+			run(folderPath, geometryLayout, builder, bvhOptimizeIterations, bvhLayout, onBVHStats, addMaterials, addGeometry);
+		});
+	}
+
+	/**
+	 * @brief Blocks until the MTL libraries are parsed, only a fraction of the load time.
+	 *
+	 * @param pendingTextures Output, the decodes of every referenced texture, layer order
+	 * @throws whatever the loader threw before the materials were ready (missing OBJ, texture, ...)
+	 */
+	std::vector<Material> waitForMaterials(std::vector<std::future<DecodedTexture>>& pendingTextures)
+	{
+		StreamedMaterials streamed = materialsFuture.get();
+		pendingTextures = std::move(streamed.pendingTextures);
+		return std::move(streamed.materials);
+	}
+
+	/**
+	 * @brief Moves the newest geometry published since the last call into `geometry`.
+	 *
+	 * @return false if nothing new was published
+	 * @throws whatever the loader threw while parsing or building
+	 */
+	bool takeGeometry(SceneGeometry& geometry)
+	{
+		std::lock_guard<std::mutex> lock(publishMutex);
+		if (error)
+		{
+			std::exception_ptr loadError = error;
+			error = nullptr;
+			std::rethrow_exception(loadError);
+		}
+		if (!published)
+			return false;
+
+		geometry = std::move(*published);
+		published.reset();
+		return true;
+	}
+
+private:
+	struct StreamedMaterials
+	{
+		std::vector<Material> materials;
+		std::vector<std::future<DecodedTexture>> pendingTextures;
+	};
+
+	std::thread worker;
+	std::atomic<bool> cancelled = false;
+
+	std::promise<StreamedMaterials> materialsPromise;
+	std::future<StreamedMaterials> materialsFuture;
+
+	std::mutex publishMutex;
+	std::unique_ptr<SceneGeometry> published;
+	std::exception_ptr error;
+
+	void publish(std::unique_ptr<SceneGeometry> geometry)
+	{
+		std::lock_guard<std::mutex> lock(publishMutex);
+		published = std::move(geometry);
+	}
+
+	void run(const std::string& folderPath, GeometryLayout geometryLayout, BVHBuilder builder, int bvhOptimizeIterations,
+		BVHLayout bvhLayout, const BVHStatsCallback& onBVHStats, const AddMaterials& addMaterials, const AddGeometry& addGeometry)
+	{
+		bool materialsSent = false;
+		try {
+			std::filesystem::path objFilePath = findFirstObjFile(folderPath);
+			if (objFilePath.empty()) {
+				std::cerr << "No .obj file found in selected folder: " << folderPath << std::endl;
+				throw std::runtime_error("OBJ file not found");
+			}
+
+			TextureReferences textureRefs;
+			std::map<std::string, std::map<std::string, Material>> libToMtlMaps;
+			loadMtlLibraries(objFilePath.parent_path(), textureRefs, libToMtlMaps);
+
+			StreamedMaterials streamed;
+			for (const auto& libNameToMtlDict : libToMtlMaps)
+				for (const auto& mtlNameToMtl : libNameToMtlDict.second)
+					streamed.materials.push_back(mtlNameToMtl.second);
+			addMaterials(streamed.materials);
+			int numMaterials = static_cast<int>(streamed.materials.size());
+
+			for (const std::filesystem::path& texturePath : textureRefs.paths)
+				streamed.pendingTextures.push_back(decodeTextureAsync(texturePath.string()));
+
+			materialsPromise.set_value(std::move(streamed));
+			materialsSent = true;
+
+			std::vector<RTXTriangle> rtxTriangles;
+			std::vector<BVHTriangle> bvhTriangles;
+			auto parseStart = std::chrono::high_resolution_clock::now();
+
+			parseObjParallel(objFilePath, libToMtlMaps, rtxTriangles, bvhTriangles,
+				[&](const std::vector<RTXTriangle>& rtxSoFar, const std::vector<BVHTriangle>& bvhSoFar)
+				{
+					if (cancelled)
+						throw std::runtime_error("Scene load cancelled");
+
+					// The parser keeps appending to its vectors, the preview is built over copies
+					std::vector<RTXTriangle> rtxPreview = rtxSoFar;
+					std::vector<BVHTriangle> bvhPreview = bvhSoFar;
+					auto preview = std::make_unique<SceneGeometry>();
+					// Previews are rebuilt on every doubling and only shown for a moment, the LBVH builds them fastest
+					buildSceneGeometry(geometryLayout, rtxPreview, bvhPreview, *preview, STREAM_PREVIEW_BVH_DEPTH, BVH_BUILDER_LBVH,
+						nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+					publish(std::move(preview));
+				}, STREAM_FIRST_BATCH_SIZE);
+
+			std::chrono::duration<double, std::milli> parseTime = std::chrono::high_resolution_clock::now() - parseStart;
+			std::cout << bvhTriangles.size() << " triangles loaded, OBJ parsed in " << parseTime.count() << " ms" << std::endl;
+
+			addGeometry(rtxTriangles, bvhTriangles, numMaterials);
+
+			auto geometry = std::make_unique<SceneGeometry>();
+			buildSceneGeometry(geometryLayout, rtxTriangles, bvhTriangles, *geometry, MAX_DEPTH, builder, onBVHStats, bvhOptimizeIterations,
+				bvhLayout);
+			geometry->isFinal = true;
+			publish(std::move(geometry));
+		}
+		catch (...) {
+			if (cancelled)
+				return;
+			if (!materialsSent)
+			{
+				materialsPromise.set_exception(std::current_exception());
+				return;
+			}
+			std::lock_guard<std::mutex> lock(publishMutex);
+			error = std::current_exception();
+		}
+	}
+};
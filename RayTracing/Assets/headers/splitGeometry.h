@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <Assets/headers/mesh.h>
+
+/*
+ * Hot/cold split of the 80 byte RTXTriangle:
+ *   triangles[]    IntersectionTriangle, a vertex and the two edges from it, 48 bytes   -> TrianglesBlock
+ *   attributes[]   TriangleAttributes, UVs and material, 32 bytes, indexed alike         -> TriangleAttributesBlock
+ *
+ * Every leaf test reads the intersection stream only, and gets the edges it needs ready made instead of
+ * two more vertices to subtract. The attributes are read once per ray, for the closest hit. The same 80
+ * bytes per triangle overall, but only 48 of them are on the traversal path.
+ */
+
+struct IntersectionTriangle
+{
+	glm::vec4 a;		// w unused
+	glm::vec4 edgeAB;	// b - a, exactly what the intersection test computed from the vertices
+	glm::vec4 edgeAC;	// c - a, 48 bytes
+};
+
+struct TriangleAttributes
+{
+	glm::vec2 aTex;		// Rotated like in RTXTriangle, aTex belongs to b, bTex to c, cTex to a
+	glm::vec2 bTex;
+	glm::vec2 cTex;
+	int materialIndex;
+	int pad; // 32 bytes
+};
+
+struct SplitGeometry
+{
+	std::vector<IntersectionTriangle> triangles;
+	std::vector<TriangleAttributes> attributes;
+
+	size_t sizeInBytes() const
+	{
+		return triangles.size() * sizeof(IntersectionTriangle) + attributes.size() * sizeof(TriangleAttributes);
+	}
+};
+
+/**
+ * @brief Converts triangles to the split layout.
+ *
+ * Triangle order is kept, so BVH ordered RTXTriangles give BVH ordered streams.
+ */
+SplitGeometry buildSplitGeometry(const std::vector<RTXTriangle>& rtxTriangles)
+{
+	SplitGeometry geometry;
+	geometry.triangles.reserve(rtxTriangles.size());
+	geometry.attributes.reserve(rtxTriangles.size());
+	for (const RTXTriangle& tri : rtxTriangles)
+	{
+		glm::vec3 a(tri.a);
+		IntersectionTriangle intersection;
+		intersection.a = glm::vec4(a, 0.0f);
+		intersection.edgeAB = glm::vec4(glm::vec3(tri.b) - a, 0.0f);
+		intersection.edgeAC = glm::vec4(glm::vec3(tri.c) - a, 0.0f);
+		geometry.triangles.push_back(intersection);
+
+		TriangleAttributes attributes;
+		attributes.aTex = tri.aTex;
+		attributes.bTex = tri.bTex;
+		attributes.cTex = tri.cTex;
+		attributes.materialIndex = tri.materialIndex;
+		attributes.pad = 0;
+		geometry.attributes.push_back(attributes);
+	}
+	return geometry;
+}
+
+// True if `geometry` gives the intersection test the same values as `rtxTriangles` and keeps their attributes
+bool sameGeometry(const std::vector<RTXTriangle>& rtxTriangles, const SplitGeometry& geometry)
+{
+	if (rtxTriangles.size() != geometry.triangles.size() || rtxTriangles.size() != geometry.attributes.size())
+		return false;
+
+	for (size_t i = 0; i < rtxTriangles.size(); i++)
+	{
+		const RTXTriangle& tri = rtxTriangles[i];
+		const IntersectionTriangle& intersection = geometry.triangles[i];
+		const TriangleAttributes& attributes = geometry.attributes[i];
+		glm::vec3 a(tri.a);
+		if (glm::vec3(intersection.a) != a
+			|| glm::vec3(intersection.edgeAB) != glm::vec3(tri.b) - a
+			|| glm::vec3(intersection.edgeAC) != glm::vec3(tri.c) - a
+			|| attributes.aTex != tri.aTex
+			|| attributes.bTex != tri.bTex
+			|| attributes.cTex != tri.cTex
+			|| attributes.materialIndex != tri.materialIndex)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+/**
+ * @brief Fixed size pool of worker threads consuming a shared FIFO task queue.
+ *
+ * Threads blocked in `wait` or `parallelFor` keep executing queued tasks while they wait, so tasks
+ * may themselves submit and wait on more work without starving the pool.
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int numThreads = std::max(1u, std::thread::hardware_concurrency()))
+	{
+		for (unsigned int i = 0; i < numThreads; i++)
+			workers.emplace_back([this]() { workerLoop(); });
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		queueCondition.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	unsigned int size() const
+	{
+		return static_cast<unsigned int>(workers.size());
+	}
+
+	template<typename F>
+	auto submit(F&& task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			tasks.emplace_back([packaged]() { (*packaged)(); });
+		}
+		queueCondition.notify_one();
+		return future;
+	}
+
+	// Blocks until the future is ready, running queued tasks in the meantime
+	template<typename T>
+	T wait(std::future<T>& future)
+	{
+		while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			if (!runPendingTask())
+				std::this_thread::yield();
+		}
+		return future.get();
+	}
+
+	/**
+	 * @brief Calls `fn(i)` for every i in [0, count) across the pool and the calling thread.
+	 *
+	 * Returns once every call has finished. The first exception thrown by `fn` is rethrown here.
+	 */
+	template<typename F>
+	void parallelFor(int count, F&& fn)
+	{
+		if (count <= 0)
+			return;
+
+		std::atomic<int> nextIndex(0);
+		std::exception_ptr error;
+		std::mutex errorMutex;
+
+		auto runRange = [&]()
+		{
+			for (int i = nextIndex++; i < count; i = nextIndex++)
+			{
+				try {
+					fn(i);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(errorMutex);
+					if (!error)
+						error = std::current_exception();
+				}
+			}
+		};
+
+		int numHelpers = std::min(count, static_cast<int>(size())) - 1;
+		std::vector<std::future<void>> helpers;
+		for (int i = 0; i < numHelpers; i++)
+			helpers.push_back(submit(runRange));
+
+		runRange();
+		for (std::future<void>& helper : helpers)
+			wait(helper);
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+
+	bool runPendingTask()
+	{
+		std::function<void()> task;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (tasks.empty())
+				return false;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+		task();
+		return true;
+	}
+
+	void workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty())
+					return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+// Process wide pool shared by the loaders and the BVH builders
+ThreadPool& getThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
@@ -0,0 +1,591 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WIDE_BVH_SSE
+#include <immintrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include <Assets/headers/mesh.h>
+#include <Assets/headers/BVH.h>
+#include <Assets/headers/instancing.h>
+#include <Assets/headers/bvhTraversal.h>
+#include <Assets/headers/threadPool.h>
+
+/*
+ * 4 wide BVH, the binary tree with three of every four levels folded into their parents.
+ *
+ * A wide node holds the boxes of its up to four children as one float[4] per bound and axis, so a single
+ * SSE (or vec4) slab test intersects all of them, and one fetch replaces the two node fetches of a binary
+ * step. Leaves stay where they were, a leaf child points at the same triangle range as the binary leaf.
+ *
+ * `QuantizedWideNode` is the same node in 64 bytes: the child boxes are stored as bytes on a grid over the
+ * node's own box, rounded outwards, so they only ever grow and no hit is lost.
+ */
+
+// Children per wide node, the width of the SSE and vec4 slab tests
+const int WIDE_BVH_WIDTH = 4;
+
+// Traversal stack of a wide tree collapsed from a binary one of at most MAX_DEPTH levels: every level can
+// leave three children behind on the stack. Also WIDE_STACK_SIZE in compute.glsl
+const int WIDE_BVH_STACK_SIZE = 3 * MAX_DEPTH + 1;
+
+// Layout of WideNode in compute.glsl, 128 bytes
+struct alignas(16) WideNode
+{
+	float minX[WIDE_BVH_WIDTH];
+	float minY[WIDE_BVH_WIDTH];
+	float minZ[WIDE_BVH_WIDTH];
+	float maxX[WIDE_BVH_WIDTH];
+	float maxY[WIDE_BVH_WIDTH];
+	float maxZ[WIDE_BVH_WIDTH];
+	int child[WIDE_BVH_WIDTH];	// Wide node of an internal child, first triangle of a leaf
+	int count[WIDE_BVH_WIDTH];	// Triangles of a leaf, 0 for an internal child, -1 for an unused slot
+};
+
+// Largest leaf a quantized node stores in its 16 bit count, `quantizeWideBVH` splits larger ones
+const int QUANTIZED_BVH_MAX_LEAF = 0xFFFE;
+
+// Quantized count of an unused slot
+const uint16_t QUANTIZED_BVH_UNUSED = 0xFFFF;
+
+/**
+ * @brief WideNode with byte child bounds, the layout of QuantizedWideNode in compute.glsl, 64 bytes.
+ *
+ * Child i's box is origin + q[i] * 2^exponent per axis, q from 0 to 255. Power of two scales make the
+ * product exact, so CPU and GPU decode the same floats.
+ */
+struct QuantizedWideNode
+{
+	glm::vec3 origin;					// Min corner of the node's box
+	int8_t exponents[4];				// Grid step per axis as a power of two, the fourth is unused
+	uint32_t child[WIDE_BVH_WIDTH];		// As in WideNode
+	uint8_t qMinX[WIDE_BVH_WIDTH];
+	uint8_t qMinY[WIDE_BVH_WIDTH];
+	uint8_t qMinZ[WIDE_BVH_WIDTH];
+	uint8_t qMaxX[WIDE_BVH_WIDTH];
+	uint8_t qMaxY[WIDE_BVH_WIDTH];
+	uint8_t qMaxZ[WIDE_BVH_WIDTH];
+	uint16_t count[WIDE_BVH_WIDTH];		// Triangles of a leaf, 0 for an internal child, QUANTIZED_BVH_UNUSED
+};
+static_assert(sizeof(QuantizedWideNode) == 64, "QuantizedWideNode has to match compute.glsl");
+
+/**
+ * @brief Collapses the binary tree below `nodes[root]` into 4 wide nodes appended to `wideNodes`.
+ *
+ * A wide node starts with the two children of its binary node and opens the internal child with the largest
+ * area until it has four, the child rays are most likely to enter. Unused slots get a point box far outside
+ * the scene, which every slab test misses, so traversal needs no special case for them.
+ * @return index of the wide root in `wideNodes`
+ */
+int collapseWideBVH(const Node* nodes, int root, std::vector<WideNode>& wideNodes)
+{
+	// `from` is the binary node whose subtree the wide node at `to` covers
+	struct PendingNode
+	{
+		int from;
+		int to;
+	};
+
+	int wideRoot = static_cast<int>(wideNodes.size());
+	wideNodes.emplace_back();
+	std::vector<PendingNode> stack = { { root, wideRoot } };
+	while (!stack.empty())
+	{
+		PendingNode pending = stack.back();
+		stack.pop_back();
+
+		int slots[WIDE_BVH_WIDTH];
+		int numSlots = 0;
+		const Node& from = nodes[pending.from];
+		if (from.childIndex == -1)
+		{
+			slots[numSlots++] = pending.from;
+		}
+		else
+		{
+			slots[numSlots++] = from.childIndex;
+			slots[numSlots++] = from.childIndex + 1;
+		}
+		while (numSlots < WIDE_BVH_WIDTH)
+		{
+			int largest = -1;
+			float largestArea = -1.0f;
+			for (int i = 0; i < numSlots; i++)
+			{
+				const Node& node = nodes[slots[i]];
+				if (node.childIndex != -1 && node.bounds.halfArea() > largestArea)
+				{
+					largest = i;
+					largestArea = node.bounds.halfArea();
+				}
+			}
+			if (largest == -1)
+				break;
+
+			int opened = slots[largest];
+			slots[largest] = nodes[opened].childIndex;
+			slots[numSlots++] = nodes[opened].childIndex + 1;
+		}
+
+		WideNode wide;
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+		{
+			BoundingBox bounds;
+			bounds.min = bounds.max = glm::vec3(1e30f);
+			wide.child[i] = -1;
+			wide.count[i] = -1;
+			if (i < numSlots)
+			{
+				const Node& node = nodes[slots[i]];
+				if (node.childIndex != -1)
+				{
+					bounds = node.bounds;
+					wide.child[i] = static_cast<int>(wideNodes.size());
+					wide.count[i] = 0;
+					wideNodes.emplace_back();
+					stack.push_back({ slots[i], wide.child[i] });
+				}
+				else if (node.triangleCount > 0)
+				{
+					bounds = node.bounds;
+					wide.child[i] = node.triangleIndex;
+					wide.count[i] = node.triangleCount;
+				}
+			}
+			wide.minX[i] = bounds.min.x;
+			wide.minY[i] = bounds.min.y;
+			wide.minZ[i] = bounds.min.z;
+			wide.maxX[i] = bounds.max.x;
+			wide.maxY[i] = bounds.max.y;
+			wide.maxZ[i] = bounds.max.z;
+		}
+		wideNodes[pending.to] = wide;
+	}
+	return wideRoot;
+}
+
+/**
+ * @brief Wide version of the scene's `numNodes` binary nodes, what NodesBlock holds with WIDE_BVH.
+ *
+ * A two level scene has a BLAS per mesh in `nodes`, each is collapsed on its own and `instances` are
+ * pointed at the wide root of theirs.
+ */
+std::vector<WideNode> collapseSceneBVH(const Node* nodes, size_t numNodes, std::vector<GPUInstance>& instances)
+{
+	std::vector<WideNode> wideNodes;
+	wideNodes.reserve(numNodes / 4 + 1);
+	if (instances.empty())
+	{
+		collapseWideBVH(nodes, 0, wideNodes);
+		return wideNodes;
+	}
+
+	std::map<int, int> wideRoots;
+	for (GPUInstance& instance : instances)
+	{
+		auto wideRoot = wideRoots.find(instance.blasRoot);
+		if (wideRoot == wideRoots.end())
+			wideRoot = wideRoots.emplace(instance.blasRoot, collapseWideBVH(nodes, instance.blasRoot, wideNodes)).first;
+		instance.blasRoot = wideRoot->second;
+	}
+	return wideNodes;
+}
+
+// 2^exponent from its bits, std::ldexp is far too slow for every node visited. Exponents stay in the normal range
+float exponentScale(int exponent)
+{
+	uint32_t bits = static_cast<uint32_t>(exponent + 127) << 23;
+	float scale;
+	std::memcpy(&scale, &bits, sizeof(float));
+	return scale;
+}
+
+/**
+ * @brief Quantizes `wideNodes` into nodes of half the size, same indices.
+ *
+ * Every node gets a grid over the union of its children's boxes, 255 steps per axis of the smallest power
+ * of two that spans it. Child minimums are rounded down and maximums up, checked against the decoded
+ * floats so the quantized box always contains the original. A box that rounds to a single step is widened
+ * by one, a flat box would be missed by the slab test. Unused slots become a point at the origin, which
+ * the slab test misses as well. Leaves over `QUANTIZED_BVH_MAX_LEAF` triangles are split into internal
+ * children with the leaf's box, appended after the other nodes.
+ */
+std::vector<QuantizedWideNode> quantizeWideBVH(std::vector<WideNode> wideNodes)
+{
+	for (size_t i = 0; i < wideNodes.size(); i++)
+	{
+		for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+		{
+			if (wideNodes[i].count[slot] <= QUANTIZED_BVH_MAX_LEAF)
+				continue;
+
+			// The split node may get leaves too large itself, the loop comes back to it
+			WideNode split = wideNodes[i];
+			int first = wideNodes[i].child[slot];
+			int count = wideNodes[i].count[slot];
+			for (int part = 0; part < WIDE_BVH_WIDTH; part++)
+			{
+				split.minX[part] = wideNodes[i].minX[slot];
+				split.minY[part] = wideNodes[i].minY[slot];
+				split.minZ[part] = wideNodes[i].minZ[slot];
+				split.maxX[part] = wideNodes[i].maxX[slot];
+				split.maxY[part] = wideNodes[i].maxY[slot];
+				split.maxZ[part] = wideNodes[i].maxZ[slot];
+				split.child[part] = first + count * part / WIDE_BVH_WIDTH;
+				split.count[part] = first + count * (part + 1) / WIDE_BVH_WIDTH - split.child[part];
+			}
+			wideNodes[i].child[slot] = static_cast<int>(wideNodes.size());
+			wideNodes[i].count[slot] = 0;
+			wideNodes.push_back(split);
+		}
+	}
+
+	std::vector<QuantizedWideNode> quantized(wideNodes.size());
+	for (size_t i = 0; i < wideNodes.size(); i++)
+	{
+		const WideNode& node = wideNodes[i];
+		QuantizedWideNode& q = quantized[i];
+		const float* mins[3] = { node.minX, node.minY, node.minZ };
+		const float* maxs[3] = { node.maxX, node.maxY, node.maxZ };
+		uint8_t* qMins[3] = { q.qMinX, q.qMinY, q.qMinZ };
+		uint8_t* qMaxs[3] = { q.qMaxX, q.qMaxY, q.qMaxZ };
+
+		BoundingBox frame;
+		for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+		{
+			if (node.count[slot] < 0)
+				continue;
+			frame.growToInclude(glm::vec3(mins[0][slot], mins[1][slot], mins[2][slot]));
+			frame.growToInclude(glm::vec3(maxs[0][slot], maxs[1][slot], maxs[2][slot]));
+		}
+		if (frame.isEmpty())
+			frame.min = frame.max = glm::vec3(0.0f);
+
+		q.origin = frame.min;
+		q.exponents[3] = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = frame.max[axis] - frame.min[axis];
+			int exponent = extent > 0.0f ? static_cast<int>(std::ceil(std::log2(extent / 255.0f))) : -126;
+			exponent = std::max(exponent, -126);
+			while (exponent < 127 && frame.min[axis] + 255.0f * exponentScale(exponent) < frame.max[axis])
+				exponent++;
+			q.exponents[axis] = static_cast<int8_t>(exponent);
+
+			float scale = exponentScale(exponent);
+			auto decode = [&](int value) { return q.origin[axis] + static_cast<float>(value) * scale; };
+			for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+			{
+				if (node.count[slot] < 0)
+				{
+					qMins[axis][slot] = 0;
+					qMaxs[axis][slot] = 0;
+					continue;
+				}
+
+				int lo = std::clamp(static_cast<int>(std::floor((mins[axis][slot] - q.origin[axis]) / scale)), 0, 255);
+				int hi = std::clamp(static_cast<int>(std::ceil((maxs[axis][slot] - q.origin[axis]) / scale)), 0, 255);
+				while (lo > 0 && decode(lo) > mins[axis][slot])
+					lo--;
+				while (hi < 255 && decode(hi) < maxs[axis][slot])
+					hi++;
+				if (lo == hi)
+				{
+					if (hi < 255)
+						hi++;
+					else
+						lo--;
+				}
+				qMins[axis][slot] = static_cast<uint8_t>(lo);
+				qMaxs[axis][slot] = static_cast<uint8_t>(hi);
+			}
+		}
+
+		for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+		{
+			q.child[slot] = static_cast<uint32_t>(node.child[slot]);
+			q.count[slot] = node.count[slot] < 0 ? QUANTIZED_BVH_UNUSED : static_cast<uint16_t>(node.count[slot]);
+		}
+	}
+	return quantized;
+}
+
+// Child boxes of `node` as floats, what `decodeWideNode` in compute.glsl computes
+WideNode decodeWideNode(const QuantizedWideNode& node)
+{
+	WideNode decoded;
+	const uint8_t* qMins[3] = { node.qMinX, node.qMinY, node.qMinZ };
+	const uint8_t* qMaxs[3] = { node.qMaxX, node.qMaxY, node.qMaxZ };
+	float* mins[3] = { decoded.minX, decoded.minY, decoded.minZ };
+	float* maxs[3] = { decoded.maxX, decoded.maxY, decoded.maxZ };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float scale = exponentScale(node.exponents[axis]);
+		for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+		{
+			mins[axis][slot] = node.origin[axis] + static_cast<float>(qMins[axis][slot]) * scale;
+			maxs[axis][slot] = node.origin[axis] + static_cast<float>(qMaxs[axis][slot]) * scale;
+		}
+	}
+	for (int slot = 0; slot < WIDE_BVH_WIDTH; slot++)
+	{
+		decoded.child[slot] = static_cast<int>(node.child[slot]);
+		decoded.count[slot] = node.count[slot] == QUANTIZED_BVH_UNUSED ? -1 : node.count[slot];
+	}
+	return decoded;
+}
+
+#ifdef WIDE_BVH_SSE
+// One axis of the four slab tests. Divides like `rayBoundsDistance`, so the distances are exactly the scalar ones
+void slabTestAxis(__m128& tMin, __m128& tMax, __m128 boxMin, __m128 boxMax, float origin, float direction)
+{
+	if (direction < 1e-6f && direction > -1e-6f)
+		return;
+
+	__m128 o = _mm_set1_ps(origin);
+	__m128 d = _mm_set1_ps(direction);
+	__m128 t0 = _mm_div_ps(_mm_sub_ps(boxMin, o), d);
+	__m128 t1 = _mm_div_ps(_mm_sub_ps(boxMax, o), d);
+	tMin = _mm_max_ps(tMin, _mm_min_ps(t0, t1));
+	tMax = _mm_min_ps(tMax, _mm_max_ps(t0, t1));
+}
+
+void storeSlabDistances(__m128 tMin, __m128 tMax, float distances[WIDE_BVH_WIDTH])
+{
+	__m128 hit = _mm_and_ps(_mm_cmplt_ps(tMin, tMax), _mm_cmpge_ps(tMax, _mm_setzero_ps()));
+	_mm_store_ps(distances, _mm_or_ps(_mm_and_ps(hit, tMin), _mm_andnot_ps(hit, _mm_set1_ps(1e38f))));
+}
+
+// One axis of the four quantized bounds as floats, the same arithmetic as `decodeWideNode`
+__m128 decodeQuantizedAxis(const uint8_t quantized[WIDE_BVH_WIDTH], float origin, float scale)
+{
+	uint32_t packed;
+	std::memcpy(&packed, quantized, sizeof(uint32_t));
+	__m128i zero = _mm_setzero_si128();
+	__m128i values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(packed)), zero), zero);
+	return _mm_add_ps(_mm_set1_ps(origin), _mm_mul_ps(_mm_cvtepi32_ps(values), _mm_set1_ps(scale)));
+}
+#endif
+
+/**
+ * @brief Slab test of a ray against the four child boxes of `node`, `rayBoundsDistance` four at a time.
+ *
+ * Skips the same near zero direction components as the scalar test, so the distances are exactly those
+ * of the binary tree. 1e38 for a miss.
+ */
+void rayWideBoundsDistances(const glm::vec3& origin, const glm::vec3& direction, const WideNode& node, float distances[WIDE_BVH_WIDTH])
+{
+#ifdef WIDE_BVH_SSE
+	__m128 tMin = _mm_set1_ps(-1e32f);
+	__m128 tMax = _mm_set1_ps(1e32f);
+	slabTestAxis(tMin, tMax, _mm_load_ps(node.minX), _mm_load_ps(node.maxX), origin.x, direction.x);
+	slabTestAxis(tMin, tMax, _mm_load_ps(node.minY), _mm_load_ps(node.maxY), origin.y, direction.y);
+	slabTestAxis(tMin, tMax, _mm_load_ps(node.minZ), _mm_load_ps(node.maxZ), origin.z, direction.z);
+	storeSlabDistances(tMin, tMax, distances);
+#else
+	for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+	{
+		BoundingBox bounds;
+		bounds.min = glm::vec3(node.minX[i], node.minY[i], node.minZ[i]);
+		bounds.max = glm::vec3(node.maxX[i], node.maxY[i], node.maxZ[i]);
+		distances[i] = rayBoundsDistance(origin, direction, bounds);
+	}
+#endif
+}
+
+// The quantized test decodes the boxes in registers, the node is never unpacked to memory
+void rayWideBoundsDistances(const glm::vec3& origin, const glm::vec3& direction, const QuantizedWideNode& node, float distances[WIDE_BVH_WIDTH])
+{
+#ifdef WIDE_BVH_SSE
+	__m128 tMin = _mm_set1_ps(-1e32f);
+	__m128 tMax = _mm_set1_ps(1e32f);
+	const uint8_t* qMins[3] = { node.qMinX, node.qMinY, node.qMinZ };
+	const uint8_t* qMaxs[3] = { node.qMaxX, node.qMaxY, node.qMaxZ };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float scale = exponentScale(node.exponents[axis]);
+		slabTestAxis(tMin, tMax, decodeQuantizedAxis(qMins[axis], node.origin[axis], scale),
+			decodeQuantizedAxis(qMaxs[axis], node.origin[axis], scale), origin[axis], direction[axis]);
+	}
+	storeSlabDistances(tMin, tMax, distances);
+#else
+	rayWideBoundsDistances(origin, direction, decodeWideNode(node), distances);
+#endif
+}
+
+// Triangles of a leaf child, 0 for an internal child, -1 for an unused slot
+int wideChildCount(const WideNode& node, int slot)
+{
+	return node.count[slot];
+}
+
+int wideChildCount(const QuantizedWideNode& node, int slot)
+{
+	return node.count[slot] == QUANTIZED_BVH_UNUSED ? -1 : node.count[slot];
+}
+
+/**
+ * @brief CPU copy of the WIDE_BVH `traverseBVH` in compute.glsl, counting the work it does.
+ *
+ * Children are visited nearest first: leaves are intersected on the spot, internal children are pushed
+ * farthest first so the nearest is popped next. Children behind the nearest hit so far are skipped.
+ * `WideNodeType` is WideNode or QuantizedWideNode.
+ * @return distance to the nearest hit, 1e38 if nothing was hit
+ */
+template<typename WideNodeType>
+float traceWideBVH(const glm::vec3& origin, const glm::vec3& direction, const std::vector<WideNodeType>& nodes,
+	const std::vector<RTXTriangle>& triangles, TraversalStats& stats)
+{
+	int stack[WIDE_BVH_STACK_SIZE];
+	int stackIndex = 0;
+	stack[stackIndex++] = 0;
+
+	float nearest = 1e38f;
+	while (stackIndex > 0)
+	{
+		const WideNodeType& node = nodes[stack[--stackIndex]];
+		stats.nodesVisited++;
+
+		alignas(16) float distances[WIDE_BVH_WIDTH];
+		rayWideBoundsDistances(origin, direction, node, distances);
+
+		int order[WIDE_BVH_WIDTH];
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+		{
+			int j = i;
+			for (; j > 0 && distances[order[j - 1]] > distances[i]; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+
+		int internalChildren[WIDE_BVH_WIDTH];
+		int numInternalChildren = 0;
+		for (int i = 0; i < WIDE_BVH_WIDTH; i++)
+		{
+			int slot = order[i];
+			if (distances[slot] >= nearest)
+				break;
+
+			int count = wideChildCount(node, slot);
+			int child = static_cast<int>(node.child[slot]);
+			if (count > 0)
+			{
+				for (int tri = child; tri < child + count; tri++)
+				{
+					stats.triangleTests++;
+					nearest = std::min(nearest, rayTriangleDistance(origin, direction, triangles[tri]));
+				}
+			}
+			else if (count == 0)
+			{
+				internalChildren[numInternalChildren++] = slot;
+			}
+		}
+		for (int i = numInternalChildren - 1; i >= 0; i--)
+			if (distances[internalChildren[i]] < nearest)
+				stack[stackIndex++] = static_cast<int>(node.child[internalChildren[i]]);
+	}
+
+	if (nearest < 1e38f)
+		stats.hits++;
+	return nearest;
+}
+
+// `traceTraversalRays` through a wide tree
+template<typename WideNodeType>
+TraversalStats traceWideTraversalRays(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions,
+	const std::vector<WideNodeType>& nodes, const std::vector<RTXTriangle>& triangles, double& milliseconds)
+{
+	const int raysPerTask = 1024;
+	int numRays = static_cast<int>(origins.size());
+	int numTasks = (numRays + raysPerTask - 1) / raysPerTask;
+	std::vector<TraversalStats> taskStats(numTasks);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	getThreadPool().parallelFor(numTasks, [&](int task)
+	{
+		int last = std::min(numRays, (task + 1) * raysPerTask);
+		for (int i = task * raysPerTask; i < last; i++)
+			traceWideBVH(origins[i], directions[i], nodes, triangles, taskStats[task]);
+	});
+	std::chrono::duration<double, std::milli> traceTime = std::chrono::high_resolution_clock::now() - start;
+	milliseconds = traceTime.count();
+
+	TraversalStats stats;
+	for (const TraversalStats& task : taskStats)
+	{
+		stats.nodesVisited += task.nodesVisited;
+		stats.triangleTests += task.triangleTests;
+		stats.hits += task.hits;
+	}
+	return stats;
+}
+
+/**
+ * @brief Builds every model folder in `dataFolderPath` with the binned SAH builder and prints the traversal
+ * work and speed of the binary tree, of its 4 wide collapse and of the quantized wide tree.
+ *
+ * All trace the same rays over the same triangles, a node visited is one node fetch: a binary node plus
+ * its two children's boxes, or a wide node with all four. The quantized boxes are slightly larger, so it
+ * visits a few more nodes for half the bytes each. Rays per second are the faster of `numRuns` batches.
+ */
+void compareWideBVH(const std::string& dataFolderPath, int numRuns = 3)
+{
+	std::cout << std::left << std::setw(16) << "model" << std::setw(12) << "triangles" << std::setw(14) << "binary KB"
+		<< std::setw(18) << "binary nodes/ray" << std::setw(16) << "binary Mrays/s" << std::setw(12) << "wide KB"
+		<< std::setw(16) << "wide nodes/ray" << std::setw(14) << "wide Mrays/s" << std::setw(14) << "quantized KB"
+		<< std::setw(20) << "quantized nodes/ray" << std::setw(18) << "quantized Mrays/s" << std::endl;
+
+	forEachDataModel(dataFolderPath, [&](const std::string& modelName, std::vector<RTXTriangle>& rtxTriangles, std::vector<BVHTriangle>& bvhTriangles)
+	{
+		TraversalRays rays = makeModelTraversalRays(bvhTriangles);
+
+		std::cout << std::left << std::setw(16) << modelName << std::setw(12) << bvhTriangles.size() << std::flush;
+
+		BVH bvh(bvhTriangles, rtxTriangles, MAX_DEPTH, BVH_BUILDER_BINNED_SAH, nullptr, 0, BVH_LAYOUT_BUILD_ORDER, false);
+		std::vector<WideNode> wideNodes;
+		collapseWideBVH(bvh.allNodes.data(), 0, wideNodes);
+		std::vector<QuantizedWideNode> quantizedNodes = quantizeWideBVH(wideNodes);
+
+		TraversalStats binaryStats;
+		TraversalStats wideStats;
+		TraversalStats quantizedStats;
+		double binaryMilliseconds = fastestTrace(numRuns, [&]()
+		{
+			double milliseconds;
+			binaryStats = traceTraversalRays(rays.origins, rays.directions, bvh.allNodes, rtxTriangles, milliseconds);
+			return milliseconds;
+		});
+		double wideMilliseconds = fastestTrace(numRuns, [&]()
+		{
+			double milliseconds;
+			wideStats = traceWideTraversalRays(rays.origins, rays.directions, wideNodes, rtxTriangles, milliseconds);
+			return milliseconds;
+		});
+		double quantizedMilliseconds = fastestTrace(numRuns, [&]()
+		{
+			double milliseconds;
+			quantizedStats = traceWideTraversalRays(rays.origins, rays.directions, quantizedNodes, rtxTriangles, milliseconds);
+			return milliseconds;
+		});
+
+		std::cout << std::fixed << std::setprecision(2) << std::setw(14) << bvh.allNodes.size() * sizeof(Node) / 1024
+			<< std::setw(18) << binaryStats.nodesVisited / rays.count() << std::setw(16) << rays.megaRaysPerSecond(binaryMilliseconds)
+			<< std::setw(12) << wideNodes.size() * sizeof(WideNode) / 1024 << std::setw(16) << wideStats.nodesVisited / rays.count()
+			<< std::setw(14) << rays.megaRaysPerSecond(wideMilliseconds) << std::setw(14) << quantizedNodes.size() * sizeof(QuantizedWideNode) / 1024
+			<< std::setw(20) << quantizedStats.nodesVisited / rays.count() << std::setw(18) << rays.megaRaysPerSecond(quantizedMilliseconds) << std::endl;
+	});
+	std::cout << std::defaultfloat;
+}
@@ -13,6 +13,14 @@
 #include <OpenGL/FBO.h>
 
 #include <Assets/headers/BVH.h>
+#include <Assets/headers/indexedGeometry.h>
+#include <Assets/headers/sceneCache.h>
+#include <Assets/headers/gltfLoader.h>
+#include <Assets/headers/plyLoader.h>
+#include <Assets/headers/sceneStreamer.h>
+#include <Assets/headers/bvhTraversal.h>
+#include <Assets/headers/bvhReport.h>
+#include <Assets/headers/wideBVH.h>
 
 #include <Assets/headers/camera.h>
 #include <Assets/headers/mesh.h>
@@ -75,6 +83,94 @@ const float CORNELL_LIGHT_BRIGHTNESS = 15.0f;
 const float CORNELL_PADDING = 0.3f;
 const float CORNELL_LIGHT_SIZE = 0.17f;
 
+// Stores the loaded, BVH ordered scene as <model>/<model>.rtscene and maps it on later runs instead of
+// parsing and building again. The cache is keyed by the model folder's content, GEOMETRY_LAYOUT, BVH_BUILDER,
+// BVH_OPTIMIZE_ITERATIONS and BVH_LAYOUT, so only delete the file after changing the scene setup in main
+// (Cornell boxes, extra materials).
+const bool USE_SCENE_CACHE = true;
+
+// Times every OBJ parser on every model in Data/ and exits instead of opening the renderer
+const bool COMPARE_OBJ_PARSERS = false;
+
+// Opens the window as soon as the materials are parsed and renders coarse previews while the OBJ is still
+// loading, the final BVH and the textures are swapped in once ready. Only used when there is no scene cache.
+const bool STREAM_SCENE_LOAD = true;
+
+// GEOMETRY_TRIANGLES uploads 80 byte self contained triangles. GEOMETRY_INDEXED uploads shared vertex
+// positions/UVs plus 16 byte index records instead, see indexedGeometry.h, and the compute shader is compiled
+// with INDEXED_GEOMETRY to match. GEOMETRY_SPLIT keeps self contained triangles but moves UVs and material out
+// of the 48 bytes the intersection test reads, see splitGeometry.h, compiled with SPLIT_GEOMETRY.
+// Only the memory of the other two layouts is measured (COMPARE_GEOMETRY_LAYOUTS), not their frame time or
+// leaf fetch cost, so the default stays on self contained triangles until it is.
+const GeometryLayout GEOMETRY_LAYOUT = GEOMETRY_TRIANGLES;
+
+// Prints the triangle memory of the geometry layouts for every model in Data/ and exits
+const bool COMPARE_GEOMETRY_LAYOUTS = false;
+
+// Times the OBJ and GLB loaders on every model in Data/ that has both files and exits
+const bool COMPARE_MODEL_FORMATS = false;
+
+// BVH_BUILDER_SWEEP is the original 10 planes per axis search, kept for comparison.
+// BVH_BUILDER_SBVH also splits long thin triangles, a slower build for fewer traversal steps.
+// BVH_BUILDER_LBVH builds fastest, for geometry that changes, BVH_BUILDER_LBVH_TREELETS trades part of that back for quality
+const BVHBuilder BVH_BUILDER = BVH_BUILDER_BINNED_SAH;
+
+// Runs BVH::optimize (treelet restructuring plus node reinsertion) on the final BVH for up to this many
+// iterations, 0 to skip it. Adds several build times to the load for a lower SAH cost, for long renders
+const int BVH_OPTIMIZE_ITERATIONS = 0;
+
+// Order of the BVH nodes in memory, see BVHLayout. BVH_LAYOUT_BUILD_ORDER skips the relayout pass.
+// Changing it rebuilds the scene cache, so the window title shows the chosen layout's frame time
+const BVHLayout BVH_LAYOUT = BVH_LAYOUT_BUILD_ORDER;
+
+// Prints cache misses per ray and CPU rays per second of every BVHLayout for every model in Data/ and exits
+const bool COMPARE_BVH_LAYOUTS = false;
+
+// Prints build time and SAH cost of every BVH builder for every model in Data/ and exits
+const bool COMPARE_BVH_BUILDERS = false;
+
+// Prints traversal steps per ray and CPU frame time of the binned and SBVH builders for every model in Data/ and exits
+const bool COMPARE_BVH_TRAVERSAL = false;
+
+// Prints SAH cost and CPU rays per second of every model in Data/ before and after BVH::optimize and exits
+const bool COMPARE_BVH_OPTIMIZER = false;
+
+// Animates every model in Data/, prints SAH cost of the refitted binned and SBVH BVH against a fresh build each frame,
+// whether BVH::update rebuilt it and whether both find the same hits, and exits
+const bool COMPARE_BVH_REFIT = false;
+
+// Uploads the BVH collapsed to 4 wide nodes, whose child boxes the compute shader tests as vec4s, see wideBVH.h.
+// The compute shader is compiled with WIDE_BVH to match. The scene cache keeps the binary nodes
+const bool WIDE_BVH = false;
+
+// With WIDE_BVH, uploads the wide nodes quantized to 64 bytes, child boxes as bytes on a grid over their parent.
+// Halves the node memory and bandwidth for a little decoding in the compute shader, compiled with QUANTIZED_BVH
+const bool QUANTIZED_BVH = false;
+
+// Without WIDE_BVH, uploads the binary BVH as ChildBoundsNodes, which hold the boxes of both children so a traversal
+// step is one node fetch instead of three. The compute shader is compiled with CHILD_BOUNDS_BVH to match,
+// false keeps the old layout for A/B timing
+const bool CHILD_BOUNDS_BVH = false;
+
+// Prints node fetches per ray and CPU rays per second of the old and the child bounds layout of every model in Data/ and exits
+const bool COMPARE_CHILD_BOUNDS_BVH = false;
+
+// Prints nodes visited per ray and CPU rays per second of the binary, the 4 wide and the quantized BVH of every model in Data/ and exits
+const bool COMPARE_WIDE_BVH = false;
+
+// Writes SAH cost, depth and leaf size histograms, memory and sibling overlap of the BVH_BUILDER BVH of every
+// model in Data/ to Data/bvhReport.json and exits, failing if a model's SAH cost rose since the last report.
+// The report then goes to Data/bvhReport.latest.json instead, like after changing BVH_BUILDER or BVH_OPTIMIZE_ITERATIONS
+const bool REPORT_BVH_QUALITY = false;
+
+// Prints leaf sizes, depth and SAH cost of the final BVH once it is built
+const bool PRINT_BVH_STATS = true;
+
+// Places the model this many times per side on a grid, as instances of one copy of its geometry: a BLAS per
+// mesh and a TLAS over the instances, see instancing.h. The compute shader is compiled with INSTANCING to match.
+// 1 builds the usual single BVH. Instanced scenes are neither cached nor streamed.
+const int MODEL_INSTANCES_PER_SIDE = 1;
+
 const int FPS = 120;
 const float SPF = 1.0f / FPS;
 
@@ -1137,6 +1233,67 @@ GLfloat ndcVertices[] =
 	1.0f, 1.0f, 0.0f
 };
 
+// Extra materials appended after the model's own, the Cornell box helpers index them from the end
+void addSceneMaterials(std::vector<Material>& materials)
+{
+	Material red;
+	red.makeDiffusive(glm::vec3(1.0f, 0.0f, 0.0f));
+	materials.push_back(red);
+	Material green;
+	green.makeDiffusive(glm::vec3(0.0f, 1.0f, 0.0f));
+	materials.push_back(green);
+
+	Material wall;
+	wall.makeDiffusive(glm::vec3(1.0f));
+	materials.push_back(wall);
+	Material light;
+	light.makeLight(glm::vec3(1.0f), CORNELL_LIGHT_BRIGHTNESS);
+	materials.push_back(light);
+	Material mirror;
+	mirror.makeSpecular(glm::vec3(1.0f), glm::vec3(1.0f), 1.0f, 1.0f);
+	materials.push_back(mirror);
+}
+
+// Extra geometry placed around the model before the BVH is built, `numMaterials` includes the ones from addSceneMaterials
+void addSceneGeometry([[maybe_unused]] std::vector<RTXTriangle>& rtxTriangles, [[maybe_unused]] std::vector<BVHTriangle>& bvhTriangles,
+	[[maybe_unused]] int numMaterials)
+{
+	// createClassicCornellBox(rtxTriangles, bvhTriangles, 10, numMaterials - 5, numMaterials - 4, numMaterials - 3, numMaterials - 2);
+	// createDiverseCornellBox(rtxTriangles, bvhTriangles, 10, numMaterials - 5, numMaterials - 4, numMaterials - 3, numMaterials - 2);
+
+	// addCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, numMaterials - 2, true);
+	// addMirrorCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, numMaterials - 2, numMaterials - 1);
+	// addSideLitCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, numMaterials - 2, numMaterials - 3, 1);
+	// addSkyLightPlane(rtxTriangles, bvhTriangles, numMaterials - 2);
+}
+
+enum ModelFormat
+{
+	MODEL_OBJ,	// .obj + .mtl, getTrianglesData_
+	MODEL_GLB,	// Binary glTF, getGlbTrianglesData
+	MODEL_PLY,	// Binary PLY scan, getPlyTrianglesData
+};
+
+// Format of the model in a folder, .obj wins when there are several
+ModelFormat findModelFormat(const std::string& folderPath)
+{
+	if (!findFirstObjFile(folderPath).empty())
+		return MODEL_OBJ;
+	if (!findFirstGlbFile(folderPath).empty())
+		return MODEL_GLB;
+	if (!findFirstPlyFile(folderPath).empty())
+		return MODEL_PLY;
+	return MODEL_OBJ; // Lets getTrianglesData_ report the missing model
+}
+
+// Material of every triangle of a .ply model, scans carry no materials of their own
+Material plyModelMaterial()
+{
+	Material material;
+	material.makeDiffusive(glm::vec3(0.8f));
+	return material;
+}
+
 /**
  * @brief Resets OpenGL state to a clean default configuration.
  *
@@ -1148,6 +1305,7 @@ void resetOpenGLState() {
 	for (int i = 0; i < 32; i++) {
 		glActiveTexture(GL_TEXTURE0 + i);
 		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 		glBindImageTexture(i, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
 	}
 	glActiveTexture(GL_TEXTURE0);
@@ -1210,6 +1368,63 @@ void forceGPUCleanup() {
 int main(int argc, char* argv[])
 {
 	try {
+		if (COMPARE_OBJ_PARSERS)
+		{
+			compareObjParsers(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_GEOMETRY_LAYOUTS)
+		{
+			compareGeometryLayouts(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_MODEL_FORMATS)
+		{
+			compareModelFormats(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_BVH_BUILDERS)
+		{
+			compareBVHBuilders(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_BVH_TRAVERSAL)
+		{
+			compareBVHTraversal(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_BVH_OPTIMIZER)
+		{
+			compareBVHOptimizer(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_BVH_REFIT)
+		{
+			compareBVHRefit(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_WIDE_BVH)
+		{
+			compareWideBVH(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_BVH_LAYOUTS)
+		{
+			compareBVHLayouts(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (COMPARE_CHILD_BOUNDS_BVH)
+		{
+			compareChildBoundsBVH(getPath("Data", 1));
+			return EXIT_SUCCESS;
+		}
+		if (REPORT_BVH_QUALITY)
+		{
+			std::string reportPath = (std::filesystem::path(getPath("Data", 1)) / "bvhReport.json").string();
+			int numRegressions = reportBVHQuality(getPath("Data", 1), reportPath, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS);
+			return numRegressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
 		// glfw: initialize and configure
 		// ------------------------------
 		glfwInit();
@@ -1256,41 +1471,137 @@ int main(int argc, char* argv[])
 		std::cout << "modelFolderPath: " << modelFolderPath << std::endl;
 
 		// Init mesh objects
-		std::vector<RTXTriangle> rtxTriangles;
-		std::vector<BVHTriangle> bvhTriangles;
 		std::vector<Material> materials;
-		std::vector<Texture2D> textures;
-
-		// Call with the user-selected folder path
-		getTrianglesData_(modelFolderPath, 1, rtxTriangles, bvhTriangles, materials, textures);
-
-
-		Material red;
-		red.makeDiffusive(glm::vec3(1.0f, 0.0f, 0.0f));
-		materials.push_back(red);
-		Material green;
-		green.makeDiffusive(glm::vec3(0.0f, 1.0f, 0.0f));
-		materials.push_back(green);
-
-		Material wall;
-		wall.makeDiffusive(glm::vec3(1.0f));
-		materials.push_back(wall);
-		Material light;
-		light.makeLight(glm::vec3(1.0f), CORNELL_LIGHT_BRIGHTNESS);
-		materials.push_back(light);
-		Material mirror;
-		mirror.makeSpecular(glm::vec3(1.0f), glm::vec3(1.0f), 1.0f, 1.0f);
-		materials.push_back(mirror);
-
-		// createClassicCornellBox(rtxTriangles, bvhTriangles, 10, materials.size() - 5, materials.size() - 4, materials.size() - 3, materials.size() - 2);
-		// createDiverseCornellBox(rtxTriangles, bvhTriangles, 10, materials.size() - 5, materials.size() - 4, materials.size() - 3, materials.size() - 2);
-
-		// addCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, materials.size() - 2, true);
-		// addMirrorCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, materials.size() - 2, materials.size() - 1);
-		// addSideLitCornellBox(rtxTriangles, bvhTriangles, CORNELL_LIGHT_SIZE, CORNELL_PADDING, materials.size() - 2, materials.size() - 3, 1);
-		// addSkyLightPlane(rtxTriangles, bvhTriangles, materials.size() - 2);
+		SceneTextures textures;
+		SceneGeometry sceneGeometry;
+
+		// What gets uploaded to the SSBOs, either sceneGeometry or straight from the mapped scene cache.
+		// Triangles are RTXTriangles, IndexedTriangles or IntersectionTriangles depending on GEOMETRY_LAYOUT,
+		// positions and texCoords are only filled for GEOMETRY_INDEXED, attributes only for GEOMETRY_SPLIT.
+		const void* trianglesData;
+		size_t numTriangles;
+		size_t triangleSize;
+		const glm::vec4* positionsData = nullptr;
+		const glm::vec2* texCoordsData = nullptr;
+		size_t numVertices = 0;
+		const TriangleAttributes* attributesData = nullptr;
+		size_t numAttributes = 0;
+		const Node* nodesData;
+		size_t numNodes;
+
+		float loadStart = glfwGetTime();
+		std::filesystem::path cachePath = sceneCachePath(modelFolderPath);
+		bool isInstanced = MODEL_INSTANCES_PER_SIDE > 1;
+		bool useSceneCache = USE_SCENE_CACHE && !isInstanced;
+		uint64_t contentHash = useSceneCache ? hashModelFolder(modelFolderPath) : 0;
+		SceneCache sceneCache;
+		BVHStatsCallback bvhStatsCallback = PRINT_BVH_STATS ? BVHStatsCallback(printBVHBuildStats) : nullptr;
+
+		// Streaming load state, see STREAM_SCENE_LOAD
+		SceneStreamer sceneStreamer;
+		std::vector<std::future<DecodedTexture>> pendingTextures;
+		bool isStreaming = false;
+		bool isGeometryStreaming = false;
+		const Node emptyRootNode = Node(); // Leaf without triangles, traced until the first preview arrives
+
+		// Only OBJ models are streamed, the binary formats are read in one go
+		ModelFormat modelFormat = findModelFormat(modelFolderPath);
+
+		if (useSceneCache && sceneCache.open(cachePath, contentHash, GEOMETRY_LAYOUT, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS, BVH_LAYOUT))
+		{
+			std::cout << "Using scene cache: " << cachePath << std::endl;
+			materials.assign(sceneCache.materials, sceneCache.materials + sceneCache.numMaterials);
+			sceneCache.loadTextures(cachePath.parent_path(), textures);
+
+			trianglesData = sceneCache.triangles;
+			numTriangles = sceneCache.numTriangles;
+			triangleSize = sceneCache.triangleSize;
+			positionsData = sceneCache.positions;
+			texCoordsData = sceneCache.texCoords;
+			numVertices = sceneCache.numVertices;
+			attributesData = sceneCache.attributes;
+			numAttributes = sceneCache.numAttributes;
+			nodesData = sceneCache.nodes;
+			numNodes = sceneCache.numNodes;
+		}
+		else if (STREAM_SCENE_LOAD && modelFormat == MODEL_OBJ && !isInstanced)
+		{
+			// Only the MTL libraries are waited for, geometry and textures are swapped in by the render loop
+			sceneStreamer.start(modelFolderPath, GEOMETRY_LAYOUT, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS, BVH_LAYOUT, bvhStatsCallback, addSceneMaterials, addSceneGeometry);
+			materials = sceneStreamer.waitForMaterials(pendingTextures);
+			isStreaming = true;
+			isGeometryStreaming = true;
+
+			trianglesData = nullptr;
+			numTriangles = 0;
+			triangleSize = 0;
+			nodesData = &emptyRootNode;
+			numNodes = 1;
+		}
+		else
+		{
+			std::vector<RTXTriangle> rtxTriangles;
+			std::vector<BVHTriangle> bvhTriangles;
+
+			// Call with the user-selected folder path
+			if (modelFormat == MODEL_GLB)
+				getGlbTrianglesData(modelFolderPath, rtxTriangles, bvhTriangles, materials, textures);
+			else if (modelFormat == MODEL_PLY)
+				getPlyTrianglesData(modelFolderPath, rtxTriangles, bvhTriangles, materials, textures, plyModelMaterial());
+			else
+				getTrianglesData_(modelFolderPath, 1, rtxTriangles, bvhTriangles, materials, textures);
+			addSceneMaterials(materials);
+
+			if (isInstanced)
+			{
+				std::vector<InstancedMesh> meshes(1);
+				meshes[0].rtxTriangles = std::move(rtxTriangles);
+				meshes[0].bvhTriangles = std::move(bvhTriangles);
+				BoundingBox modelBounds;
+				for (const BVHTriangle& tri : meshes[0].bvhTriangles)
+					modelBounds.growToInclude(tri);
+				std::vector<MeshInstance> instances = makeInstanceGrid(0, modelBounds, MODEL_INSTANCES_PER_SIDE);
+
+				// The extra scene geometry is placed once, as a mesh of its own
+				InstancedMesh sceneMesh;
+				addSceneGeometry(sceneMesh.rtxTriangles, sceneMesh.bvhTriangles, static_cast<int>(materials.size()));
+				if (!sceneMesh.rtxTriangles.empty())
+				{
+					meshes.push_back(std::move(sceneMesh));
+					instances.push_back({ 1, glm::mat4(1.0f) });
+				}
+
+				buildInstancedSceneGeometry(GEOMETRY_LAYOUT, meshes, instances, sceneGeometry, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS,
+					BVH_LAYOUT);
+			}
+			else
+			{
+				addSceneGeometry(rtxTriangles, bvhTriangles, static_cast<int>(materials.size()));
+				buildSceneGeometry(GEOMETRY_LAYOUT, rtxTriangles, bvhTriangles, sceneGeometry, MAX_DEPTH, BVH_BUILDER, bvhStatsCallback,
+					BVH_OPTIMIZE_ITERATIONS, BVH_LAYOUT);
+			}
+			printSceneGeometry(sceneGeometry);
+
+			if (useSceneCache && writeSceneCache(cachePath, contentHash, GEOMETRY_LAYOUT, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS, BVH_LAYOUT,
+				sceneGeometry.rtxTriangles, sceneGeometry.indexedGeometry, sceneGeometry.splitGeometry, sceneGeometry.nodes, materials, textures))
+				std::cout << "Wrote scene cache: " << cachePath << std::endl;
+
+			trianglesData = sceneGeometry.triangleData();
+			numTriangles = sceneGeometry.numTriangles();
+			triangleSize = sceneGeometry.triangleSize();
+			positionsData = sceneGeometry.indexedGeometry.positions.data();
+			texCoordsData = sceneGeometry.indexedGeometry.texCoords.data();
+			numVertices = sceneGeometry.indexedGeometry.positions.size();
+			attributesData = sceneGeometry.splitGeometry.attributes.data();
+			numAttributes = sceneGeometry.splitGeometry.attributes.size();
+			nodesData = sceneGeometry.nodes.data();
+			numNodes = sceneGeometry.nodes.size();
+		}
 
-		BVH BVH(bvhTriangles, rtxTriangles);
+		if (isStreaming)
+			std::cout << "Materials ready in " << glfwGetTime() - loadStart << " s, streaming geometry" << std::endl;
+		else
+			std::cout << "Scene ready in " << glfwGetTime() - loadStart << " s" << std::endl;
 
 		// for (Material& mat : materials)
 		// 	mat.addSpecular(1.0f, 0.02f);
@@ -1301,28 +1612,66 @@ int main(int argc, char* argv[])
 		// -------------------------
 		std::string shaderFolderPath = getPath("Assets\\Shaders", 1);
 		Shader renderShader(shaderFolderPath + "\\vert.glsl", shaderFolderPath + "\\newFrag.glsl");
-		ComputeShader computeShader(shaderFolderPath + "\\compute.glsl");
+		std::string shaderDefines = GEOMETRY_LAYOUT == GEOMETRY_INDEXED ? "#define INDEXED_GEOMETRY\n" : "";
+		if (GEOMETRY_LAYOUT == GEOMETRY_SPLIT)
+			shaderDefines += "#define SPLIT_GEOMETRY\n";
+		if (isInstanced)
+			shaderDefines += "#define INSTANCING\n";
+		if (WIDE_BVH)
+			shaderDefines += "#define WIDE_BVH\n";
+		if (WIDE_BVH && QUANTIZED_BVH)
+			shaderDefines += "#define QUANTIZED_BVH\n";
+		if (!WIDE_BVH && CHILD_BOUNDS_BVH)
+			shaderDefines += "#define CHILD_BOUNDS_BVH\n";
+		ComputeShader computeShader(shaderFolderPath + "\\compute.glsl", shaderDefines);
 		std::cout << "Shader folder path: " << shaderFolderPath << std::endl;
 		renderShader.Activate();
 		renderShader.setInt("tex", 5);
 
-		int textureUnits[MAX_TEXTURES] = { 0, 1, 2, 3, 4 };
-		renderShader.setIntArray("textures", textureUnits, sizeof(textureUnits));
-
 		// Texture for the compute shader to draw on
 		Texture2D screenTexture(SCR_WIDTH, SCR_HEIGHT, GL_TEXTURE5);
 		glBindImageTexture(0, screenTexture.ID, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-		for (int i = 0; i < textures.size(); i++)
-		{
-			computeShader.setInt(("texture" + std::to_string(i)).c_str(), i);
-			textures[i].SetActive();
-			textures[i].Bind();
-		}
+		for (int i = 0; i < NUM_TEXTURE_ARRAYS; i++)
+			computeShader.setInt(("textures[" + std::to_string(i) + "]").c_str(), i);
+		textures.bind();
 
 		// SSBOs for triangles and nodes
-		SSBO trianglesSSBO(rtxTriangles.data(), sizeof(RTXTriangle) * rtxTriangles.size(), 1);
-		SSBO nodesSSBO(BVH.allNodes.data(), sizeof(Node) * BVH.allNodes.size(), 2);
+		SSBO trianglesSSBO(const_cast<void*>(trianglesData), triangleSize * numTriangles, 1);
+		SSBO positionsSSBO(const_cast<glm::vec4*>(positionsData), sizeof(glm::vec4) * numVertices, 4);
+		SSBO texCoordsSSBO(const_cast<glm::vec2*>(texCoordsData), sizeof(glm::vec2) * numVertices, 5);
+		SSBO attributesSSBO(const_cast<TriangleAttributes*>(attributesData), sizeof(TriangleAttributes) * numAttributes, 8);
+		const void* nodesUploadData = nodesData;
+		size_t nodesUploadSize = sizeof(Node) * numNodes;
+		std::vector<WideNode> wideNodes;
+		std::vector<QuantizedWideNode> quantizedNodes;
+		if (WIDE_BVH)
+		{
+			// Also points the instances at their wide BLAS roots
+			wideNodes = collapseSceneBVH(nodesData, numNodes, sceneGeometry.instances);
+			nodesUploadData = wideNodes.data();
+			nodesUploadSize = sizeof(WideNode) * wideNodes.size();
+		}
+		if (WIDE_BVH && QUANTIZED_BVH)
+		{
+			quantizedNodes = quantizeWideBVH(wideNodes);
+			nodesUploadData = quantizedNodes.data();
+			nodesUploadSize = sizeof(QuantizedWideNode) * quantizedNodes.size();
+		}
+		std::vector<ChildBoundsNode> childBoundsNodes;
+		if (!WIDE_BVH && CHILD_BOUNDS_BVH)
+		{
+			childBoundsNodes = makeSceneChildBoundsBVH(nodesData, numNodes, sceneGeometry.instances);
+			nodesUploadData = childBoundsNodes.data();
+			nodesUploadSize = sizeof(ChildBoundsNode) * childBoundsNodes.size();
+		}
+		SSBO nodesSSBO(const_cast<void*>(nodesUploadData), nodesUploadSize, 2);
 		SSBO materialsSSBO(materials.data(), sizeof(Material) * materials.size(), 3);
+		SSBO tlasNodesSSBO(sceneGeometry.tlasNodes.data(), sizeof(Node) * sceneGeometry.tlasNodes.size(), 6);
+		SSBO instancesSSBO(sceneGeometry.instances.data(), sizeof(GPUInstance) * sceneGeometry.instances.size(), 7);
+		SSBO textureLayersSSBO(textures.layers.data(), sizeof(glm::ivec2) * textures.layers.size(), 0);
+
+		// The GPU has its own copy now
+		sceneCache.close();
 
 		// Set shader's constants
 		computeShader.bindSSBOToBlock(trianglesSSBO, "TrianglesBlock");
@@ -1382,12 +1731,71 @@ int main(int argc, char* argv[])
 			if (terminateProgram)
 				glfwSetWindowShouldClose(window, true);
 
+			// Streaming load, swap in whatever arrived since the last frame
+			if (isStreaming)
+			{
+				if (isGeometryStreaming && sceneStreamer.takeGeometry(sceneGeometry))
+				{
+					trianglesSSBO.setData(sceneGeometry.triangleData(), sceneGeometry.triangleSize() * sceneGeometry.numTriangles());
+					positionsSSBO.setData(sceneGeometry.indexedGeometry.positions.data(), sizeof(glm::vec4) * sceneGeometry.indexedGeometry.positions.size());
+					texCoordsSSBO.setData(sceneGeometry.indexedGeometry.texCoords.data(), sizeof(glm::vec2) * sceneGeometry.indexedGeometry.texCoords.size());
+					attributesSSBO.setData(sceneGeometry.splitGeometry.attributes.data(), sizeof(TriangleAttributes) * sceneGeometry.splitGeometry.attributes.size());
+					if (WIDE_BVH)
+					{
+						wideNodes = collapseSceneBVH(sceneGeometry.nodes.data(), sceneGeometry.nodes.size(), sceneGeometry.instances);
+						if (QUANTIZED_BVH)
+						{
+							quantizedNodes = quantizeWideBVH(wideNodes);
+							nodesSSBO.setData(quantizedNodes.data(), sizeof(QuantizedWideNode) * quantizedNodes.size());
+						}
+						else
+							nodesSSBO.setData(wideNodes.data(), sizeof(WideNode) * wideNodes.size());
+					}
+					else if (CHILD_BOUNDS_BVH)
+					{
+						childBoundsNodes = makeSceneChildBoundsBVH(sceneGeometry.nodes.data(), sceneGeometry.nodes.size(), sceneGeometry.instances);
+						nodesSSBO.setData(childBoundsNodes.data(), sizeof(ChildBoundsNode) * childBoundsNodes.size());
+					}
+					else
+						nodesSSBO.setData(sceneGeometry.nodes.data(), sizeof(Node) * sceneGeometry.nodes.size());
+					numTriangles = sceneGeometry.numTriangles();
+
+					if (sceneGeometry.isFinal)
+					{
+						isGeometryStreaming = false;
+						printSceneGeometry(sceneGeometry);
+						std::cout << "Geometry ready in " << glfwGetTime() - loadStart << " s" << std::endl;
+					}
+					else
+						std::cout << "Preview: " << numTriangles << " triangles" << std::endl;
+				}
+
+				bool texturesDecoded = std::all_of(pendingTextures.begin(), pendingTextures.end(),
+					[](const std::future<DecodedTexture>& texture) { return !texture.valid() || texture.wait_for(std::chrono::seconds(0)) == std::future_status::ready; });
+				if (!textures.isUploaded() && texturesDecoded)
+				{
+					textures = uploadSceneTextures(pendingTextures);
+					textures.bind();
+					textureLayersSSBO.setData(textures.layers.data(), sizeof(glm::ivec2) * textures.layers.size());
+				}
+
+				if (!isGeometryStreaming && textures.isUploaded())
+				{
+					isStreaming = false;
+					std::cout << "Scene ready in " << glfwGetTime() - loadStart << " s" << std::endl;
+
+					if (useSceneCache && writeSceneCache(cachePath, contentHash, GEOMETRY_LAYOUT, BVH_BUILDER, BVH_OPTIMIZE_ITERATIONS, BVH_LAYOUT,
+						sceneGeometry.rtxTriangles, sceneGeometry.indexedGeometry, sceneGeometry.splitGeometry, sceneGeometry.nodes, materials, textures))
+						std::cout << "Wrote scene cache: " << cachePath << std::endl;
+				}
+			}
+
 			// Uniforms
-			uniforms.numTextures = textures.size();
+			uniforms.numTextures = textures.paths.size();
 			uniforms.width = SCR_WIDTH;
 			uniforms.height = SCR_HEIGHT;
 			uniforms.numSpheres = 0;
-			uniforms.numTriangles = rtxTriangles.size();
+			uniforms.numTriangles = numTriangles;
 			uniforms.basicShading = BASIC_SHADING;
 			uniforms.basicShadingShadow = BASIC_SHADING_SHADOW;
 			uniforms.basicShadingLightPosition = glm::vec4(LIGHT_POSITION, 0.0f);
@@ -1425,11 +1833,16 @@ int main(int argc, char* argv[])
 		VBO.Delete();
 		UBO.Delete();
 		trianglesSSBO.Delete();
+		positionsSSBO.Delete();
+		texCoordsSSBO.Delete();
+		attributesSSBO.Delete();
 		nodesSSBO.Delete();
 		materialsSSBO.Delete();
+		tlasNodesSSBO.Delete();
+		instancesSSBO.Delete();
+		textureLayersSSBO.Delete();
 
-		for (Texture2D& tex : textures)
-			tex.Delete();
+		textures.Delete();
 
 		glfwTerminate();
 
@@ -9,6 +9,13 @@ SSBO::SSBO(void* data, GLsizeiptr size, GLuint bindIndex) : bindingIndex(bindInd
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
+void SSBO::setData(const void* data, GLsizeiptr size)
+{
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
 void SSBO::Bind()
 {
 	glBindBuffer(GL_SHADER_STORAGE_BUFFER, ID);
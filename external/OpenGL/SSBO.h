@@ -10,6 +10,9 @@ public:
 
     SSBO(void* data, GLsizeiptr size, GLuint bindIndex);
 
+    // Replaces the whole buffer, the binding index is kept
+    void setData(const void* data, GLsizeiptr size);
+
     void Bind();
     void Unbind();
     void Delete();
@@ -158,9 +158,14 @@ void Shader::setUBO(const char* uniformBlockName, GLuint bindingIndex)
 	glUniformBlockBinding(ID, blockIndex, bindingIndex);
 }
 
-ComputeShader::ComputeShader(const std::string& path)
+ComputeShader::ComputeShader(const std::string& path, const std::string& defines)
 {
 	std::string codeStr = getFileContents(path);
+	if (!defines.empty())
+	{
+		size_t versionEnd = codeStr.find('\n');
+		codeStr.insert(versionEnd == std::string::npos ? codeStr.size() : versionEnd + 1, defines);
+	}
 	const char* code = codeStr.c_str();;
 
 	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
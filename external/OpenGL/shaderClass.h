@@ -41,7 +41,8 @@ public:
 
     GLuint ID;
 
-    ComputeShader(const std::string& path);
+    // `defines` is inserted right after the #version line, e.g. "#define INDEXED_GEOMETRY\n"
+    ComputeShader(const std::string& path, const std::string& defines = "");
 
     void setBool(const char* uniform, bool val);
     void setInt(const char* uniform, int val);
@@ -1,5 +1,7 @@
 #include <OpenGL/textureClass.h>
 
+#include <cmath>
+
 Texture2D::Texture2D(int width, int height, const void* pixels, int mipmapLevel, GLenum pixelFormat, GLint filterMode, GLint wrapMode, GLenum textureUnit)
 {
 	unit = textureUnit;
@@ -52,8 +54,75 @@ Texture2D::Texture2D(int width, int height, GLenum textureUnit)
 	checkGLError("Failed to unbind texture");
 }
 
-Texture2D::Texture2D(const std::string& path, GLenum textureUnit)
+TextureImage::TextureImage(const std::string& path) : path(path)
+{
+	// Per thread flag, the global one would race between decoding threads
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	pixels = stbi_load(path.c_str(), &width, &height, &numColCh, 0);
+	if (!pixels)
+	{
+		std::cerr << "Failed to load texture: " << path << std::endl;
+		throw std::runtime_error("Failed to load texture");
+	}
+}
+
+TextureImage::TextureImage(const unsigned char* encoded, size_t size, const std::string& name) : path(name)
+{
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	pixels = stbi_load_from_memory(encoded, static_cast<int>(size), &width, &height, &numColCh, 0);
+	if (!pixels)
+	{
+		std::cerr << "Failed to load texture: " << name << std::endl;
+		throw std::runtime_error("Failed to load texture");
+	}
+}
+
+TextureImage::~TextureImage()
+{
+	if (pixels)
+		stbi_image_free(pixels);
+}
+
+TextureImage::TextureImage(TextureImage&& other) noexcept
+	: path(std::move(other.path)), width(other.width), height(other.height), numColCh(other.numColCh), pixels(other.pixels)
+{
+	other.pixels = nullptr;
+}
+
+TextureImage& TextureImage::operator=(TextureImage&& other) noexcept
 {
+	if (this != &other)
+	{
+		if (pixels)
+			stbi_image_free(pixels);
+		path = std::move(other.path);
+		width = other.width;
+		height = other.height;
+		numColCh = other.numColCh;
+		pixels = other.pixels;
+		other.pixels = nullptr;
+	}
+	return *this;
+}
+
+Texture2D::Texture2D(const std::string& path, GLenum textureUnit) : Texture2D(TextureImage(path), textureUnit)
+{
+}
+
+Texture2D::Texture2D(const TextureImage& image, GLenum textureUnit) : path(image.path)
+{
+	GLenum format;
+	if (image.numColCh == 1) format = GL_RED;
+	else if (image.numColCh == 2) format = GL_RG;
+	else if (image.numColCh == 3) format = GL_RGB;
+	else if (image.numColCh == 4) format = GL_RGBA;
+	else {
+		std::cerr << "Unsupported number of color channels." << std::endl;
+		throw std::runtime_error("Unsupported color channels");
+	}
+
 	unit = textureUnit;
 	glActiveTexture(unit);
 	glGenTextures(1, &ID);
@@ -62,55 +131,107 @@ Texture2D::Texture2D(const std::string& path, GLenum textureUnit)
 	glBindTexture(GL_TEXTURE_2D, ID);
 	checkGLError("Failed to bind texture");
 
-	stbi_set_flip_vertically_on_load(true);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+	checkGLError("Failed to set texture image");
 
-	int width, height, numColCh;
-	unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &numColCh, 0);
-	if (pixels)
+	if (image.numColCh == 1)
 	{
-		std::cout << "Texture's number of color channels: " << numColCh << std::endl;
-
-		GLenum format;
-		if (numColCh == 1) format = GL_RED;
-		else if (numColCh == 2) format = GL_RG;
-		else if (numColCh == 3) format = GL_RGB;
-		else if (numColCh == 4) format = GL_RGBA;
-		else {
-			std::cerr << "Unsupported number of color channels." << std::endl;
-			stbi_image_free(pixels);
-			throw std::runtime_error("Unsupported color channels");
-		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_RED);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+	}
 
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
-		checkGLError("Failed to set texture image");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	checkGLError("Failed to set min filter");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	checkGLError("Failed to set mag filter");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	checkGLError("Failed to set wrap S");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	checkGLError("Failed to set wrap T");
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	checkGLError("Failed to unbind texture");
+}
 
-		if (numColCh == 1)
+std::vector<unsigned char> resampleToRGBA(const TextureImage& image, int width, int height)
+{
+	std::vector<unsigned char> rgba(static_cast<size_t>(width) * height * 4);
+	const int channels = image.numColCh;
+
+	// Expands one source texel to RGBA, gray (+ alpha) images are replicated to RGB
+	auto fetch = [channels](const unsigned char* p, float out[4])
+	{
+		if (channels <= 2)
 		{
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_RED);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_ONE);
+			out[0] = out[1] = out[2] = p[0];
+			out[3] = channels == 2 ? p[1] : 255.0f;
 		}
+		else
+		{
+			out[0] = p[0];
+			out[1] = p[1];
+			out[2] = p[2];
+			out[3] = channels == 4 ? p[3] : 255.0f;
+		}
+	};
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		checkGLError("Failed to set min filter");
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		checkGLError("Failed to set mag filter");
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		checkGLError("Failed to set wrap S");
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		checkGLError("Failed to set wrap T");
-
-		stbi_image_free(pixels);
+	if (width == image.width && height == image.height)
+	{
+		for (size_t i = 0; i < static_cast<size_t>(width) * height; i++)
+		{
+			float texel[4];
+			fetch(image.pixels + i * channels, texel);
+			for (int c = 0; c < 4; c++)
+				rgba[i * 4 + c] = static_cast<unsigned char>(texel[c]);
+		}
+		return rgba;
 	}
-	else
+
+	// Source columns and weights are the same for every row
+	std::vector<int> columns0(width);
+	std::vector<int> columns1(width);
+	std::vector<float> weightsX(width);
+	float scaleX = float(image.width) / width;
+	for (int x = 0; x < width; x++)
 	{
-		std::cerr << "Failed to load texture" << std::endl;
-		throw std::runtime_error("Failed to load texture");
+		float srcX = (x + 0.5f) * scaleX - 0.5f;
+		int x0 = static_cast<int>(std::floor(srcX));
+		weightsX[x] = srcX - x0;
+		columns1[x] = (x0 + 1) % image.width * channels;
+		columns0[x] = (x0 % image.width + image.width) % image.width * channels;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, 0);
-	checkGLError("Failed to unbind texture");
+	float scaleY = float(image.height) / height;
+	size_t rowSize = static_cast<size_t>(image.width) * channels;
+	for (int y = 0; y < height; y++)
+	{
+		float srcY = (y + 0.5f) * scaleY - 0.5f;
+		int y0 = static_cast<int>(std::floor(srcY));
+		float fy = srcY - y0;
+		const unsigned char* row1 = image.pixels + (y0 + 1) % image.height * rowSize;
+		const unsigned char* row0 = image.pixels + (y0 % image.height + image.height) % image.height * rowSize;
+
+		unsigned char* out = &rgba[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; x++, out += 4)
+		{
+			float c00[4], c10[4], c01[4], c11[4];
+			fetch(row0 + columns0[x], c00);
+			fetch(row0 + columns1[x], c10);
+			fetch(row1 + columns0[x], c01);
+			fetch(row1 + columns1[x], c11);
+
+			float fx = weightsX[x];
+			for (int c = 0; c < 4; c++)
+			{
+				float top = c00[c] + (c10[c] - c00[c]) * fx;
+				float bottom = c01[c] + (c11[c] - c01[c]) * fx;
+				out[c] = static_cast<unsigned char>(top + (bottom - top) * fy + 0.5f);
+			}
+		}
+	}
+	return rgba;
 }
 
 glm::vec3 Texture2D::readPixel(const glm::vec2& uv)
@@ -146,3 +267,69 @@ void Texture2D::Delete()
 	glDeleteTextures(1, &ID);
 	checkGLError("Failed to delete texture");
 }
+
+Texture2DArray::Texture2DArray(int width, int height, int numLayers, GLenum textureUnit)
+	: unit(textureUnit), width(width), height(height), numLayers(numLayers)
+{
+	GLint maxLayers;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	if (numLayers > maxLayers)
+	{
+		std::cerr << "Too many texture layers: " << numLayers << ", the GPU supports " << maxLayers << std::endl;
+		throw std::runtime_error("Too many texture layers");
+	}
+
+	glActiveTexture(unit);
+	glGenTextures(1, &ID);
+	checkGLError("Failed to generate texture");
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	checkGLError("Failed to bind texture");
+
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, numLayers);
+	checkGLError("Failed to allocate texture array");
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	checkGLError("Failed to set min filter");
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	checkGLError("Failed to set mag filter");
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	checkGLError("Failed to set wrap S");
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	checkGLError("Failed to set wrap T");
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	checkGLError("Failed to unbind texture");
+}
+
+void Texture2DArray::setLayer(int layer, const unsigned char* pixels)
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	checkGLError("Failed to set texture layer");
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void Texture2DArray::Bind()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+	checkGLError("Failed to bind texture");
+}
+
+void Texture2DArray::SetActive()
+{
+	glActiveTexture(unit);
+	checkGLError("Failed to activate texture unit");
+}
+
+void Texture2DArray::Unbind()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	checkGLError("Failed to unbind texture");
+}
+
+void Texture2DArray::Delete()
+{
+	glDeleteTextures(1, &ID);
+	checkGLError("Failed to delete texture");
+}
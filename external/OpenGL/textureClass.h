@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -10,14 +11,46 @@
 
 #include <utils.h>
 
+/**
+ * @brief Decoded image pixels, owned and freed with stbi_image_free.
+ *
+ * Decoding touches no GL state, so images can be decoded on worker threads and handed to the
+ * `Texture2D(const TextureImage&, GLenum)` constructor on the context thread.
+ */
+class TextureImage
+{
+public:
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int numColCh = 0;
+    unsigned char* pixels = nullptr;
+
+    TextureImage() = default;
+    explicit TextureImage(const std::string& path);
+    // Decodes an encoded (PNG, JPEG, ...) image held in memory, `name` only labels it in logs
+    TextureImage(const unsigned char* encoded, size_t size, const std::string& name);
+    ~TextureImage();
+
+    TextureImage(TextureImage&& other) noexcept;
+    TextureImage& operator=(TextureImage&& other) noexcept;
+    TextureImage(const TextureImage&) = delete;
+    TextureImage& operator=(const TextureImage&) = delete;
+};
+
+// Converts to 4 channel RGBA8 and resamples bilinearly to width x height, wrapping like GL_REPEAT
+std::vector<unsigned char> resampleToRGBA(const TextureImage& image, int width, int height);
+
 class Texture2D
 {
 public:
     GLuint ID = 0;
     GLenum unit;
+    std::string path; // Source image, empty for textures created from memory
 
     Texture2D(int width, int height, const void* pixels, int mipmapLevel, GLenum pixelFormat, GLint filterMode, GLint wrapMode, GLenum textureUnit);
     Texture2D(const std::string& path, GLenum textureUnit);
+    Texture2D(const TextureImage& image, GLenum textureUnit);
     Texture2D(int width, int height, GLenum textureUnit);
 
     glm::vec3 readPixel(const glm::vec2& uv);
@@ -27,3 +60,30 @@ public:
     void Unbind();
     void Delete();
 };
+
+/**
+ * @brief Layered RGBA8 texture, every layer has the same size and is sampled with `sampler2DArray`.
+ *
+ * Layers are allocated up front and filled one at a time with `setLayer`.
+ */
+class Texture2DArray
+{
+public:
+    GLuint ID = 0;
+    GLenum unit = GL_TEXTURE0;
+    int width = 0;
+    int height = 0;
+    int numLayers = 0;
+    std::vector<std::string> paths; // Source image of each layer
+
+    Texture2DArray() = default;
+    Texture2DArray(int width, int height, int numLayers, GLenum textureUnit);
+
+    // `pixels` holds width * height RGBA8 texels
+    void setLayer(int layer, const unsigned char* pixels);
+
+    void SetActive();
+    void Bind();
+    void Unbind();
+    void Delete();
+};
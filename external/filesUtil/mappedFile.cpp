@@ -0,0 +1,115 @@
+#include <filesUtil/mappedFile.h>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filePath)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Failed to open file for mapping: " << filePath << std::endl;
+		throw std::runtime_error("Failed to open file for mapping");
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		close();
+		throw std::runtime_error("Failed to query file size");
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+
+	// Empty files cannot be mapped, they are simply reported as open with no data
+	if (size == 0)
+		return;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		throw std::runtime_error("Failed to create file mapping");
+	}
+	mappingHandle = mapping;
+
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == nullptr)
+	{
+		close();
+		throw std::runtime_error("Failed to map view of file");
+	}
+#else
+	fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		std::cerr << "Failed to open file for mapping: " << filePath << std::endl;
+		throw std::runtime_error("Failed to open file for mapping");
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		close();
+		throw std::runtime_error("Failed to query file size");
+	}
+	size = static_cast<size_t>(fileStat.st_size);
+
+	if (size == 0)
+		return;
+
+	void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapped == MAP_FAILED)
+	{
+		close();
+		throw std::runtime_error("Failed to map file");
+	}
+	madvise(mapped, size, MADV_SEQUENTIAL);
+	data = static_cast<const char*>(mapped);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::isOpen() const
+{
+#ifdef _WIN32
+	return fileHandle != nullptr;
+#else
+	return fileDescriptor >= 0;
+#endif
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (data)
+		munmap(const_cast<char*>(data), size);
+	if (fileDescriptor >= 0)
+		::close(fileDescriptor);
+	fileDescriptor = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}